@@ -8,6 +8,13 @@ mkdir ../build
 cd ../build
 cmake ..
 make -j6
+cd ../../dynamicsBenchmark
+
+rm -rf build
+mkdir build
+cd build
+cmake ..
+make -j6
 cd ../../sampleProject
 
 rm -rf build
@@ -0,0 +1,258 @@
+#include <dynamics/DynamicSystem.hpp>
+#include <dynamics/EulerExplicitSolver.hpp>
+#include <dynamics/ConstantForceField.hpp>
+#include <dynamics/DampingForceField.hpp>
+#include <dynamics/NBodyForceField.hpp>
+#include <dynamics/SPHForceField.hpp>
+#include <dynamics/SpringForceField.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Headless benchmark of the dynamic system.
+ *
+ * Build synthetic scenes of increasing particle counts, run a fixed number
+ * of simulation steps on each and print one CSV line per run on the standard
+ * output. No window is opened.
+ *
+ * Usage: dynamicsBenchmark [steps] [broad phase: brute|hash|sap] [particle counts...]
+ */
+
+typedef DynamicSystemPtr (*SceneBuilder)(size_t particleNumber);
+
+static DynamicSystemPtr createSystem()
+{
+    DynamicSystemPtr system = std::make_shared<DynamicSystem>();
+    system->setSolver(std::make_shared<EulerExplicitSolver>());
+    system->setDt(0.005);
+    system->setRestitution(0.5);
+    return system;
+}
+
+/* Particles falling in a closed box of 5 planes. */
+static DynamicSystemPtr fallingBox(size_t particleNumber)
+{
+    DynamicSystemPtr system = createSystem();
+    const float radius = 0.1;
+    const size_t side = std::ceil(std::sqrt(double(particleNumber)));
+    const float width = side * 3.0 * radius;
+
+    std::vector<ParticlePtr> particles;
+    for(size_t i = 0; i < particleNumber; ++i)
+    {
+        glm::vec3 position((i % side) * 3.0 * radius + radius,
+                           1.0 + (i / (side*side)) * 3.0 * radius,
+                           ((i / side) % side) * 3.0 * radius + radius);
+        glm::vec3 velocity(std::sin(i*1.3), 0.0, std::cos(i*0.7));
+        ParticlePtr p = std::make_shared<Particle>(position, velocity, 1.0, radius);
+        particles.push_back(p);
+        system->addParticle(p);
+    }
+    system->addForceField(std::make_shared<ConstantForceField>(particles, glm::vec3(0, -10, 0)));
+
+    system->addPlaneObstacle(std::make_shared<Plane>(glm::vec3(0, 1, 0), glm::vec3(0, 0, 0)));
+    system->addPlaneObstacle(std::make_shared<Plane>(glm::vec3(1, 0, 0), glm::vec3(0, 0, 0)));
+    system->addPlaneObstacle(std::make_shared<Plane>(glm::vec3(-1, 0, 0), glm::vec3(width, 0, 0)));
+    system->addPlaneObstacle(std::make_shared<Plane>(glm::vec3(0, 0, 1), glm::vec3(0, 0, 0)));
+    system->addPlaneObstacle(std::make_shared<Plane>(glm::vec3(0, 0, -1), glm::vec3(0, 0, width)));
+    return system;
+}
+
+/* A square cloth of springs hanging from two corners. */
+static DynamicSystemPtr hangingCloth(size_t particleNumber)
+{
+    DynamicSystemPtr system = createSystem();
+    system->setDt(0.001);
+    system->setCollisionsDetection(false);
+    const size_t side = std::max<size_t>(2, std::sqrt(double(particleNumber)));
+    const float spacing = 0.1;
+
+    std::vector<ParticlePtr> particles;
+    for(size_t i = 0; i < side; ++i)
+    {
+        for(size_t j = 0; j < side; ++j)
+        {
+            ParticlePtr p = std::make_shared<Particle>(glm::vec3(i*spacing, 2.0, j*spacing),
+                                                       glm::vec3(0), 0.01, 0.02);
+            particles.push_back(p);
+            system->addParticle(p);
+        }
+    }
+    particles[0]->setFixed(true);
+    particles[(side-1)*side]->setFixed(true);
+
+    system->addForceField(std::make_shared<ConstantForceField>(particles, glm::vec3(0, -10, 0)));
+    system->addForceField(std::make_shared<DampingForceField>(particles, 0.001));
+    for(size_t i = 0; i < side; ++i)
+    {
+        for(size_t j = 0; j < side; ++j)
+        {
+            if(i+1 < side)
+                system->addForceField(std::make_shared<SpringForceField>(
+                    particles[i*side+j], particles[(i+1)*side+j], 50.0, spacing, 0.01));
+            if(j+1 < side)
+                system->addForceField(std::make_shared<SpringForceField>(
+                    particles[i*side+j], particles[i*side+j+1], 50.0, spacing, 0.01));
+        }
+    }
+    return system;
+}
+
+/* Particles initially packed in a column, collapsing into a dense pile on the ground. */
+static DynamicSystemPtr densePile(size_t particleNumber)
+{
+    DynamicSystemPtr system = createSystem();
+    const float radius = 0.1;
+    const size_t side = std::max<size_t>(1, std::cbrt(double(particleNumber)) / 2);
+
+    std::vector<ParticlePtr> particles;
+    for(size_t i = 0; i < particleNumber; ++i)
+    {
+        glm::vec3 position((i % side) * 2.05 * radius,
+                           radius + (i / (side*side)) * 2.05 * radius,
+                           ((i / side) % side) * 2.05 * radius);
+        ParticlePtr p = std::make_shared<Particle>(position, glm::vec3(0), 1.0, radius);
+        particles.push_back(p);
+        system->addParticle(p);
+    }
+    system->addForceField(std::make_shared<ConstantForceField>(particles, glm::vec3(0, -10, 0)));
+    system->addPlaneObstacle(std::make_shared<Plane>(glm::vec3(0, 1, 0), glm::vec3(0, 0, 0)));
+    return system;
+}
+
+/* A block of SPH fluid collapsing in a box twice as long. */
+static DynamicSystemPtr damBreak(size_t particleNumber)
+{
+    DynamicSystemPtr system = createSystem();
+    system->setDt(0.001);
+    system->setRestitution(0.0);
+    const float spacing = 0.04;
+    const float mass = 1000.0 * spacing * spacing * spacing;
+    const size_t side = std::max<size_t>(1, std::cbrt(double(particleNumber)));
+    const float width = side * spacing;
+
+    std::vector<ParticlePtr> particles;
+    for(size_t i = 0; i < particleNumber; ++i)
+    {
+        glm::vec3 position((i % side + 0.5) * spacing,
+                           (i / (side*side) + 0.5) * spacing,
+                           ((i / side) % side + 0.5) * spacing);
+        ParticlePtr p = std::make_shared<Particle>(position, glm::vec3(0), mass, 0.1 * spacing);
+        particles.push_back(p);
+        system->addParticle(p);
+    }
+    system->addForceField(std::make_shared<ConstantForceField>(particles, glm::vec3(0, -10, 0)));
+    system->addForceField(std::make_shared<SPHForceField>(particles, 2.0 * spacing, 1000.0, 100.0, 5.0, 0.0));
+
+    system->addPlaneObstacle(std::make_shared<Plane>(glm::vec3(0, 1, 0), glm::vec3(0, 0, 0)));
+    system->addPlaneObstacle(std::make_shared<Plane>(glm::vec3(1, 0, 0), glm::vec3(0, 0, 0)));
+    system->addPlaneObstacle(std::make_shared<Plane>(glm::vec3(-1, 0, 0), glm::vec3(2.0 * width, 0, 0)));
+    system->addPlaneObstacle(std::make_shared<Plane>(glm::vec3(0, 0, 1), glm::vec3(0, 0, 0)));
+    system->addPlaneObstacle(std::make_shared<Plane>(glm::vec3(0, 0, -1), glm::vec3(0, 0, width)));
+    return system;
+}
+
+/* A cloud of bodies attracting each other, without collisions. */
+static DynamicSystemPtr swarm(size_t particleNumber)
+{
+    DynamicSystemPtr system = createSystem();
+    system->setCollisionsDetection(false);
+
+    std::vector<ParticlePtr> particles;
+    for(size_t i = 0; i < particleNumber; ++i)
+    {
+        const float radius = std::cbrt((i + 0.5) / particleNumber);
+        const float z = 2.0 * std::fmod(i * 0.618034, 1.0) - 1.0;
+        const float phi = i * 2.399963;
+        const float r = std::sqrt(1.0 - z*z);
+        glm::vec3 position(radius * r * std::cos(phi), radius * r * std::sin(phi), radius * z);
+        glm::vec3 velocity(-position.y, position.x, 0.0);
+        ParticlePtr p = std::make_shared<Particle>(position, velocity, 1.0 / particleNumber, 0.01);
+        particles.push_back(p);
+        system->addParticle(p);
+    }
+    system->addForceField(std::make_shared<NBodyForceField>(particles, 1.0, 0.05, 0.7));
+    return system;
+}
+
+static void run(const std::string& name, SceneBuilder builder, size_t particleNumber,
+                unsigned int steps, DynamicSystem::COLLISION_BROAD_PHASE broadPhase)
+{
+    DynamicSystemPtr system = builder(particleNumber);
+    system->setBroadPhase(broadPhase);
+
+    DynamicSystem::StepTimings total = DynamicSystem::StepTimings();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(unsigned int step = 0; step < steps; ++step)
+    {
+        system->computeSimulationStep();
+        const DynamicSystem::StepTimings& timings = system->getLastStepTimings();
+        total.forces += timings.forces;
+        total.integration += timings.integration;
+        total.detection += timings.detection;
+        total.broadPhase += timings.broadPhase;
+        total.narrowPhase += timings.narrowPhase;
+        total.resolution += timings.resolution;
+        total.pairsTested += timings.pairsTested;
+        total.contacts += timings.contacts;
+        total.allocations += timings.allocations;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << name << ","
+              << system->getParticles().size() << ","
+              << steps << ","
+              << steps / seconds << ","
+              << 1000.0 * total.forces / steps << ","
+              << 1000.0 * total.integration / steps << ","
+              << 1000.0 * total.detection / steps << ","
+              << 1000.0 * total.broadPhase / steps << ","
+              << 1000.0 * total.narrowPhase / steps << ","
+              << 1000.0 * total.resolution / steps << ","
+              << double(total.pairsTested) / steps << ","
+              << double(total.contacts) / steps << ","
+              << double(total.allocations) / steps << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int steps = 200;
+    DynamicSystem::COLLISION_BROAD_PHASE broadPhase = DynamicSystem::SPATIAL_HASH_BROAD_PHASE;
+    std::vector<size_t> particleNumbers;
+
+    if(argc > 1)
+        steps = std::atoi(argv[1]);
+    if(argc > 2)
+    {
+        if(!std::strcmp(argv[2], "brute"))
+            broadPhase = DynamicSystem::BRUTE_FORCE_BROAD_PHASE;
+        else if(!std::strcmp(argv[2], "sap"))
+            broadPhase = DynamicSystem::SWEEP_AND_PRUNE_BROAD_PHASE;
+        else if(std::strcmp(argv[2], "hash"))
+        {
+            std::cerr << "Usage: " << argv[0] << " [steps] [brute|hash|sap] [particle counts...]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    for(int i = 3; i < argc; ++i)
+        particleNumbers.push_back(std::atoi(argv[i]));
+    if(particleNumbers.empty())
+        particleNumbers = {1000, 4000, 16000};
+
+    std::cout << "scene,particles,steps,steps_per_second,forces_ms,integration_ms,detection_ms,broad_phase_ms,narrow_phase_ms,resolution_ms,"
+              << "pairs_per_step,contacts_per_step,allocations_per_step" << std::endl;
+    for(size_t particleNumber : particleNumbers)
+    {
+        run("falling_box", fallingBox, particleNumber, steps, broadPhase);
+        run("hanging_cloth", hangingCloth, particleNumber, steps, broadPhase);
+        run("dense_pile", densePile, particleNumber, steps, broadPhase);
+        run("dam_break", damBreak, particleNumber, steps, broadPhase);
+        run("swarm", swarm, particleNumber, steps, broadPhase);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+#ifndef ADAPTIVE_RUNGE_KUTTA_SOLVER_HPP
+#define ADAPTIVE_RUNGE_KUTTA_SOLVER_HPP
+
+#include "Solver.hpp"
+
+/**@brief Adaptive explicit Runge-Kutta solver.
+ *
+ * Bogacki-Shampine embedded Runge-Kutta solver. Each step computes a third
+ * order and a second order solution from the same force evaluations: their
+ * difference estimates the error of the step. A step whose error is above
+ * the tolerance is rejected and computed again with a smaller step size,
+ * and the step size of the next step is chosen from the error of the last
+ * one. The last evaluation of a step is the first one of the next step, so
+ * that an accepted step costs three force evaluations.
+ *
+ * The solver integrates the whole time step it is given, with as many inner
+ * steps as the error requires, then suggests a time step to the dynamic
+ * system: calm parts of a simulation are computed with a few large steps,
+ * violent ones with many small steps.
+ *
+ * The forces are evaluated at intermediate states of the particles, with the
+ * force fields of the system. The force fields that cannot add their forces
+ * to a separate array are still supported, but slower.
+ */
+class AdaptiveRungeKuttaSolver : public Solver
+{
+public:
+    AdaptiveRungeKuttaSolver();
+    ~AdaptiveRungeKuttaSolver();
+
+    /**@brief Access to the absolute tolerance.
+     *
+     * @return The error allowed per step on positions and velocities, for
+     * values close to zero.
+     */
+    float getAbsoluteTolerance() const;
+    /**@brief Access to the relative tolerance.
+     *
+     * @return The error allowed per step on positions and velocities,
+     * relative to their magnitude.
+     */
+    float getRelativeTolerance() const;
+    /**@brief Set the tolerances.
+     *
+     * A step is accepted if, for each particle, the estimated error of its
+     * position is below absolute + relative * |position|, and the same for
+     * its velocity.
+     * @param absolute The new absolute tolerance.
+     * @param relative The new relative tolerance.
+     */
+    void setTolerance(float absolute, float relative);
+
+    /**@brief Access to the minimum step size.
+     *
+     * @return The step size below which steps are accepted whatever their error.
+     */
+    float getMinimumStep() const;
+    /**@brief Access to the maximum step size.
+     *
+     * @return The largest step size the solver suggests.
+     */
+    float getMaximumStep() const;
+    /**@brief Set the range of the step size.
+     *
+     * @param minimum The step size below which steps are accepted whatever their error.
+     * @param maximum The largest step size the solver suggests.
+     */
+    void setStepRange(float minimum, float maximum);
+
+    /**@brief Number of force evaluations.
+     *
+     * @return The number of force evaluations since the solver was built.
+     */
+    unsigned long getEvaluations() const;
+    /**@brief Number of rejected steps.
+     *
+     * @return The number of inner steps rejected since the solver was built.
+     */
+    unsigned long getRejectedSteps() const;
+
+private:
+    void do_solve(const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields);
+    float do_getSuggestedDt() const;
+
+    /**@brief Evaluate the forces at the current state of the particles. */
+    void evaluateForces(ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields,
+                        std::vector<glm::vec3>& forces);
+    /**@brief Set the state of the particles to the start of the step plus a
+     * combination of the stages. */
+    void setStage(ParticleStore& particles, float h, float a1, float a2, float a3);
+
+    float m_absoluteTolerance;
+    float m_relativeTolerance;
+    float m_minimumStep;
+    float m_maximumStep;
+    /**@brief Step size chosen for the next inner step. */
+    float m_step;
+    unsigned long m_evaluations;
+    unsigned long m_rejectedSteps;
+
+    /**@brief A non zero value for the particles moved by the solver. */
+    std::vector<unsigned char> m_moving;
+    std::vector<glm::vec3> m_startPositions;
+    std::vector<glm::vec3> m_startVelocities;
+    /**@brief Velocities at each stage, i.e. derivatives of the positions. */
+    std::vector<glm::vec3> m_stageVelocities[4];
+    /**@brief Forces at each stage, i.e. derivatives of the velocities times the masses. */
+    std::vector<glm::vec3> m_stageForces[4];
+};
+
+typedef std::shared_ptr<AdaptiveRungeKuttaSolver> AdaptiveRungeKuttaSolverPtr;
+
+#endif //ADAPTIVE_RUNGE_KUTTA_SOLVER_HPP
@@ -3,6 +3,7 @@
 
 #include "../HierarchicalRenderable.hpp"
 #include "ConstantForceField.hpp"
+#include "SimulationThread.hpp"
 
 /**@brief Render a constant force field.
  *
@@ -20,11 +21,24 @@ public:
      */
     ConstantForceFieldRenderable( ShaderProgramPtr program, ConstantForceFieldPtr forceField);
 
+    /**@brief Draw the state published by a simulation thread.
+     *
+     * When the particles are simulated on a dedicated thread, their state
+     * must not be read directly: the force is drawn at the positions of the
+     * latest snapshot of the thread instead, and read under the lock of
+     * SimulationThread::lockParameters().
+     * @param thread The thread simulating the particles, or nullptr to draw
+     * the particles directly.
+     */
+    void setSimulationThread(SimulationThreadPtr thread);
+
 private:
     void do_draw();
     void do_animate( float time );
+    glm::vec3 getPosition(const ParticlePtr& particle) const;
 
     ConstantForceFieldPtr m_forceField;
+    SimulationThreadPtr m_thread;
 
     std::vector< glm::vec3 > m_positions;
     std::vector< glm::vec4 > m_colors;
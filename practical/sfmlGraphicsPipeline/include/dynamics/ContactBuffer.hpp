@@ -0,0 +1,187 @@
+#ifndef CONTACT_BUFFER_HPP
+#define CONTACT_BUFFER_HPP
+
+#include <vector>
+#include <glm/glm.hpp>
+
+/**@brief A contact detected by a dynamic system.
+ *
+ * Plain record of a collision between a particle and another particle, a
+ * plane obstacle or a mesh obstacle. Particles are given by their index in the
+ * particle store of the system, and obstacles by their index in the set of
+ * obstacles of their kind of the system.
+ */
+struct Contact
+{
+    /**@brief Key identifying the pair of colliding objects.
+     *
+     * Contacts of two consecutive steps having the same key are the same
+     * contact, which allows to reuse the impulse of the previous step.
+     */
+    unsigned long long key;
+    /**@brief Index of the first particle. */
+    unsigned int particle1;
+    /**@brief Index of the second particle, or of the obstacle if isObstacle(). */
+    unsigned int particle2;
+    /**@brief True if this is a contact between a particle and a plane. */
+    bool isPlane;
+    /**@brief True if this is a contact between a particle and a mesh. */
+    bool isMesh;
+    /**@brief Contact normal, pointing toward the first particle. */
+    glm::vec3 normal;
+    /**@brief Inverse of the sum of the inverse masses of the two objects. */
+    float effectiveMass;
+    /**@brief Normal relative velocity to reach, from the restitution factor. */
+    float targetVelocity;
+    /**@brief Accumulated normal impulse applied to resolve this contact. */
+    float impulse;
+
+    /**@brief Check if the second object is an obstacle.
+     *
+     * @return True if the second object is a plane or a mesh, i.e. not a particle.
+     */
+    bool isObstacle() const
+    {
+        return isPlane || isMesh;
+    }
+};
+
+/**@brief A reusable buffer of contacts.
+ *
+ * This class stores the contacts detected during a simulation step as plain
+ * values in a flat array. The array of the previous step is kept, so that
+ * each new contact can be matched with the same contact of the previous step
+ * and start from its impulse (warm starting). Both arrays are reused from one
+ * step to the next: once they are large enough, no memory is allocated.
+ */
+class ContactBuffer
+{
+public:
+    ContactBuffer();
+    ~ContactBuffer();
+
+    /**@brief Start a new step of contact detection.
+     *
+     * The contacts of the current step become the previous contacts and the
+     * current set of contacts is emptied. If the particle store changed since
+     * the last step, i.e. its revision is different, the previous contacts
+     * are discarded as their indices are no longer meaningful.
+     * @param revision The revision of the particle store of the system.
+     */
+    void beginStep(unsigned long revision);
+
+    /**@brief Add a contact between two particles.
+     *
+     * @param particle1 The index of the first particle.
+     * @param particle2 The index of the second particle.
+     */
+    void addParticleParticle(unsigned int particle1, unsigned int particle2);
+    /**@brief Add a contact between a particle and a plane.
+     *
+     * @param particle The index of the particle.
+     * @param plane The index of the plane.
+     */
+    void addParticlePlane(unsigned int particle, unsigned int plane);
+    /**@brief Add a contact between a particle and a mesh.
+     *
+     * @param particle The index of the particle.
+     * @param mesh The index of the mesh.
+     */
+    void addParticleMesh(unsigned int particle, unsigned int mesh);
+
+    /**@brief Match the current contacts with the previous ones.
+     *
+     * Sort the current contacts by key and set the impulse of each of them
+     * to the impulse of the previous contact with the same key, if any, or
+     * to zero otherwise.
+     * @return The number of contacts found in the previous step.
+     */
+    size_t matchPrevious();
+
+    /**@brief Partition the current contacts into independent batches.
+     *
+     * Color the contacts with a greedy graph coloring, so that two contacts
+     * of the same color never share a movable particle. The contacts of a
+     * color can then be resolved in parallel. Fixed particles are never
+     * modified by a contact, so they can be shared.
+     * @param fixed The fixed flag of each particle of the store.
+     * @return The number of colors.
+     */
+    size_t color(const std::vector<unsigned char>& fixed);
+
+    /**@brief Access to the contacts sorted by color.
+     *
+     * The contacts of color k are listed between getColorStart()[k] and
+     * getColorStart()[k+1], as indices in getContacts(). Valid after color().
+     * @return The indices of the contacts, sorted by color.
+     */
+    const std::vector<unsigned int>& getColoredContacts() const;
+    /**@brief Access to the first entry of each color.
+     *
+     * @return The first entry of each color in getColoredContacts(), followed
+     * by the number of contacts.
+     */
+    const std::vector<unsigned int>& getColorStart() const;
+
+    /**@brief Access to the current contacts.
+     *
+     * @return The contacts of the current step.
+     */
+    std::vector<Contact>& getContacts();
+    const std::vector<Contact>& getContacts() const;
+
+    /**@brief Number of contacts of the current step.
+     *
+     * @return The number of current contacts.
+     */
+    size_t size() const;
+
+    /**@brief Replace the current contacts.
+     *
+     * Set the current contacts, e.g. from a checkpoint, so that they are
+     * used to warm start the next step. The previous contacts are discarded.
+     * @param contacts The contacts, sorted by key.
+     * @param count The number of contacts.
+     * @param revision The revision of the particle store the contacts refer to.
+     */
+    void restore(const Contact* contacts, size_t count, unsigned long revision);
+
+    /**@brief Follow a reordering of the particles.
+     *
+     * Change the particle indices of the current contacts, so that they
+     * still warm start the next step after the particle store is reordered.
+     * The previous contacts are discarded.
+     * @param newIndices The new index of each particle, indexed by its previous index.
+     * @param revision The revision of the reordered particle store.
+     */
+    void remap(const std::vector<unsigned int>& newIndices, unsigned long revision);
+
+    /**@brief Remove all contacts.
+     *
+     * Empty both the current and previous contacts.
+     */
+    void clear();
+
+    /**@brief Reserved size of the internal buffers.
+     *
+     * Used to detect the allocations of a simulation step.
+     * @param sizes The array to which the capacity of each buffer, in bytes,
+     * is appended.
+     */
+    void getBufferSizes(std::vector<size_t>& sizes) const;
+
+private:
+    std::vector<Contact> m_contacts;
+    std::vector<Contact> m_previousContacts;
+    unsigned long m_revision;
+
+    std::vector<unsigned int> m_contactColors;
+    std::vector<unsigned int> m_colorStart;
+    std::vector<unsigned int> m_coloredContacts;
+    /**@brief Colors already used by the contacts of each particle, one bit per color. */
+    std::vector<unsigned long long> m_particleColors;
+    std::vector<unsigned int> m_uncolored;
+    std::vector<unsigned int> m_remaining;
+};
+
+#endif //CONTACT_BUFFER_HPP
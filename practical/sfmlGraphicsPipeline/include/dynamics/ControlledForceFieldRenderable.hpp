@@ -3,6 +3,7 @@
 
 #include "./../../include/HierarchicalRenderable.hpp"
 #include "./../../include/dynamics/ConstantForceField.hpp"
+#include "./../../include/dynamics/SimulationThread.hpp"
 
 /**@brief Status of a ControlledForceField.
  *
@@ -61,15 +62,28 @@ public:
   ControlledForceFieldRenderable(ShaderProgramPtr program,ConstantForceFieldPtr forceField );
   ~ControlledForceFieldRenderable();
 
+  /**@brief Control a force field simulated by a simulation thread.
+   *
+   * When the particles are simulated on a dedicated thread, the worker reads
+   * the force during its steps: the new force is given to
+   * SimulationThread::post() instead of being set directly, and the arrows
+   * are drawn at the positions of the latest snapshot of the thread.
+   * @param thread The thread simulating the particles, or nullptr to control
+   * the force field directly.
+   */
+  void setSimulationThread(SimulationThreadPtr thread);
+
 private:
 
   virtual void do_keyPressedEvent( sf::Event& e );
   virtual void do_keyReleasedEvent( sf::Event& e );
   virtual void do_animate( float time );
   virtual void do_draw();
+  glm::vec3 getPosition(const ParticlePtr& particle) const;
 
   ControlledForceFieldStatus m_status;
   ConstantForceFieldPtr m_force;
+  SimulationThreadPtr m_thread;
 
   std::vector< glm::vec3 > m_positions;
   std::vector< glm::vec4 > m_colors;
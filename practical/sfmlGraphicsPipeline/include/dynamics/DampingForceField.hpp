@@ -4,6 +4,7 @@
 #include <vector>
 #include "ForceField.hpp"
 #include "Particle.hpp"
+#include "ParticleIndexCache.hpp"
 
 /**@brief Implement a damping force field.
  *
@@ -51,7 +52,17 @@ class DampingForceField : public ForceField
 
     private:
         void do_addForce();
+        bool do_addForce(const ParticleStore& store, std::vector<glm::vec3>& forces);
+        bool do_prepareRange(const ParticleStore& store);
+        void do_addForce(const ParticleStore& store, size_t begin, size_t end, std::vector<glm::vec3>& forces);
+        bool do_addJacobianProduct(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                   const std::vector<glm::vec3>& y, std::vector<glm::vec3>& out);
+        bool do_addJacobianDiagonal(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                    std::vector<glm::vec3>& diagonal);
+        void do_getParameters(std::vector<float>& parameters) const;
+        bool do_setParameters(const float* parameters, size_t count);
         std::vector<ParticlePtr> m_particles;
+        ParticleIndexCache m_indices;
         float m_damping;
 };
 
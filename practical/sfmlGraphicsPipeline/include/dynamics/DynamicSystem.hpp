@@ -1,24 +1,90 @@
 #ifndef DYNAMICSYSTEM_HPP
 #define DYNAMICSYSTEM_HPP
 
+#include <cstdint>
+#include <fstream>
+#include <string>
 #include <vector>
 
-#include "Collision.hpp"
+#include "ContactBuffer.hpp"
 #include "ForceField.hpp"
+#include "MeshObstacle.hpp"
 #include "Particle.hpp"
+#include "ParticleEmitter.hpp"
+#include "ParticleIslands.hpp"
+#include "ParticleStore.hpp"
 #include "Solver.hpp"
+#include "SpatialHashGrid.hpp"
+#include "SweepAndPrune.hpp"
+#include "Trajectory.hpp"
 #include "../Plane.hpp"
 
 /**@brief A dynamic system.
  *
- * This class represents a dynamic system made of particles, force fields and
- * fixed planes obstacles and that handle collisions. If you want to, you can
- * replace fixed planes obstacles by triangle obstacles: you will be able to
- * model more kind of obstacles. However, this would require a spatial optimization
- * that is out of the scope of these practical lessons.
+ * This class represents a dynamic system made of particles, force fields,
+ * fixed plane obstacles and fixed triangle mesh obstacles, and that handle
+ * collisions. Mesh obstacles are organized in a bounding volume hierarchy,
+ * see MeshObstacle, so that they can model arbitrary static scenery.
  */
 class DynamicSystem
 {
+public:
+    /**@brief Broad phase used to detect particle-particle collisions.
+     *
+     * This enumeration specifies how the pairs of particles that could collide
+     * are found before being tested for intersection.
+     */
+    enum COLLISION_BROAD_PHASE {
+      /** Every pair of particles is tested, in O(n^2). */
+      BRUTE_FORCE_BROAD_PHASE,
+      /** Particles are sorted in a spatial hash grid whose cell size is derived
+       * from the largest particle radius. Only particles in neighbor cells are
+       * tested, in about O(n). */
+      SPATIAL_HASH_BROAD_PHASE,
+      /** The bounding boxes of the particles are kept sorted along each axis
+       * between simulation steps, and the overlapping pairs are updated
+       * incrementally. Suited to scenes with very different particle radii
+       * and to mostly resting particles. */
+      SWEEP_AND_PRUNE_BROAD_PHASE
+    };
+
+    /**@brief Time spent in each phase of a simulation step, in seconds,
+     * and work done by the collision handling.
+     *
+     * The collision fields are zero when collisions are disabled or handled
+     * by the solver.
+     */
+    struct StepTimings
+    {
+      /** Force accumulation. */
+      double forces;
+      /** Time integration by the solver. */
+      double integration;
+      /** Collision detection, including the continuous collision detection. */
+      double detection;
+      /** Update of the broad phase structure: spatial hash grid or sorted
+       * bounds. Zero for the brute force broad phase. */
+      double broadPhase;
+      /** Obstacle tests, enumeration and test of the candidate particle pairs. */
+      double narrowPhase;
+      /** Collision resolution. */
+      double resolution;
+      /** Number of particle pairs tested for collision. */
+      size_t pairsTested;
+      /** Number of particle obstacle tests, planes and meshes. */
+      size_t obstacleTests;
+      /** Number of contacts generated. */
+      size_t contacts;
+      /** Number of contacts found in the previous step. */
+      size_t warmStartedContacts;
+      /** Number of internal buffers allocated or reallocated during the
+       * step, including the nodes of the sweep and prune pair map. The
+       * buffers of the solver and of the force fields are not tracked. */
+      size_t allocations;
+      /** Size of the buffers allocated during the step, in bytes. */
+      size_t allocatedBytes;
+    };
+
 private:
   /**@brief The set of particles managed by this system.
    *
@@ -28,18 +94,72 @@ private:
    */
     std::vector<ParticlePtr> m_particles;
 
+    /**@brief The store holding the state of the particles of this system.
+     *
+     * The state of the particles of m_particles is kept in this store,
+     * in the same order. The solver, the force fields and the collision
+     * detection directly run over its arrays.
+     */
+    ParticleStorePtr m_store;
+
     /**@brief The set of force fields influencing particles of this system.
      *
      * The force fields that influence the particles of this system.
      */
     std::vector<ForceFieldPtr> m_forceFields;
 
+    /**@brief A flag to activate/desactivate parallel force accumulation.
+     *
+     * If set to true, force fields are evaluated by several threads, each
+     * one adding forces to its own array. Those arrays are then summed.
+     */
+    bool m_parallelForces;
+    /**@brief A flag to make the parallel force accumulation deterministic.
+     *
+     * If set to true, force fields are always distributed the same way among
+     * threads, so that forces are summed in the same order at each run, for a
+     * given number of threads. Otherwise, force fields are distributed
+     * dynamically, which balances the work better.
+     */
+    bool m_deterministicForces;
+    /**@brief Force arrays of the threads.
+     *
+     * One array of forces per thread, indexed as the particle store,
+     * used by the parallel force accumulation.
+     */
+    std::vector<std::vector<glm::vec3> > m_threadForces;
+    /**@brief Force fields evaluated by the parallel force accumulation.
+     *
+     * A flag per force field, set if the force field has been evaluated
+     * in a thread force array. Other force fields are evaluated serially.
+     */
+    std::vector<unsigned char> m_parallelForceFields;
+    /**@brief Force fields evaluated block by block, in a single pass.
+     *
+     * The force fields whose force on a particle only depends on this
+     * particle, see ForceField::prepareRange(). Rebuilt at each step.
+     */
+    std::vector<ForceField*> m_blockForceFields;
+    /**@brief Force fields evaluated as a whole, after the block ones. */
+    std::vector<ForceField*> m_otherForceFields;
+
     /**@brief The set of fixed plane obstacles.
      *
      * The set of obstacles that would repel the particles after collisions.
      */
     std::vector<PlanePtr> m_planeObstacles;
 
+    /**@brief The set of fixed triangle mesh obstacles. */
+    std::vector<MeshObstaclePtr> m_meshObstacles;
+    /**@brief A non zero value for the particles touching the mesh being tested. */
+    std::vector<unsigned char> m_meshHits;
+
+    /**@brief The set of particle emitters.
+     *
+     * Emitters are updated before each simulation step.
+     */
+    std::vector<ParticleEmitterPtr> m_emitters;
+
     /**@brief The solver of the dynamic system.
      *
      * Solver of the dynamic system: update the particles positions and
@@ -56,13 +176,14 @@ private:
      */
     float m_dt;
 
-    /**@brief The set of collision events detected during a simulation step.
+    /**@brief The set of contacts detected during a simulation step.
      *
-     * Set of collision events between dynamic components during a simulation
-     * step. Those events would be resolved by updating velocities and positions
-     * of dynamic objects to avoid inter-penetration.
+     * Set of contacts between dynamic components during a simulation
+     * step. Those contacts would be resolved by updating velocities and positions
+     * of dynamic objects to avoid inter-penetration. The contacts of the
+     * previous step are kept to warm start the resolution.
      */
-    std::vector<CollisionPtr> m_collisions;
+    ContactBuffer m_contacts;
 
     /**@brief A flag to activate/desactivate collision detection.
      *
@@ -76,6 +197,127 @@ private:
      * The factor of restitution after a collision between objects.
      */
     float m_restitution;
+    /**@brief Minimal approach velocity for restitution.
+     *
+     * Collisions whose normal approach velocity is below this threshold are
+     * resolved without restitution, so that resting particles do not bounce.
+     */
+    float m_restitutionThreshold;
+
+    /**@brief The broad phase used for particle-particle collisions.
+     *
+     * The method used to find the pairs of particles to test for collision.
+     */
+    COLLISION_BROAD_PHASE m_broadPhase;
+    /**@brief The spatial hash grid of the particles.
+     *
+     * Grid built at each collision detection when m_broadPhase is set to
+     * SPATIAL_HASH_BROAD_PHASE.
+     */
+    SpatialHashGrid m_grid;
+    /**@brief The sweep and prune broad phase of the particles.
+     *
+     * Updated at each collision detection when m_broadPhase is set to
+     * SWEEP_AND_PRUNE_BROAD_PHASE. It keeps its state between simulation steps.
+     */
+    SweepAndPrune m_sweepAndPrune;
+
+    /**@brief Number of iterations of the contact resolution.
+     *
+     * Number of passes over the contacts to correct their impulses.
+     */
+    unsigned int m_collisionIterations;
+    /**@brief A flag to activate/desactivate warm starting.
+     *
+     * If set to true, the resolution of a contact found in the previous step
+     * starts from the impulse computed at the previous step, which requires
+     * less iterations for resting contacts.
+     */
+    bool m_warmStarting;
+    /**@brief A flag to activate/desactivate parallel contact resolution.
+     *
+     * If set to true, the contacts are partitioned into colors, so that no
+     * two contacts of the same color share a particle. The contacts of each
+     * color are then resolved in parallel.
+     */
+    bool m_parallelCollisions;
+    /**@brief A flag to activate/desactivate continuous collision detection.
+     *
+     * If set to true, particles moving farther than their radius in a step
+     * are swept against the plane obstacles, so that they do not go through.
+     */
+    bool m_continuousCollisions;
+    /**@brief Maximum number of plane impacts handled per particle and step. */
+    unsigned int m_maximumImpacts;
+    /**@brief Positions of the particles at the beginning of the step. */
+    std::vector<glm::vec3> m_stepStartPositions;
+
+    /**@brief A flag to activate/desactivate sleeping.
+     *
+     * If set to true, islands of particles that stay at rest long enough are
+     * put to sleep: they are skipped by the solver, the force fields and the
+     * collision detection until another particle touches them.
+     */
+    bool m_sleeping;
+    /**@brief Speed below which a particle is considered at rest. */
+    float m_sleepVelocity;
+    /**@brief Time an island must stay at rest before falling asleep. */
+    float m_sleepDelay;
+    /**@brief Time each particle has been at rest. */
+    std::vector<float> m_sleepTimers;
+    /**@brief Smoothed squared speed of each particle. */
+    std::vector<float> m_sleepMotions;
+    /**@brief Revision of the particle store the sleeping state refers to. */
+    unsigned long m_sleepRevision;
+    ParticleIslands m_islands;
+    std::vector<std::pair<unsigned int, unsigned int> > m_connections;
+    std::vector<unsigned char> m_islandExcluded;
+    /**@brief Particles of each sleeping island.
+     *
+     * Islands are woken up as a whole. Empty entries are free slots,
+     * listed in m_freeIslandSlots.
+     */
+    std::vector<std::vector<unsigned int> > m_sleepingIslands;
+    std::vector<unsigned int> m_freeIslandSlots;
+    /**@brief Sleeping island of each sleeping particle, in m_sleepingIslands. */
+    std::vector<unsigned int> m_sleepingIslandOf;
+    /**@brief Sleeping islands touched by the awake islands: the first one
+     * for each root of m_islands, then the next one for each island. */
+    std::vector<unsigned int> m_rootSlots;
+    std::vector<unsigned int> m_nextSlots;
+    /**@brief Sleeping particles touched during the collision detection. */
+    std::vector<unsigned int> m_wakeRequests;
+
+    /**@brief Number of steps between two reorderings, 0 to never reorder. */
+    unsigned int m_reorderInterval;
+    unsigned int m_stepsSinceReorder;
+    /**@brief Index in the store of each particle of m_particles.
+     *
+     * Empty as long as the store has not been reordered, i.e. while the
+     * index of each particle is its rank in m_particles.
+     */
+    std::vector<unsigned int> m_particleSlots;
+    /**@brief Morton code and index of each particle, to sort them. */
+    std::vector<uint64_t> m_mortonKeys;
+    /**@brief Previous index of each particle after a reordering. */
+    std::vector<unsigned int> m_reorder;
+    /**@brief New index of each particle, by previous index. */
+    std::vector<unsigned int> m_newIndices;
+
+    /**@brief Recorder of the trajectory, or nullptr when not recording. */
+    TrajectoryRecorderPtr m_recorder;
+    /**@brief Simulated time since the start of the recording. */
+    float m_recordingTime;
+
+    /**@brief Timings of the last simulation step. */
+    StepTimings m_lastStepTimings;
+    /**@brief Size of the internal buffers at the start and the end of the step. */
+    std::vector<size_t> m_stepStartBufferSizes;
+    std::vector<size_t> m_stepEndBufferSizes;
+    /**@brief File receiving the timings of each step, see startTimingsLog(). */
+    std::ofstream m_timingsLog;
+    /**@brief Number of steps written to the timings log. */
+    unsigned long m_loggedSteps;
 
 public:
     ~DynamicSystem();
@@ -83,7 +325,8 @@ public:
 
     /**@brief Add a particle to the system.
      *
-     * Add a particle to this dynamic system.
+     * Add a particle to this dynamic system. The state of the particle is
+     * moved to the particle store of this system.
      * @param p The particle to add to this system.
      */
     void addParticle(ParticlePtr p);
@@ -100,6 +343,34 @@ public:
      * @param planeObstacle The plane to add to this system.
      */
     void addPlaneObstacle(PlanePtr planeObstacle);
+    /**@brief Access to the plane obstacles.
+     *
+     * @return The plane obstacles of this system.
+     */
+    const std::vector<PlanePtr>& getPlaneObstacles() const;
+    /**@brief Add a mesh obstacle to the system.
+     *
+     * Add a static triangle mesh obstacle to the dynamic system. If collisions
+     * are activated, its triangles will repel particles. Mesh obstacles are
+     * handled by the collision detection of the system only: solvers handling
+     * the collisions themselves and the continuous collision detection only
+     * know about plane obstacles.
+     * @param meshObstacle The mesh to add to this system.
+     */
+    void addMeshObstacle(MeshObstaclePtr meshObstacle);
+    /**@brief Access to the mesh obstacles.
+     *
+     * @return The mesh obstacles of this system.
+     */
+    const std::vector<MeshObstaclePtr>& getMeshObstacles() const;
+    /**@brief Add a particle emitter to the system.
+     *
+     * Add all the particles of the pool of an emitter to this dynamic system,
+     * dead or alive. The emitter then spawns and kills particles before each
+     * simulation step, without adding or removing particles to the system.
+     * @param emitter The emitter to add to this system.
+     */
+    void addParticleEmitter(ParticleEmitterPtr emitter);
 
     /**@brief Access to the solver used to resolve the dynamic system.
      *
@@ -110,6 +381,10 @@ public:
     /**@brief Set a new dynamic system solver.
      *
      * Define a new solver to resolve the dynamic system at each simulation step.
+     * If the solver handles the collisions itself, the collision detection and
+     * resolution of the dynamic system are skipped and getContacts() is empty.
+     * If the solver suggests a time step, e.g. an adaptive one, the time step
+     * of the system is replaced by the suggested one after each step.
      * @param solver The new solver to use.
      */
     void setSolver(SolverPtr solver);
@@ -127,6 +402,173 @@ public:
      */
     void setCollisionsDetection(bool onOff);
 
+    /**@brief Access to the number of contact resolution iterations.
+     *
+     * Get the number of passes over the contacts done to resolve them.
+     * @return The number of contact resolution iterations.
+     */
+    unsigned int getCollisionIterations() const;
+    /**@brief Set the number of contact resolution iterations.
+     *
+     * Define the number of passes over the contacts done to resolve them.
+     * More iterations give more accurate stacks of particles.
+     * @param iterations The new number of iterations.
+     */
+    void setCollisionIterations(unsigned int iterations);
+
+    /**@brief Check if the contact resolution is warm started.
+     *
+     * @return True if the contact resolution starts from the impulses
+     * of the previous step.
+     */
+    bool getWarmStarting() const;
+    /**@brief Set the warm starting mode.
+     *
+     * Define if the resolution of the contacts starts from the impulses
+     * computed for the same contacts at the previous step.
+     * @param onOff True if the contact resolution should be warm started.
+     */
+    void setWarmStarting(bool onOff);
+
+    /**@brief Check if the contacts are resolved in parallel.
+     *
+     * @return True if the contacts are resolved by batches of independent contacts.
+     */
+    bool getParallelCollisions() const;
+    /**@brief Set the parallel contact resolution mode.
+     *
+     * Define if the contacts are resolved by batches of contacts sharing no
+     * particle, each batch being resolved in parallel. The contacts are then
+     * resolved in a different order than the sequential resolution, so the
+     * results differ slightly, but they do not depend on the number of threads.
+     * @param onOff True if the contacts should be resolved in parallel.
+     */
+    void setParallelCollisions(bool onOff);
+
+    /**@brief Check if the continuous collision detection is used.
+     *
+     * @return True if fast particles are swept against the obstacles.
+     */
+    bool getContinuousCollisions() const;
+    /**@brief Set the continuous collision detection mode.
+     *
+     * The discrete collision detection only tests the positions at the end of
+     * the step: a particle moving farther than its diameter in a step can go
+     * through an obstacle without ever overlapping it. In continuous mode, the
+     * particles moving farther than their radius are swept against the planes,
+     * and marched against the meshes by steps of their radius: at the first
+     * time of impact, the particle bounces and
+     * travels the rest of the step with its new velocity, up to a maximum
+     * number of impacts. Slower particles only pay for a distance check.
+     * @param onOff True if fast particles should be swept against the obstacles.
+     */
+    void setContinuousCollisions(bool onOff);
+
+    /**@brief Access to the maximum number of impacts.
+     *
+     * @return The maximum number of plane impacts handled per particle and step.
+     */
+    unsigned int getMaximumImpacts() const;
+    /**@brief Set the maximum number of impacts.
+     *
+     * A particle trapped between planes can hit several of them during a step.
+     * After the maximum number of impacts, it stops at the last one.
+     * @param impacts The new maximum number of plane impacts per particle and step.
+     */
+    void setMaximumImpacts(unsigned int impacts);
+
+    /**@brief Check if particles can fall asleep.
+     *
+     * @return True if islands of particles at rest are put to sleep.
+     */
+    bool getSleeping() const;
+    /**@brief Set the sleeping mode.
+     *
+     * Define if islands of particles, i.e. particles connected by springs or
+     * contacts, are put to sleep when all their particles stay slower than
+     * the sleep velocity for the sleep delay. A sleeping island is woken up
+     * when a particle faster than the sleep velocity collides with it, or when
+     * a spring links it to an awake particle. Slower particles rest on it as
+     * on fixed particles. Disabling sleeping wakes up every particle.
+     * @param onOff True if particles at rest should be put to sleep.
+     */
+    void setSleeping(bool onOff);
+
+    /**@brief Access to the sleep velocity.
+     *
+     * @return The speed below which a particle is considered at rest.
+     */
+    float getSleepVelocity() const;
+    /**@brief Set the sleep velocity.
+     *
+     * @param velocity The new speed below which a particle is considered at rest.
+     */
+    void setSleepVelocity(float velocity);
+
+    /**@brief Access to the sleep delay.
+     *
+     * @return The time an island must stay at rest before falling asleep.
+     */
+    float getSleepDelay() const;
+    /**@brief Set the sleep delay.
+     *
+     * @param delay The new time an island must stay at rest before falling asleep.
+     */
+    void setSleepDelay(float delay);
+
+    /**@brief Wake up all the particles.
+     *
+     * This should be called after moving particles by hand, since sleeping
+     * particles are not integrated.
+     */
+    void wakeUp();
+
+    /**@brief Number of sleeping particles.
+     *
+     * @return The number of particles currently asleep.
+     */
+    size_t getSleepingParticleNumber() const;
+
+    /**@brief Access to the contacts of the last step.
+     *
+     * Get the contacts detected and resolved during the last simulation step.
+     * @return The contacts of the last step.
+     */
+    const ContactBuffer& getContacts() const;
+
+    /**@brief Access to the collision broad phase.
+     *
+     * Get the method used to find the pairs of particles that could collide.
+     * @return The current broad phase.
+     */
+    COLLISION_BROAD_PHASE getBroadPhase() const;
+    /**@brief Set the collision broad phase.
+     *
+     * Define the method used to find the pairs of particles that could collide.
+     * All broad phases lead to the same set of collisions.
+     * @param broadPhase The new broad phase.
+     */
+    void setBroadPhase(const COLLISION_BROAD_PHASE& broadPhase);
+
+    /**@brief Access to the spatial hash grid of the particles.
+     *
+     * Get the grid built during the last collision detection with the
+     * SPATIAL_HASH_BROAD_PHASE broad phase. It can be queried to find the
+     * particles close to a position, indices being those of the particle store.
+     * @return The spatial hash grid of the particles.
+     */
+    const SpatialHashGrid& getSpatialHashGrid() const;
+
+    /**@brief Access to the sweep and prune broad phase.
+     *
+     * Get the sweep and prune broad phase, as updated during the last collision
+     * detection with the SWEEP_AND_PRUNE_BROAD_PHASE broad phase. It reports the
+     * pairs of particles whose bounding boxes overlap, as well as the pairs that
+     * started or stopped to overlap during the last step.
+     * @return The sweep and prune broad phase.
+     */
+    const SweepAndPrune& getSweepAndPrune() const;
+
     /**@brief Access to the set of particles of this system.
      *
      * Get the set of particles of this dynamic system.
@@ -140,6 +582,13 @@ public:
      */
     void setParticles(const std::vector<ParticlePtr> & particles);
 
+    /**@brief Access to the particle store of this system.
+     *
+     * Get the store holding the state of the particles of this system.
+     * @return The particle store of this system.
+     */
+    ParticleStorePtr getParticleStore() const;
+
     /**@brief Access to the force fields of this system.
      *
      * Get the set of force fields of this system.
@@ -153,6 +602,34 @@ public:
      */
     void setForceFields(const std::vector<ForceFieldPtr> &forceFields);
 
+    /**@brief Check if the forces are accumulated in parallel.
+     *
+     * @return True if the force fields are evaluated by several threads.
+     */
+    bool getParallelForces() const;
+    /**@brief Set the parallel force accumulation mode.
+     *
+     * Define if the force fields are evaluated by several threads. Force fields
+     * that cannot add their forces to a separate array are still evaluated
+     * serially.
+     * @param onOff True if the force fields should be evaluated in parallel.
+     */
+    void setParallelForces(bool onOff);
+
+    /**@brief Check if the parallel force accumulation is deterministic.
+     *
+     * @return True if the forces are always summed in the same order.
+     */
+    bool getDeterministicForces() const;
+    /**@brief Set the deterministic mode of the parallel force accumulation.
+     *
+     * Define if the forces computed in parallel are always summed in the
+     * same order, so that two runs with the same number of threads give
+     * exactly the same results.
+     * @param onOff True if the force accumulation should be deterministic.
+     */
+    void setDeterministicForces(bool onOff);
+
 
     /**@brief Compute a simulation step for this system.
      *
@@ -161,6 +638,107 @@ public:
      */
     void computeSimulationStep();
 
+    /**@brief Access to the timings of the last simulation step.
+     *
+     * Get the time spent in each phase of the last call to computeSimulationStep().
+     * @return The timings of the last simulation step.
+     */
+    const StepTimings& getLastStepTimings() const;
+
+    /**@brief Log the timings of each simulation step.
+     *
+     * Create a CSV file with a header line, then write a line with the
+     * timings of each following simulation step, see StepTimings. A log
+     * already started is stopped first.
+     * @param filename The path of the log file.
+     * @return False if the file could not be created, true otherwise.
+     */
+    bool startTimingsLog(const std::string& filename);
+    /**@brief Stop logging the timings of the simulation steps. */
+    void stopTimingsLog();
+    /**@brief Check if the timings of the simulation steps are logged.
+     *
+     * @return True if a timings log is started.
+     */
+    bool isLoggingTimings() const;
+
+    /**@brief Access to the reordering interval.
+     *
+     * @return The number of steps between two reorderings of the particles,
+     * 0 if they are never reordered.
+     */
+    unsigned int getReorderInterval() const;
+    /**@brief Set the reordering interval.
+     *
+     * As particles move, particles close in space end up far apart in the
+     * particle store, and the collision detection and the force fields access
+     * memory at random. Every given number of steps, the particles are sorted
+     * along a Morton curve of their positions, see reorderParticles().
+     * @param steps The number of steps between two reorderings, 0 to never
+     * reorder the particles.
+     */
+    void setReorderInterval(unsigned int steps);
+    /**@brief Reorder the particles along a Morton curve.
+     *
+     * Sort the entries of the particle store by the Morton code of their
+     * position, so that particles close in space are close in memory. Inactive
+     * particles are moved at the end. The particles keep their handles, whose
+     * index is updated, and the contacts and sleeping islands are remapped:
+     * the simulation is not affected, but the indices of the particles change.
+     * Indices cached by force fields are recomputed, see ParticleIndexCache.
+     * Checkpoints and trajectory recordings store the particles in the order
+     * they were added to the system, whatever the reorderings.
+     */
+    void reorderParticles();
+
+    /**@brief Start recording the trajectory of the particles.
+     *
+     * Write the current positions of the particles, then their positions
+     * after each simulation step, to a trajectory file, see TrajectoryRecorder.
+     * The recording stops by itself if the number of particles changes. It can
+     * be replayed with a TrajectoryPlayer, e.g. with
+     * DynamicSystemRenderable::setTrajectoryPlayer(). A recording already
+     * started is stopped first.
+     * @param filename The path of the trajectory file.
+     * @param precision The quantization step of the recorded positions.
+     * @return False if the file could not be written, true otherwise.
+     */
+    bool startRecording(const std::string& filename, float precision = 1e-4f);
+    /**@brief Stop recording the trajectory of the particles.
+     *
+     * @return False if the end of the file could not be written, true otherwise.
+     */
+    bool stopRecording();
+    /**@brief Check if the trajectory of the particles is recorded.
+     *
+     * @return True if each simulation step is recorded.
+     */
+    bool isRecording() const;
+
+    /**@brief Save the state of the system in a binary checkpoint.
+     *
+     * Write the state of the particles, the parameters of the force fields,
+     * the plane obstacles and the contacts of the last step to a file. The
+     * file is made of a header followed by raw arrays aligned on 64 bytes,
+     * so that it can be memory mapped and each array restored by a copy.
+     * @param filename The path of the checkpoint file.
+     * @return False if the file could not be written, true otherwise.
+     */
+    bool saveCheckpoint(const std::string& filename) const;
+
+    /**@brief Restore the state of the system from a binary checkpoint.
+     *
+     * Read a checkpoint written by saveCheckpoint(). The system must have
+     * been built the same way as the saved one, i.e. with the same number of
+     * particles, force fields and obstacles, in the same order: only
+     * their state is restored. Mesh obstacles are static and not saved.
+     * Contacts are restored to warm start the next simulation step.
+     * @param filename The path of the checkpoint file.
+     * @return False if the file could not be read or does not match this
+     * system, in which case the system is left unchanged. True otherwise.
+     */
+    bool loadCheckpoint(const std::string& filename);
+
     /**@brief Access to the collision restitution factor.
      *
      * Get the current collision restitution factor of this system.
@@ -174,9 +752,25 @@ public:
      */
     void setRestitution(const float &restitution);
 
+    /**@brief Access to the restitution velocity threshold.
+     *
+     * Get the normal approach velocity below which collisions do not bounce.
+     * @return The current restitution velocity threshold.
+     */
+    float getRestitutionThreshold() const;
+    /**@brief Set the restitution velocity threshold.
+     *
+     * Define the normal approach velocity below which collisions are resolved
+     * without restitution. Set it to 0 to always apply restitution.
+     * @param threshold The new restitution velocity threshold.
+     */
+    void setRestitutionThreshold(float threshold);
+
     /**@brief Access the time integration interval.
      *
-     * Get the time integration interval used by this dynamic system.
+     * Get the time integration interval used by this dynamic system. With an
+     * adaptive solver, this is the time step of the next simulation step,
+     * which can differ from the time step of the previous one.
      * @return The time integration interval.
      */
     float getDt() const;
@@ -190,13 +784,24 @@ public:
 
     /**@brief Clear the dynamic system.
      *
-     * Clear the system, i.e. empty the particles, force fields and plane obstacles.
+     * Clear the system, i.e. empty the particles, force fields and obstacles.
      */
     void clear();
 
 private:
+    void computeForces();
     void detectCollisions();
+    void detectParticleParticleCollision(size_t i, size_t j);
     void solveCollisions();
+    void solveContinuousCollisions();
+    void prepareContact(Contact& c);
+    void warmStartContact(const Contact& c);
+    void solveContact(Contact& c);
+    bool restoreCheckpoint(const char* data, size_t size);
+    void updateSleeping();
+    void wakeIsland(unsigned int particle);
+    void getBufferSizes(std::vector<size_t>& sizes) const;
+    void writeTimingsLog();
 };
 
 typedef std::shared_ptr<DynamicSystem> DynamicSystemPtr;
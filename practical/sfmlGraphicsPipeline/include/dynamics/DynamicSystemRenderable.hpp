@@ -4,6 +4,8 @@
 #include <vector>
 
 #include "DynamicSystem.hpp"
+#include "SimulationThread.hpp"
+#include "Trajectory.hpp"
 #include "../HierarchicalCylinderRenderable.hpp"
 
 /**@brief A little hack to incorporate the dynamic system.
@@ -35,15 +37,101 @@ public:
      */
     void setDynamicSystem(const DynamicSystemPtr &system);
 
+    /**@brief Access to the maximum number of simulation steps per frame.
+     *
+     * @return The maximum number of simulation steps computed by do_animate().
+     */
+    unsigned int getMaximumSubsteps() const;
+    /**@brief Set the maximum number of simulation steps per frame.
+     *
+     * When a frame takes more time than this number of simulation steps,
+     * the simulation is not able to keep up: the remaining time is dropped
+     * and the simulation slows down, instead of taking even more steps at
+     * the next frame.
+     * @param substeps The new maximum number of simulation steps per frame.
+     */
+    void setMaximumSubsteps(unsigned int substeps);
+
+    /**@brief Access to the interpolation factor between the last two states.
+     *
+     * The simulation time lags behind the frame time by a fraction of a time
+     * step. This fraction is the factor to blend the state before the last
+     * simulation step with the current one: the state displayed at this frame
+     * is previous * (1 - alpha) + current * alpha.
+     * @return The interpolation factor, in [0, 1).
+     */
+    float getInterpolationAlpha() const;
+
+    /**@brief Access to the positions before the last simulation step.
+     *
+     * @return The particle positions before the last simulation step,
+     * indexed as the particle store of the system.
+     */
+    const std::vector<glm::vec3>& getPreviousPositions() const;
+
+    /**@brief Get the position of a particle to display.
+     *
+     * Blend the position of a particle before and after the last simulation
+     * step with the interpolation factor.
+     * @param index The index of the particle in the particle store of the system.
+     * @return The interpolated position of the particle.
+     */
+    glm::vec3 getInterpolatedPosition(size_t index) const;
+
+    /**@brief Check if the system is simulated on a dedicated thread.
+     *
+     * @return True if the simulation steps are computed by a simulation thread.
+     */
+    bool isAsynchronous() const;
+    /**@brief Set if the system is simulated on a dedicated thread.
+     *
+     * When asynchronous, do_animate() does not compute the simulation steps
+     * anymore: it gives the elapsed time to a SimulationThread and takes the
+     * latest state it published. Give getSimulationThread() to the particle,
+     * spring and force field renderables so that they draw this state. The
+     * system must not be modified directly while the thread runs, see
+     * SimulationThread: the thread is stopped while the key events are
+     * handled, including by the children.
+     * @param onOff True to simulate the system on a dedicated thread.
+     */
+    void setAsynchronous(bool onOff);
+    /**@brief Access to the simulation thread.
+     *
+     * @return The thread simulating the system, or nullptr when not asynchronous.
+     */
+    const SimulationThreadPtr& getSimulationThread() const;
+
+    /**@brief Replay a recorded trajectory instead of simulating the system.
+     *
+     * While a player is set, do_animate() does not compute any simulation
+     * step: it moves the player to the frame recorded at the elapsed time,
+     * from the first frame. Give the same player to the particle and spring
+     * renderables so that they draw its frames: the player places the
+     * recorded particles at their index in the store of the system, see
+     * TrajectoryPlayer::setSlots(). F5 restarts the replay.
+     * @param player The player of the trajectory, or nullptr to simulate the
+     * system again. A player without an opened recording is rejected, and the
+     * previous player is kept.
+     */
+    void setTrajectoryPlayer(TrajectoryPlayerPtr player);
+    /**@brief Access to the trajectory player.
+     *
+     * @return The player replaying a trajectory, or nullptr when simulating.
+     */
+    const TrajectoryPlayerPtr& getTrajectoryPlayer() const;
+
 private:
     void do_draw();
     /**@brief Update the dynamic system.
      *
      * This function will update the managed dynamic system, i.e. compute the
-     * new positions and velocities of the particles. This update will be
-     * actually done only if the last time the system was updated was more
-     * than m_sytem->m_dt ago. This allows us to update the dynamic system
-     * at the specified time interval.
+     * new positions and velocities of the particles. The time elapsed since
+     * the last frame is accumulated, and as many steps of m_system->m_dt as
+     * fit in the accumulated time are computed, up to m_maximumSubsteps.
+     * This way, the simulation runs at the same speed whatever the frame rate.
+     * When asynchronous, the elapsed time is given to the simulation thread
+     * instead. When replaying a trajectory, the player is moved to the
+     * frame at the replay time instead.
      */
     void do_animate( float time );
 
@@ -53,12 +141,14 @@ private:
      * If the key T is pressed, particles are titled in random directions.
      * If the key F5 is pressed, the particles are restarted.
      * Other key pressed are transmitted to the children of this renderable.
+     * When asynchronous, the simulation thread is stopped meanwhile.
      * @param e A key pressed event.
      */
     void do_keyPressedEvent(sf::Event& e);
     /**@brief Transmit a key released event to children.
      *
      * Transmit a key released event to the children of this renderable.
+     * When asynchronous, the simulation thread is stopped meanwhile.
      */
     void do_keyReleasedEvent(sf::Event& e);
 
@@ -74,6 +164,22 @@ private:
      * keep updating the dynamic system at the specified time interval.
      */
     float m_lastUpdateTime;
+    /**@brief Accumulated time not simulated yet.
+     *
+     * Time elapsed since the last frame plus the remainder of the previous
+     * frames, less than a time step after do_animate().
+     */
+    float m_accumulator;
+    /**@brief Maximum number of simulation steps per frame. */
+    unsigned int m_maximumSubsteps;
+    /**@brief Particle positions before the last simulation step. */
+    std::vector<glm::vec3> m_previousPositions;
+    /**@brief Thread simulating the system when asynchronous. */
+    SimulationThreadPtr m_thread;
+    /**@brief Player of the replayed trajectory, if any. */
+    TrajectoryPlayerPtr m_player;
+    /**@brief Time elapsed since the start of the replay. */
+    float m_playbackTime;
 };
 
 typedef std::shared_ptr<DynamicSystemRenderable> DynamicSystemRenderablePtr;
@@ -0,0 +1,83 @@
+#ifndef ENSEMBLE_RUNNER_HPP
+#define ENSEMBLE_RUNNER_HPP
+
+#include <memory>
+#include <vector>
+
+#include "DynamicSystem.hpp"
+
+/**@brief Step many independent dynamic systems together.
+ *
+ * A parameter sweep simulates many copies of a scene that only differ by
+ * a few parameters, e.g. the restitution, the damping or the stiffness.
+ * Each copy is small: stepping them one after the other leaves most threads
+ * idle, since a small system is not worth splitting among threads. The
+ * ensemble runner instead gives whole systems to the threads: each thread
+ * computes several steps of its systems before synchronizing with the others.
+ *
+ * The systems of an ensemble must have the same topology, i.e. the same
+ * number of particles, force fields and obstacles, so that their results
+ * can be compared entry by entry. They must not share any particle, force
+ * field or solver, since they are stepped concurrently.
+ */
+class EnsembleRunner
+{
+public:
+    EnsembleRunner();
+    ~EnsembleRunner();
+
+    /**@brief Add a system to the ensemble.
+     *
+     * @param system The system to add, with the same topology as the systems
+     * already in the ensemble.
+     * @return False if the system has no solver or a different topology, in
+     * which case it is not added. True otherwise.
+     */
+    bool addSystem(DynamicSystemPtr system);
+    /**@brief Access to the systems of the ensemble.
+     *
+     * @return The systems, in the order they were added.
+     */
+    const std::vector<DynamicSystemPtr>& getSystems() const;
+    /**@brief Number of systems of the ensemble.
+     *
+     * @return The number of systems.
+     */
+    size_t size() const;
+    /**@brief Remove all the systems of the ensemble. */
+    void clear();
+
+    /**@brief Access to the number of threads.
+     *
+     * @return The number of threads stepping the systems, 0 to use as many
+     * threads as OpenMP provides.
+     */
+    unsigned int getThreadNumber() const;
+    /**@brief Set the number of threads.
+     *
+     * @param threadNumber The number of threads stepping the systems, 0 to
+     * use as many threads as OpenMP provides.
+     */
+    void setThreadNumber(unsigned int threadNumber);
+
+    /**@brief Compute simulation steps of all the systems.
+     *
+     * Each system computes the given number of steps with its own time step.
+     * The systems are distributed among the threads, and a thread computes
+     * all the steps of a system before taking the next one. The parallel
+     * parts of a system, e.g. the parallel force accumulation, run on the
+     * thread of the system, even if nested parallelism is enabled. With a
+     * single thread, the systems are stepped one after the other and keep
+     * their own parallelism.
+     * @param steps The number of steps of each system.
+     */
+    void step(unsigned int steps = 1);
+
+private:
+    std::vector<DynamicSystemPtr> m_systems;
+    unsigned int m_threadNumber;
+};
+
+typedef std::shared_ptr<EnsembleRunner> EnsembleRunnerPtr;
+
+#endif //ENSEMBLE_RUNNER_HPP
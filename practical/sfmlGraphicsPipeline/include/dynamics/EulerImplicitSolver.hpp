@@ -0,0 +1,85 @@
+#ifndef EULER_IMPLICIT_SOLVER_HPP
+#define EULER_IMPLICIT_SOLVER_HPP
+
+#include "Solver.hpp"
+
+/**@brief Implicit Euler solver.
+ *
+ * Linearized implicit (backward) Euler dynamic system solver. The velocity
+ * change dv of a time step is the solution of the linear system
+ *
+ *     (M - dt * dF/dv - dt^2 * dF/dx) dv = dt * (F + dt * dF/dx * v)
+ *
+ * where M is the mass matrix, F the forces of the particles and dF/dx, dF/dv
+ * the derivatives of the forces given by the force fields. This system is
+ * solved by a conjugate gradient with a Jacobi preconditioner. The matrix is
+ * never built: the conjugate gradient only needs its products with vectors,
+ * which are computed by the force fields.
+ *
+ * Stiff springs remain stable with much larger time steps than with the
+ * explicit Euler solver. Force fields that do not provide their derivatives
+ * are still taken into account, but explicitly.
+ */
+class EulerImplicitSolver : public Solver
+{
+public:
+    EulerImplicitSolver();
+    ~EulerImplicitSolver();
+
+    /**@brief Access to the maximum number of conjugate gradient iterations.
+     *
+     * @return The maximum number of iterations of a solve.
+     */
+    unsigned int getMaximumIterations() const;
+    /**@brief Set the maximum number of conjugate gradient iterations.
+     *
+     * @param iterations The new maximum number of iterations of a solve.
+     */
+    void setMaximumIterations(unsigned int iterations);
+
+    /**@brief Access to the tolerance of the conjugate gradient.
+     *
+     * @return The tolerance on the residual, relative to the right hand side.
+     */
+    float getTolerance() const;
+    /**@brief Set the tolerance of the conjugate gradient.
+     *
+     * The conjugate gradient stops when the norm of the residual is below
+     * tolerance times the norm of the right hand side.
+     * @param tolerance The new relative tolerance.
+     */
+    void setTolerance(float tolerance);
+
+    /**@brief Number of iterations of the last solve.
+     *
+     * @return The number of conjugate gradient iterations of the last time step.
+     */
+    unsigned int getLastIterations() const;
+
+private:
+    void do_solve(const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields);
+
+    /**@brief Compute the product of the system matrix with a vector.
+     *
+     * Compute out = (M - dt * dF/dv - dt^2 * dF/dx) y, with zero entries
+     * for fixed particles.
+     */
+    void multiply(float dt, const ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields,
+                  const std::vector<glm::vec3>& y, std::vector<glm::vec3>& out) const;
+
+    unsigned int m_maximumIterations;
+    float m_tolerance;
+    unsigned int m_lastIterations;
+
+    std::vector<glm::vec3> m_rhs;
+    std::vector<glm::vec3> m_deltaVelocities;
+    std::vector<glm::vec3> m_residual;
+    std::vector<glm::vec3> m_preconditioned;
+    std::vector<glm::vec3> m_direction;
+    std::vector<glm::vec3> m_product;
+    std::vector<glm::vec3> m_inverseDiagonal;
+};
+
+typedef std::shared_ptr<EulerImplicitSolver> EulerImplicitSolverPtr;
+
+#endif //EULER_IMPLICIT_SOLVER_HPP
@@ -2,6 +2,32 @@
 #define FORCE_FIELD_HPP
 
 #include <memory>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ParticleStore.hpp"
+
+/**@brief A distance constraint between two particles.
+ *
+ * The position based counterpart of a damped spring: instead of applying a
+ * force proportional to the elongation, position based solvers move the
+ * particles to reach the rest length, more or less strictly according to
+ * the compliance.
+ */
+struct DistanceConstraint
+{
+    /**@brief Index of the first particle in the particle store. */
+    unsigned int particle1;
+    /**@brief Index of the second particle in the particle store. */
+    unsigned int particle2;
+    /**@brief Distance to keep between the two particles. */
+    float restLength;
+    /**@brief Inverse of the stiffness, zero for an inextensible constraint. */
+    float compliance;
+    /**@brief Damping of the relative velocity along the constraint. */
+    float damping;
+};
 
 /**@brief Force field interface.
  *
@@ -19,6 +45,120 @@ public:
    * Add a force to the particles influenced by this force field.
    */
   void addForce();
+
+  /**@brief Add a force to particles, in a separate force array.
+   *
+   * Add the force of this field to an array of forces indexed as a particle
+   * store, instead of adding it to the particles themselves. This allows
+   * several threads to evaluate force fields at the same time, each one in
+   * its own array. This is only possible if the particles influenced by this
+   * force field are all stored in the given store.
+   * @param store The particle store of the influenced particles.
+   * @param forces The array of forces to add to, of the size of the store.
+   * @return True if the force was added, false if the force field cannot
+   * do it and addForce() should be called instead.
+   */
+  bool addForce(const ParticleStore& store, std::vector<glm::vec3>& forces);
+
+  /**@brief Prepare the force field to add forces to ranges of particles.
+   *
+   * Some force fields compute the force of each particle from the state of
+   * this particle only, e.g. gravity or damping. The dynamic system adds the
+   * forces of those fields to a block of particles one after the other, then
+   * moves to the next block, so that the whole store is read and written
+   * once for all of them instead of once per force field.
+   * @param store The particle store of the influenced particles.
+   * @return True if addForce(store, begin, end, forces) can be used, false
+   * if the force field must be evaluated as a whole.
+   */
+  bool prepareRange(const ParticleStore& store);
+
+  /**@brief Add a force to a range of particles, in a separate force array.
+   *
+   * Add the force of this field to the influenced particles whose indices
+   * in the store are in [begin, end). Only valid if prepareRange() returned
+   * true and the store has not changed since.
+   * @param store The particle store of the influenced particles.
+   * @param begin The first index of the range.
+   * @param end The index after the last one of the range.
+   * @param forces The array of forces to add to, of the size of the store.
+   */
+  void addForce(const ParticleStore& store, size_t begin, size_t end, std::vector<glm::vec3>& forces);
+
+  /**@brief Add the product of the force derivatives with a vector.
+   *
+   * Add (stiffnessFactor * dF/dx + dampingFactor * dF/dv) * y to out, where
+   * F is the force of this field and x, v the positions and velocities of
+   * the particles of the store. The derivatives are never built as a matrix:
+   * implicit solvers only need their products with vectors.
+   * @param store The particle store of the influenced particles.
+   * @param stiffnessFactor The factor of the derivative with respect to positions.
+   * @param dampingFactor The factor of the derivative with respect to velocities.
+   * @param y The vector to multiply, indexed as the store.
+   * @param out The vector to add the product to, indexed as the store.
+   * @return True if the product was added, false if the force field does
+   * not provide its derivatives. It should then be integrated explicitly.
+   */
+  bool addJacobianProduct(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                          const std::vector<glm::vec3>& y, std::vector<glm::vec3>& out);
+
+  /**@brief Add the diagonal of the force derivatives.
+   *
+   * Add the diagonal of (stiffnessFactor * dF/dx + dampingFactor * dF/dv)
+   * to a vector, e.g. to build a Jacobi preconditioner.
+   * @param store The particle store of the influenced particles.
+   * @param stiffnessFactor The factor of the derivative with respect to positions.
+   * @param dampingFactor The factor of the derivative with respect to velocities.
+   * @param diagonal The diagonal to add to, indexed as the store.
+   * @return True if the diagonal was added, false if the force field does
+   * not provide its derivatives.
+   */
+  bool addJacobianDiagonal(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                           std::vector<glm::vec3>& diagonal);
+
+  /**@brief Get the pairs of particles connected by this force field.
+   *
+   * Append the pairs of particles whose motions are bound together by this
+   * force field, e.g. the two particles of a spring, as indices in a particle
+   * store. The dynamic system uses them to group particles into islands that
+   * fall asleep together.
+   * @param store The particle store of the influenced particles.
+   * @param connections The array to append the pairs to.
+   */
+  void getConnections(const ParticleStore& store,
+                      std::vector<std::pair<unsigned int, unsigned int> >& connections);
+
+  /**@brief Get the distance constraints equivalent to this force field.
+   *
+   * Append the distance constraints equivalent to the force of this field,
+   * e.g. one constraint per spring, as indices in a particle store. Position
+   * based solvers enforce those constraints instead of applying the force.
+   * @param store The particle store of the influenced particles.
+   * @param constraints The array to append the constraints to.
+   * @return True if the constraints replace the force of this field, false if
+   * the force field cannot be expressed as distance constraints and its force
+   * should be applied instead.
+   */
+  bool getDistanceConstraints(const ParticleStore& store, std::vector<DistanceConstraint>& constraints);
+
+  /**@brief Get the parameters of this force field.
+   *
+   * Append the parameters of this force field (e.g. stiffness, damping) to
+   * an array of floats, e.g. to save them in a checkpoint. The particles
+   * influenced by the force field are not part of its parameters.
+   * @param parameters The array to append the parameters to.
+   */
+  void getParameters(std::vector<float>& parameters) const;
+
+  /**@brief Set the parameters of this force field.
+   *
+   * Set the parameters of this force field from an array of floats, in the
+   * order given by getParameters().
+   * @param parameters The parameters of the force field.
+   * @param count The number of parameters.
+   * @return False if the number of parameters does not match this force field.
+   */
+  bool setParameters(const float* parameters, size_t count);
 private:
   /**@brief Add force implementation.
    *
@@ -26,6 +166,74 @@ private:
    * This should be implemented in derived classes.
    */
   virtual void do_addForce() = 0;
+
+  /**@brief Add force to a separate array implementation.
+   *
+   * The actual implementation to add force to an array of forces indexed
+   * as a particle store. The default implementation returns false, i.e.
+   * the derived class only supports addForce().
+   * @param store The particle store of the influenced particles.
+   * @param forces The array of forces to add to.
+   * @return True if the force was added.
+   */
+  virtual bool do_addForce(const ParticleStore& store, std::vector<glm::vec3>& forces);
+
+  /**@brief Prepare range implementation.
+   *
+   * The default implementation returns false, i.e. the force of a particle
+   * may depend on other particles.
+   */
+  virtual bool do_prepareRange(const ParticleStore& store);
+
+  /**@brief Add force to a range implementation.
+   *
+   * The default implementation does nothing. It must be implemented by the
+   * derived classes whose do_prepareRange() returns true.
+   */
+  virtual void do_addForce(const ParticleStore& store, size_t begin, size_t end, std::vector<glm::vec3>& forces);
+
+  /**@brief Force derivatives product implementation.
+   *
+   * The default implementation returns false, i.e. the derived class does
+   * not provide its derivatives.
+   */
+  virtual bool do_addJacobianProduct(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                     const std::vector<glm::vec3>& y, std::vector<glm::vec3>& out);
+
+  /**@brief Force derivatives diagonal implementation.
+   *
+   * The default implementation returns false, i.e. the derived class does
+   * not provide its derivatives.
+   */
+  virtual bool do_addJacobianDiagonal(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                      std::vector<glm::vec3>& diagonal);
+
+  /**@brief Get connections implementation.
+   *
+   * The default implementation appends nothing, i.e. the force field
+   * applies to each particle independently.
+   */
+  virtual void do_getConnections(const ParticleStore& store,
+                                 std::vector<std::pair<unsigned int, unsigned int> >& connections);
+
+  /**@brief Get distance constraints implementation.
+   *
+   * The default implementation returns false, i.e. the force field is not
+   * made of distance constraints.
+   */
+  virtual bool do_getDistanceConstraints(const ParticleStore& store, std::vector<DistanceConstraint>& constraints);
+
+  /**@brief Get parameters implementation.
+   *
+   * The default implementation appends nothing.
+   */
+  virtual void do_getParameters(std::vector<float>& parameters) const;
+
+  /**@brief Set parameters implementation.
+   *
+   * The default implementation only accepts an empty set of parameters.
+   */
+  virtual bool do_setParameters(const float* parameters, size_t count);
 };
 
 typedef std::shared_ptr<ForceField> ForceFieldPtr;
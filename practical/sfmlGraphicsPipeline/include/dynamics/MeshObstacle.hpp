@@ -0,0 +1,113 @@
+#ifndef MESH_OBSTACLE_HPP
+#define MESH_OBSTACLE_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**@brief A static triangle mesh obstacle.
+ *
+ * Particles collide with the triangles of the mesh as they do with plane
+ * obstacles. The triangles are organized once, at construction, in a bounding
+ * volume hierarchy built with the surface area heuristic (SAH): a query only
+ * visits the few nodes whose box is close to the particle.
+ *
+ * Like planes, triangles are one-sided: a particle whose center is behind the
+ * triangle closest to it, i.e. on the side opposite to its normal, is pushed
+ * back to the front side. The normal of a triangle follows the counter
+ * clockwise order of its vertices, as in OpenGL.
+ *
+ * The hierarchy is never modified after construction, so queries can run
+ * in parallel.
+ */
+class MeshObstacle
+{
+public:
+    /**@brief Build a mesh obstacle from triangles.
+     *
+     * @param positions The vertex positions.
+     * @param indices The vertex indices of the triangles, three per triangle.
+     */
+    MeshObstacle(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices);
+    ~MeshObstacle();
+
+    /**@brief Build a mesh obstacle from an OBJ file.
+     *
+     * @param filename The path to the OBJ file.
+     * @return The mesh obstacle, or nullptr if the file cannot be read.
+     */
+    static std::shared_ptr<MeshObstacle> fromObj(const std::string& filename);
+
+    /**@brief Find the contact of a sphere with the mesh.
+     *
+     * Find the point of the mesh closest to the center of a sphere, among the
+     * points closer than its radius.
+     * @param center The center of the sphere.
+     * @param radius The radius of the sphere.
+     * @param normal The contact normal, pointing toward the front side of the
+     * mesh, set if there is a contact.
+     * @param distance The signed distance of the center to the mesh along the
+     * normal, negative if the center is behind the mesh, set if there is a contact.
+     * @return True if the sphere touches the mesh.
+     */
+    bool findContact(const glm::vec3& center, float radius, glm::vec3& normal, float& distance) const;
+
+    /**@brief Access to the number of triangles.
+     *
+     * @return The number of triangles of the mesh.
+     */
+    size_t getTriangleNumber() const;
+    /**@brief Access to the number of nodes of the hierarchy.
+     *
+     * @return The number of nodes of the bounding volume hierarchy.
+     */
+    size_t getNodeNumber() const;
+    /**@brief Access to the lower corner of the mesh bounding box.
+     *
+     * @return The lower corner of the bounding box of the mesh.
+     */
+    const glm::vec3& getMinimum() const;
+    /**@brief Access to the upper corner of the mesh bounding box.
+     *
+     * @return The upper corner of the bounding box of the mesh.
+     */
+    const glm::vec3& getMaximum() const;
+
+private:
+    /**@brief A node of the hierarchy.
+     *
+     * The first child of an inner node is the next node in the array. Leaves
+     * have a non zero count of triangles, starting at first.
+     */
+    struct Node
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+        /**@brief First triangle of a leaf, or second child of an inner node. */
+        unsigned int first;
+        /**@brief Number of triangles of a leaf, zero for an inner node. */
+        unsigned int count;
+    };
+
+    /**@brief Build the subtree of the triangles order[begin, end), in depth first order.
+     *
+     * The triangles of each leaf are moved contiguously in order. */
+    void build(std::vector<unsigned int>& order, unsigned int begin, unsigned int end, unsigned int depth);
+    /**@brief Squared distance from a point to the box of a node. */
+    float boxDistance2(const Node& node, const glm::vec3& point) const;
+
+    /**@brief Triangle vertices, three per triangle, in the order of the leaves. */
+    std::vector<glm::vec3> m_vertices;
+    /**@brief Unit normal of each triangle. */
+    std::vector<glm::vec3> m_normals;
+    /**@brief Centroid of each triangle, to sort them during the construction. */
+    std::vector<glm::vec3> m_centroids;
+    std::vector<Node> m_nodes;
+    glm::vec3 m_minimum;
+    glm::vec3 m_maximum;
+};
+
+typedef std::shared_ptr<MeshObstacle> MeshObstaclePtr;
+
+#endif //MESH_OBSTACLE_HPP
@@ -0,0 +1,167 @@
+#ifndef NBODY_FORCE_FIELD_HPP
+#define NBODY_FORCE_FIELD_HPP
+
+#include <cstdint>
+#include <vector>
+#include "ForceField.hpp"
+#include "Particle.hpp"
+#include "ParticleIndexCache.hpp"
+
+/**@brief Implement the mutual attraction of a set of particles.
+ *
+ * This class models a gravitational attraction between every pair of
+ * particles of a set: particle i is pulled towards particle j by the force
+ * G * mi * mj * d / (|d|^2 + softening^2)^(3/2), where d goes from i to j.
+ * A negative constant G turns the attraction into a repulsion.
+ *
+ * Summing over all the pairs would cost O(n^2). Instead, the Barnes-Hut
+ * method approximates a group of far away particles by a single particle
+ * at their center of mass, with their total mass. The groups are the cells
+ * of an octree built at each step: a cell of size s, whose center of mass
+ * is at distance r from the sphere bounding a leaf of the octree, is used as
+ * a whole for the particles of this leaf when s < theta * r. Otherwise, its
+ * children are visited. The accuracy theta trades the error for the speed:
+ * 0 visits every particle, about 0.5 is a usual compromise, and the cost of
+ * a step is about O(n log n) for any positive value.
+ *
+ * The particles are sorted along a Morton curve, so that each cell of the
+ * octree is a contiguous range of sorted particles. The octree is built one
+ * level at a time, the cells of a level being split in parallel, then the
+ * masses are summed from the leaves to the root. Finally, the particles of
+ * each leaf visit the octree together, the leaves in parallel. The mass of
+ * a particle is the inverse of its inverse mass: particles of infinite mass
+ * do not attract the others.
+ */
+class NBodyForceField : public ForceField
+{
+    public:
+        /**@brief Build a new attraction between particles.
+         *
+         * @param particles The particles attracting each other, each one appearing once.
+         * @param gravitationalConstant The factor of the force.
+         * @param softening The distance added to the distance between two
+         * particles, so that the force stays bounded when they get close.
+         * @param theta The accuracy of the approximation, see setTheta().
+         */
+        NBodyForceField(const std::vector<ParticlePtr>& particles, float gravitationalConstant,
+                        float softening, float theta = 0.5f);
+
+        /**@brief Access to the particles of the field.
+         *
+         * @return The particles attracting each other.
+         */
+        const std::vector<ParticlePtr>& getParticles() const;
+        /**@brief Define the particles of the field.
+         *
+         * @param particles The new particles attracting each other.
+         */
+        void setParticles(const std::vector<ParticlePtr>& particles);
+
+        /**@brief Access to the gravitational constant.
+         *
+         * @return The factor of the force.
+         */
+        float getGravitationalConstant() const;
+        /**@brief Set the gravitational constant.
+         *
+         * @param gravitationalConstant The new factor of the force.
+         */
+        void setGravitationalConstant(float gravitationalConstant);
+
+        /**@brief Access to the softening length.
+         *
+         * @return The distance added to the distance between two particles.
+         */
+        float getSoftening() const;
+        /**@brief Set the softening length.
+         *
+         * @param softening The new distance added to the distance between two particles.
+         */
+        void setSoftening(float softening);
+
+        /**@brief Access to the accuracy of the approximation.
+         *
+         * @return The opening criterion of the cells.
+         */
+        float getTheta() const;
+        /**@brief Set the accuracy of the approximation.
+         *
+         * A cell is approximated by its center of mass when its size is less
+         * than theta times its distance to the particles. Smaller values are
+         * more accurate and slower, 0 computes the exact sum over all pairs.
+         * @param theta The new opening criterion of the cells.
+         */
+        void setTheta(float theta);
+
+        /**@brief Number of cells of the octree.
+         *
+         * @return The number of cells of the octree built by the last
+         * evaluation of the force.
+         */
+        size_t getCellNumber() const;
+
+    private:
+        void do_addForce();
+        bool do_addForce(const ParticleStore& store, std::vector<glm::vec3>& forces);
+        void do_getParameters(std::vector<float>& parameters) const;
+        bool do_setParameters(const float* parameters, size_t count);
+
+        /**@brief Sort the particles along a Morton curve.
+         *
+         * Fill m_order, m_codes, m_sortedPositions and m_sortedMasses with
+         * the active particles of the field.
+         * @param store The particle store of the field.
+         * @return The edge length of the cube containing the particles.
+         */
+        float sortParticles(const ParticleStore& store);
+
+        /**@brief Build the octree of the sorted particles.
+         *
+         * @param size The edge length of the root cell.
+         */
+        void buildTree(float size);
+
+        /**@brief A cell of the octree.
+         *
+         * The cell contains the sorted particles in [begin, end). Its
+         * children, if any, are stored contiguously from firstChild.
+         */
+        struct Cell
+        {
+            glm::vec3 centerOfMass;
+            float mass;
+            float size;
+            unsigned int begin;
+            unsigned int end;
+            unsigned int firstChild;
+            unsigned int childNumber;
+        };
+
+        std::vector<ParticlePtr> m_particles;
+        ParticleIndexCache m_indices;
+
+        float m_gravitationalConstant;
+        float m_softening;
+        float m_theta;
+
+        /**@brief Store index of the sorted particles. */
+        std::vector<unsigned int> m_order;
+        /**@brief Morton code of the sorted particles. */
+        std::vector<uint64_t> m_codes;
+        /**@brief Morton code and store index of each particle, to sort them. */
+        std::vector<std::pair<uint64_t, unsigned int> > m_keys;
+        std::vector<glm::vec3> m_sortedPositions;
+        std::vector<float> m_sortedMasses;
+
+        /**@brief The cells of the octree, sorted by level. */
+        std::vector<Cell> m_cells;
+        /**@brief First cell of each level in m_cells, followed by the number of cells. */
+        std::vector<unsigned int> m_levelStart;
+        /**@brief First child of each cell of a level, relative to the first
+         * child of the level, followed by the number of children of the level. */
+        std::vector<unsigned int> m_childOffsets;
+};
+
+typedef std::shared_ptr<NBodyForceField> NBodyForceFieldPtr;
+
+#endif // NBODY_FORCE_FIELD_HPP
@@ -5,6 +5,8 @@
 #include <memory>
 #include <glm/glm.hpp>
 
+#include "ParticleStore.hpp"
+
 /**@brief Represent a particle as a moving ball.
  *
  * This class is used to model particles in a dynamic system.
@@ -12,6 +14,12 @@
  * a position. This ball is affected by forces that will change
  * both its position and its velocity. This ball can be fixed,
  * making its position constant and its velocity null.
+ *
+ * The state of the particle is not stored in this object, but in an
+ * entry of a ParticleStore. A new particle owns a store of its own; when
+ * it is added to a dynamic system, its state is moved to the store of the
+ * system and this object becomes a handle to it. A particle should thus
+ * belong to a single dynamic system at a time.
  */
 class Particle
 {
@@ -70,6 +78,12 @@ public:
    * @return True if the particle is fixed.
    */
   bool isFixed() const;
+  /**@brief Check if this particle is active.
+   *
+   * Inactive particles are free slots, e.g. dead particles of an emitter.
+   * @return True if the particle is active.
+   */
+  bool isActive() const;
 
   /**@brief Set the particle's position.
    *
@@ -101,6 +115,12 @@ public:
    * @param isFixed The new value of the fixed flag.
    */
   void setFixed(bool isFixed);
+  /**@brief Set the particle's active flag.
+   *
+   * Inactive particles are neither tested for collisions nor drawn.
+   * @param isActive The new value of the active flag.
+   */
+  void setActive(bool isActive);
 
   /**@brief Increment the particle's position.
    *
@@ -130,49 +150,54 @@ public:
    */
   void restart();
 
-private:
-  /**@brief The initial particle's position.
+  /**@brief Access to the store holding this particle's state.
    *
-   * The initial position of this particle, stored to be set at restart.
+   * Get the particle store in which the state of this particle is kept.
+   * @return The store of this particle.
    */
-  const glm::vec3 m_initialPosition;
-  /**@brief The initial particle's velocity.
+  const ParticleStorePtr& getStore() const;
+  /**@brief Access to this particle's index in its store.
    *
-   * The initial velocity of this particle, stored to be set at restart.
+   * Get the index of this particle's entry in its store.
+   * @return The index of this particle in its store.
    */
-  const glm::vec3 m_initialVelocity;
-
-  /**@brief The particle's position.
-   *
-   * The position of this particle.
-   */
-  glm::vec3 m_position;
-  /**@brief The particle's velocity.
+  size_t getIndex() const;
+  /**@brief Change this particle's index in its store.
    *
-   * The position of this particle.
+   * Used when the entries of the store are reordered, e.g. by
+   * DynamicSystem::reorderParticles(): the state of this particle must
+   * already be at the new index.
+   * @param index The new index of this particle in its store.
    */
-  glm::vec3 m_velocity;
-  /**@brief The particle's applied force.
+  void setIndex(size_t index);
+
+  /**@brief Move the particle's state to another store.
    *
-   * The force applied to this particle.
+   * Copy the state of this particle at the end of another store and make
+   * this particle a handle to the copy. The previous store is marked as
+   * modified, so that the indices cached on it are recomputed.
+   * @param store The new store of this particle.
    */
-  glm::vec3 m_force;
-  /**@brief The particle's mass.
+  void moveTo(const ParticleStorePtr& store);
+  /**@brief Move the particle's state to a store of its own.
    *
-   * The mass of this particle.
+   * This is used when the particle is removed from a dynamic system, to
+   * keep it valid after the store of the system has been cleared.
    */
-  float m_mass;
-  /**@brief The particle's radius.
+  void detach();
+
+private:
+  /**@brief The store holding this particle's state.
    *
-   * The radius of this particle.
+   * The position, velocity, force, mass, radius and fixed flag of this
+   * particle are read and written in this store.
    */
-  float m_radius;
-  /**@brief The particle's fixed flag.
+  ParticleStorePtr m_store;
+  /**@brief The index of this particle in its store.
    *
-   * A flag that tells if this particle is fixed. If set to true,
-   * the position should be constant and the velocity null in simulation steps.
+   * The index of the entry of this particle in the arrays of m_store.
    */
-  bool m_isFixed;
+  size_t m_index;
 };
 
 typedef std::shared_ptr<Particle> ParticlePtr;
@@ -0,0 +1,181 @@
+#ifndef PARTICLE_EMITTER_HPP
+#define PARTICLE_EMITTER_HPP
+
+#include <memory>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Particle.hpp"
+
+/**@brief Emit particles from a fixed-capacity pool.
+ *
+ * An emitter owns a pool of particles, all created once, at construction.
+ * A pool slot is either alive, i.e. an active particle simulated as any other
+ * one, or dead, i.e. an inactive and fixed particle that is neither collided
+ * nor drawn. Dead slots are kept in a free list: spawning a particle reuses a
+ * dead slot and killing it gives the slot back, so that steady-state emission
+ * does not allocate memory nor change the particle store of the system.
+ *
+ * Particles are spawned at a given rate, in a sphere around the emitter
+ * position, with a lifetime drawn uniformly in a range and a velocity drawn
+ * uniformly in a cone around the emission direction.
+ *
+ * The emitter is added to a dynamic system, which adds the particles of the
+ * pool and updates the emitter before each simulation step. The particles of
+ * the pool can also be given to a ParticleListRenderable, which skips the
+ * dead ones.
+ */
+class ParticleEmitter
+{
+public:
+    /**@brief Build an emitter.
+     *
+     * Build an emitter and the particles of its pool, all dead.
+     * @param capacity The number of particles of the pool.
+     * @param mass The mass of the emitted particles.
+     * @param radius The radius of the emitted particles.
+     */
+    ParticleEmitter(size_t capacity, float mass, float radius);
+    ~ParticleEmitter();
+
+    /**@brief Access to the particles of the pool.
+     *
+     * @return All the particles of the pool, dead or alive.
+     */
+    const std::vector<ParticlePtr>& getParticles() const;
+    /**@brief Access to the capacity of the pool.
+     *
+     * @return The maximum number of particles alive at the same time.
+     */
+    size_t getCapacity() const;
+    /**@brief Number of particles alive.
+     *
+     * @return The number of particles currently alive.
+     */
+    size_t getAliveNumber() const;
+
+    /**@brief Access to the emitter position.
+     *
+     * @return The center of the sphere in which particles are spawned.
+     */
+    const glm::vec3& getPosition() const;
+    /**@brief Set the emitter position.
+     *
+     * @param position The new center of the sphere in which particles are spawned.
+     */
+    void setPosition(const glm::vec3& position);
+
+    /**@brief Access to the spawn radius.
+     *
+     * @return The radius of the sphere in which particles are spawned.
+     */
+    float getSpawnRadius() const;
+    /**@brief Set the spawn radius.
+     *
+     * @param radius The new radius of the sphere in which particles are spawned.
+     */
+    void setSpawnRadius(float radius);
+
+    /**@brief Access to the spawn rate.
+     *
+     * @return The number of particles spawned per second.
+     */
+    float getRate() const;
+    /**@brief Set the spawn rate.
+     *
+     * Particles are not spawned when the pool is full.
+     * @param rate The new number of particles spawned per second.
+     */
+    void setRate(float rate);
+
+    /**@brief Set the lifetime range.
+     *
+     * The lifetime of each particle is drawn uniformly in [minimum, maximum].
+     * @param minimum The minimum lifetime of a particle, in seconds.
+     * @param maximum The maximum lifetime of a particle, in seconds.
+     */
+    void setLifetime(float minimum, float maximum);
+    /**@brief Access to the minimum lifetime.
+     *
+     * @return The minimum lifetime of a particle, in seconds.
+     */
+    float getMinimumLifetime() const;
+    /**@brief Access to the maximum lifetime.
+     *
+     * @return The maximum lifetime of a particle, in seconds.
+     */
+    float getMaximumLifetime() const;
+
+    /**@brief Set the initial velocity distribution.
+     *
+     * The initial velocity of each particle has a direction drawn uniformly
+     * in a cone around the emission direction, and a speed drawn uniformly
+     * in [minimumSpeed, maximumSpeed].
+     * @param direction The emission direction.
+     * @param minimumSpeed The minimum initial speed.
+     * @param maximumSpeed The maximum initial speed.
+     * @param spread The half angle of the emission cone, in radians.
+     */
+    void setVelocity(const glm::vec3& direction, float minimumSpeed, float maximumSpeed, float spread);
+
+    /**@brief Set the seed of the random generator.
+     *
+     * @param seed The new seed of the random generator.
+     */
+    void setSeed(unsigned int seed);
+
+    /**@brief Spawn a particle.
+     *
+     * Bring a dead particle of the pool to life.
+     * @return False if the pool is full, true otherwise.
+     */
+    bool spawn();
+
+    /**@brief Kill all the particles.
+     *
+     * Give all the slots of the pool back to the free list.
+     */
+    void killAll();
+
+    /**@brief Update the emitter.
+     *
+     * Age the particles alive, kill those at the end of their life, then
+     * spawn the particles emitted during the time step. This is called by
+     * the dynamic system before each simulation step.
+     * @param dt The time step.
+     */
+    void update(float dt);
+
+private:
+    void kill(size_t slot);
+    void checkSlots();
+
+    std::vector<ParticlePtr> m_particles;
+    /**@brief Age of the particle of each slot. */
+    std::vector<float> m_ages;
+    /**@brief Lifetime of the particle of each slot. */
+    std::vector<float> m_lifetimes;
+    /**@brief A non zero value for the slots alive. */
+    std::vector<unsigned char> m_alive;
+    /**@brief Dead slots, reserved to the capacity of the pool. */
+    std::vector<unsigned int> m_freeSlots;
+
+    glm::vec3 m_position;
+    float m_spawnRadius;
+    float m_rate;
+    /**@brief Fraction of particle left to spawn from the previous steps. */
+    float m_spawnAccumulator;
+    float m_minimumLifetime;
+    float m_maximumLifetime;
+    glm::vec3 m_direction;
+    float m_minimumSpeed;
+    float m_maximumSpeed;
+    float m_spread;
+
+    std::mt19937 m_generator;
+};
+
+typedef std::shared_ptr<ParticleEmitter> ParticleEmitterPtr;
+
+#endif //PARTICLE_EMITTER_HPP
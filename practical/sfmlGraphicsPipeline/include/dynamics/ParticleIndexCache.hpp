@@ -0,0 +1,75 @@
+#ifndef PARTICLE_INDEX_CACHE_HPP
+#define PARTICLE_INDEX_CACHE_HPP
+
+#include <utility>
+#include <vector>
+#include "Particle.hpp"
+
+/**@brief Cache the store indices of a set of particles.
+ *
+ * Force fields keep their particles as a set of handles. To run over the
+ * arrays of a ParticleStore instead of following each handle, they resolve
+ * those handles once into indices in the store. The indices are kept as long
+ * as the revision of the store does not change.
+ */
+class ParticleIndexCache
+{
+public:
+    ParticleIndexCache();
+    ~ParticleIndexCache();
+
+    /**@brief Update the cached indices of a set of particles.
+     *
+     * Recompute the indices of the particles if the cache was invalidated
+     * or if their store has been modified since the last update.
+     * @param particles The set of particles to resolve.
+     * @return The store shared by all the particles, or nullptr if the
+     * particles are not all stored in the same store.
+     */
+    ParticleStore* update(const std::vector<ParticlePtr>& particles);
+
+    /**@brief Access to the cached indices.
+     *
+     * Get the indices of the particles in their store, as computed by
+     * the last call to update().
+     * @return The cached indices.
+     */
+    const std::vector<size_t>& getIndices() const;
+
+    /**@brief Access to the cached indices in a range.
+     *
+     * Get the cached indices that are in [begin, end), in increasing order.
+     * @param begin The first index of the range.
+     * @param end The index after the last one of the range.
+     * @return Pointers to the first cached index in the range and after
+     * the last one.
+     */
+    std::pair<const size_t*, const size_t*> getRange(size_t begin, size_t end) const;
+
+    /**@brief Check if all the indices of a range are cached.
+     *
+     * @param begin The first index of the range.
+     * @param end The index after the last one of the range.
+     * @return True if each index in [begin, end) is cached exactly once, so
+     * that the range can be run over without the cached indices.
+     */
+    bool coversRange(size_t begin, size_t end) const;
+
+    /**@brief Invalidate the cache.
+     *
+     * Force the indices to be recomputed at the next update, for instance
+     * when the set of particles changes.
+     */
+    void invalidate();
+
+private:
+    ParticleStorePtr m_store;
+    unsigned long m_revision;
+    std::vector<size_t> m_indices;
+    /**@brief The cached indices in increasing order. */
+    std::vector<size_t> m_sortedIndices;
+    /**@brief True if a particle is cached several times. */
+    bool m_duplicates;
+};
+
+#endif //PARTICLE_INDEX_CACHE_HPP
@@ -0,0 +1,87 @@
+#ifndef PARTICLE_ISLANDS_HPP
+#define PARTICLE_ISLANDS_HPP
+
+#include <cstddef>
+#include <vector>
+
+/**@brief Group particles into connected islands.
+ *
+ * An island is a set of particles connected, directly or not, by springs
+ * or contacts. Since the particles of an island push or pull each other,
+ * they can only be put to sleep, or woken up, all together.
+ *
+ * Islands are built with a union-find structure: each connection merges
+ * the islands of its two particles, in almost constant time.
+ */
+class ParticleIslands
+{
+public:
+    ParticleIslands();
+    ~ParticleIslands();
+
+    /**@brief Start a new set of islands.
+     *
+     * Put each particle in its own island.
+     * @param particleNumber The number of particles.
+     */
+    void reset(size_t particleNumber);
+
+    /**@brief Connect two particles.
+     *
+     * Merge the islands of two particles.
+     * @param a The index of the first particle.
+     * @param b The index of the second particle.
+     */
+    void merge(unsigned int a, unsigned int b);
+
+    /**@brief Find the island of a particle.
+     *
+     * @param a The index of the particle.
+     * @return The index of a particle representing the island of a.
+     */
+    unsigned int find(unsigned int a);
+
+    /**@brief List the particles of each island.
+     *
+     * Sort the particles by island, after all the connections are merged.
+     * @param excluded A non zero value for the particles to leave out of the
+     * lists, e.g. fixed particles.
+     */
+    void build(const std::vector<unsigned char>& excluded);
+
+    /**@brief Number of islands found by build().
+     *
+     * @return The number of islands.
+     */
+    size_t getIslandNumber() const;
+
+    /**@brief Access to the particles sorted by island.
+     *
+     * The particles of island k are listed between getIslandStart()[k] and
+     * getIslandStart()[k+1].
+     * @return The indices of the particles, sorted by island.
+     */
+    const std::vector<unsigned int>& getIslandParticles() const;
+    /**@brief Access to the first entry of each island.
+     *
+     * @return The first entry of each island in getIslandParticles(), followed
+     * by the number of listed particles.
+     */
+    const std::vector<unsigned int>& getIslandStart() const;
+
+    /**@brief Reserved size of the internal buffers.
+     *
+     * Used to detect the allocations of a simulation step.
+     * @param sizes The array to which the capacity of each buffer, in bytes,
+     * is appended.
+     */
+    void getBufferSizes(std::vector<size_t>& sizes) const;
+
+private:
+    std::vector<unsigned int> m_parents;
+    std::vector<unsigned int> m_islands;
+    std::vector<unsigned int> m_islandStart;
+    std::vector<unsigned int> m_islandParticles;
+};
+
+#endif //PARTICLE_ISLANDS_HPP
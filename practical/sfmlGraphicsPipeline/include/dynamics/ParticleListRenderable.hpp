@@ -2,6 +2,8 @@
 # define PARTICLELISTRENDERABLE_HPP_
 
 #include "Particle.hpp"
+#include "SimulationThread.hpp"
+#include "Trajectory.hpp"
 #include "../HierarchicalRenderable.hpp"
 #include "../Utils.hpp"
 #include "../gl_helper.hpp"
@@ -29,11 +31,31 @@ public:
      */
     ParticleListRenderable(ShaderProgramPtr program, std::vector<ParticlePtr>& particles);
 
+    /**@brief Draw the state published by a simulation thread.
+     *
+     * When the particles are simulated on a dedicated thread, their state
+     * must not be read directly: the latest snapshot of the thread is drawn
+     * instead.
+     * @param thread The thread simulating the particles, or nullptr to draw
+     * the particles directly.
+     */
+    void setSimulationThread(SimulationThreadPtr thread);
+    /**@brief Draw the frames of a recorded trajectory.
+     *
+     * The particles are drawn at their positions in the current frame of
+     * the player, which must hold as many particles as their particle store.
+     * @param player The player of the trajectory, or nullptr to draw the
+     * particles directly.
+     */
+    void setTrajectoryPlayer(TrajectoryPlayerPtr player);
+
 private:
     void do_draw();
     void do_animate( float time );
 
     std::vector< ParticlePtr > m_particles;
+    SimulationThreadPtr m_thread;
+    TrajectoryPlayerPtr m_player;
     size_t m_numberOfVertices;
     unsigned int m_positionBuffer;
     unsigned int m_colorBuffer;
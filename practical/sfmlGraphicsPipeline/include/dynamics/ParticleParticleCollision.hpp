@@ -30,4 +30,16 @@ typedef std::shared_ptr<ParticleParticleCollision> ParticleParticleCollisionPtr;
 
 bool testParticleParticle(const ParticlePtr& p1, const ParticlePtr& p2);
 
+/**@brief Test the intersection of two spheres.
+ *
+ * Test if two particles, given by their positions and radii, intersect.
+ * This is the test used by the dynamic system on its particle store.
+ * @param x1 The position of the first particle.
+ * @param r1 The radius of the first particle.
+ * @param x2 The position of the second particle.
+ * @param r2 The radius of the second particle.
+ * @return True if the two particles intersect.
+ */
+bool testParticleParticle(const glm::vec3& x1, float r1, const glm::vec3& x2, float r2);
+
 #endif //PARTICLE_PARTICLE_COLLISION_HPP
@@ -37,4 +37,15 @@ typedef std::shared_ptr<ParticlePlaneCollision> ParticlePlaneCollisionPtr;
 
 bool testParticlePlane(const ParticlePtr& particle, const PlanePtr& plane);
 
+/**@brief Test the intersection of a sphere and a plane.
+ *
+ * Test if a particle, given by its position and radius, intersects a plane.
+ * This is the test used by the dynamic system on its particle store.
+ * @param position The position of the particle.
+ * @param radius The radius of the particle.
+ * @param plane The plane to test.
+ * @return True if the particle intersects the plane.
+ */
+bool testParticlePlane(const glm::vec3& position, float radius, const Plane& plane);
+
 #endif //PARTICLE_PLANE_COLLISION_HPP
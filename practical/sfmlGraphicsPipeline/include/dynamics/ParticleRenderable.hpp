@@ -3,6 +3,7 @@
 
 #include "../HierarchicalRenderable.hpp"
 #include "Particle.hpp"
+#include "SimulationThread.hpp"
 
 #include <vector>
 #include <glm/glm.hpp>
@@ -25,11 +26,22 @@ class ParticleRenderable : public HierarchicalRenderable
          */
         ParticleRenderable( ShaderProgramPtr program, ParticlePtr particle );
 
+        /**@brief Draw the state published by a simulation thread.
+         *
+         * When the particle is simulated on a dedicated thread, its state
+         * must not be read directly: the latest snapshot of the thread is
+         * drawn instead.
+         * @param thread The thread simulating the particle, or nullptr to
+         * draw the particle directly.
+         */
+        void setSimulationThread(SimulationThreadPtr thread);
+
     private:
         void do_draw();
         void do_animate( float time );
 
         ParticlePtr m_particle;
+        SimulationThreadPtr m_thread;
 
         std::vector< glm::vec3 > m_positions;
         std::vector< glm::vec4 > m_colors;
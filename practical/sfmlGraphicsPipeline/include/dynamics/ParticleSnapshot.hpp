@@ -0,0 +1,26 @@
+#ifndef PARTICLE_SNAPSHOT_HPP
+#define PARTICLE_SNAPSHOT_HPP
+
+#include <vector>
+#include <glm/glm.hpp>
+
+/**@brief State of the particles, copied out of a dynamic system.
+ *
+ * Published by a SimulationThread or decoded from a recording by a
+ * TrajectoryPlayer, so that the renderables can draw a state without reading
+ * the particle store. The arrays are indexed as the particle store of the
+ * system, see TrajectoryPlayer::setSlots() for a recording.
+ */
+struct ParticleSnapshot
+{
+    /**@brief Particle positions. */
+    std::vector<glm::vec3> positions;
+    /**@brief Particle radii, empty for a recording. */
+    std::vector<float> radii;
+    /**@brief A non zero value for the active particles. */
+    std::vector<unsigned char> active;
+    /**@brief Number of simulation steps computed before this state. */
+    unsigned long step;
+};
+
+#endif //PARTICLE_SNAPSHOT_HPP
@@ -0,0 +1,203 @@
+#ifndef PARTICLE_STORE_HPP
+#define PARTICLE_STORE_HPP
+
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**@brief Contiguous storage of particle states.
+ *
+ * This class stores the state of a set of particles as a structure of
+ * arrays: positions, velocities, forces, inverse masses, radii and fixed
+ * flags are each kept in their own contiguous array. Solvers, force fields
+ * and collision detection iterate directly over those arrays, while the
+ * Particle class is only a thin handle to one entry of a store.
+ *
+ * Each structural modification of the store (particles added, removed or
+ * moved) gives it a new revision number. Revision numbers are unique among
+ * all stores, so they can be used to know if indices cached in a store are
+ * still valid.
+ */
+class ParticleStore
+{
+public:
+    ParticleStore();
+    ~ParticleStore();
+
+    /**@brief Add a particle to the store.
+     *
+     * Append a new particle at the end of the store.
+     * @param position The initial position.
+     * @param velocity The initial velocity.
+     * @param mass The particle mass.
+     * @param radius The particle radius.
+     * @return The index of the new particle in the store.
+     */
+    size_t addParticle(const glm::vec3& position, const glm::vec3& velocity,
+                       float mass, float radius);
+
+    /**@brief Copy a particle from another store.
+     *
+     * Append at the end of this store a copy of a particle stored in another
+     * store, including its initial state and its applied force.
+     * @param source The store holding the particle to copy.
+     * @param index The index of the particle in the source store.
+     * @return The index of the copy in this store.
+     */
+    size_t copyParticle(const ParticleStore& source, size_t index);
+
+    /**@brief Number of particles in the store.
+     *
+     * Get the number of particles stored.
+     * @return The number of stored particles.
+     */
+    size_t size() const;
+
+    /**@brief Remove all particles from the store.
+     *
+     * Empty all the arrays of this store.
+     */
+    void clear();
+
+    /**@brief Reset the forces of all particles.
+     *
+     * Set the applied force of every particle to zero.
+     */
+    void clearForces();
+
+    /**@brief Restart a particle.
+     *
+     * Set the position and velocity of a particle to their initial values.
+     * @param index The index of the particle to restart.
+     */
+    void restart(size_t index);
+
+    /**@brief Reorder the particles.
+     *
+     * Move the particle at index order[k] to index k, in every array, and
+     * mark the store as modified. The handles on the particles must be
+     * updated by the caller, see Particle::setIndex().
+     * @param order The previous index of each particle, a permutation of
+     * the indices of the store.
+     */
+    void permute(const std::vector<unsigned int>& order);
+
+    /**@brief Access to the revision of the store.
+     *
+     * Get the revision number of this store. It changes every time
+     * particles are added, removed or moved out of the store.
+     * @return The current revision number.
+     */
+    unsigned long getRevision() const;
+
+    /**@brief Mark the store as structurally modified.
+     *
+     * Give a new revision number to this store, so that indices cached
+     * by other objects are recomputed.
+     */
+    void touch();
+
+    /**@brief Access to the particles' positions.
+     *
+     * @return The array of positions.
+     */
+    std::vector<glm::vec3>& getPositions();
+    const std::vector<glm::vec3>& getPositions() const;
+
+    /**@brief Access to the particles' velocities.
+     *
+     * @return The array of velocities.
+     */
+    std::vector<glm::vec3>& getVelocities();
+    const std::vector<glm::vec3>& getVelocities() const;
+
+    /**@brief Access to the particles' applied forces.
+     *
+     * @return The array of forces.
+     */
+    std::vector<glm::vec3>& getForces();
+    const std::vector<glm::vec3>& getForces() const;
+
+    /**@brief Access to the particles' inverse masses.
+     *
+     * @return The array of inverse masses.
+     */
+    std::vector<float>& getInverseMasses();
+    const std::vector<float>& getInverseMasses() const;
+
+    /**@brief Access to the particles' radii.
+     *
+     * @return The array of radii.
+     */
+    std::vector<float>& getRadii();
+    const std::vector<float>& getRadii() const;
+
+    /**@brief Access to the particles' fixed flags.
+     *
+     * A non zero value means the particle is fixed.
+     * @return The array of fixed flags.
+     */
+    std::vector<unsigned char>& getFixed();
+    const std::vector<unsigned char>& getFixed() const;
+
+    /**@brief Access to the particles' sleeping flags.
+     *
+     * A non zero value means the particle is asleep: it is at rest and is
+     * neither integrated nor tested for collisions with other sleeping
+     * particles, until the dynamic system wakes it up.
+     * @return The array of sleeping flags.
+     */
+    std::vector<unsigned char>& getSleeping();
+    const std::vector<unsigned char>& getSleeping() const;
+
+    /**@brief Access to the particles' active flags.
+     *
+     * A zero value means the particle is a free slot, e.g. a dead particle
+     * of an emitter: it is neither tested for collisions nor drawn. Inactive
+     * particles should also be fixed, so that solvers leave them alone.
+     * @return The array of active flags.
+     */
+    std::vector<unsigned char>& getActive();
+    const std::vector<unsigned char>& getActive() const;
+
+    /**@brief Access to the particles' initial positions.
+     *
+     * @return The array of initial positions.
+     */
+    std::vector<glm::vec3>& getInitialPositions();
+    const std::vector<glm::vec3>& getInitialPositions() const;
+
+    /**@brief Access to the particles' initial velocities.
+     *
+     * @return The array of initial velocities.
+     */
+    std::vector<glm::vec3>& getInitialVelocities();
+    const std::vector<glm::vec3>& getInitialVelocities() const;
+
+    /**@brief Reserved size of the internal buffers.
+     *
+     * Used to detect the allocations of a simulation step.
+     * @param sizes The array to which the capacity of each buffer, in bytes,
+     * is appended.
+     */
+    void getBufferSizes(std::vector<size_t>& sizes) const;
+
+private:
+    std::vector<glm::vec3> m_positions;
+    std::vector<glm::vec3> m_velocities;
+    std::vector<glm::vec3> m_forces;
+    std::vector<float> m_inverseMasses;
+    std::vector<float> m_radii;
+    std::vector<unsigned char> m_fixed;
+    std::vector<unsigned char> m_sleeping;
+    std::vector<unsigned char> m_active;
+
+    std::vector<glm::vec3> m_initialPositions;
+    std::vector<glm::vec3> m_initialVelocities;
+
+    unsigned long m_revision;
+};
+
+typedef std::shared_ptr<ParticleStore> ParticleStorePtr;
+
+#endif //PARTICLE_STORE_HPP
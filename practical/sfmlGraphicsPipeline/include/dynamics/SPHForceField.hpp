@@ -0,0 +1,167 @@
+#ifndef SPH_FORCE_FIELD_HPP
+#define SPH_FORCE_FIELD_HPP
+
+#include <vector>
+#include "ForceField.hpp"
+#include "Particle.hpp"
+#include "ParticleIndexCache.hpp"
+#include "SpatialHashGrid.hpp"
+
+/**@brief Implement a fluid with smoothed particle hydrodynamics (SPH).
+ *
+ * This class turns a set of particles into a weakly compressible fluid. The
+ * density of each particle is estimated from the mass of its neighbors, i.e.
+ * the particles closer than the smoothing length. The pressure grows with
+ * the density above the rest density, and pushes the neighbors apart. The
+ * viscosity smooths the velocities of the neighbors, and a cohesion force
+ * pulls them together, which models the surface tension.
+ *
+ * The neighbors are found with a spatial hash grid whose cells are as large
+ * as the smoothing length, so that a step costs O(n) instead of testing all
+ * the pairs of particles. The neighbor lists are rebuilt in parallel at
+ * each step, in compressed sparse row (CSR) form, then the densities and the
+ * forces are computed by flat loops over the particles. Each loop only writes
+ * to the entries of its particle, so they run in parallel without conflict.
+ *
+ * The kernels are the ones of Mueller et al. 2003: poly6 for the density,
+ * spiky for the pressure and the viscosity one for the viscosity. The
+ * cohesion follows Becker and Teschner 2007. The mass of a particle is the
+ * inverse of its inverse mass: particles of infinite mass do not contribute
+ * to the densities.
+ */
+class SPHForceField : public ForceField
+{
+    public:
+        /**@brief Build a new SPH fluid.
+         *
+         * Build a fluid made of a set of particles, each one appearing once.
+         * @param particles The particles of the fluid.
+         * @param smoothingLength The radius of the neighborhood of a particle,
+         * usually twice the spacing of the particles at rest.
+         * @param restDensity The density of the fluid at rest.
+         * @param stiffness The factor of the pressure, as a function of the
+         * excess density.
+         * @param viscosity The viscosity of the fluid.
+         * @param surfaceTension The factor of the cohesion force.
+         */
+        SPHForceField(const std::vector<ParticlePtr>& particles, float smoothingLength,
+                      float restDensity, float stiffness, float viscosity, float surfaceTension);
+
+        /**@brief Access to the particles of the fluid.
+         *
+         * @return The particles of the fluid.
+         */
+        const std::vector<ParticlePtr>& getParticles() const;
+        /**@brief Define the particles of the fluid.
+         *
+         * @param particles The new particles of the fluid.
+         */
+        void setParticles(const std::vector<ParticlePtr>& particles);
+
+        /**@brief Access to the smoothing length.
+         *
+         * @return The radius of the neighborhood of a particle.
+         */
+        float getSmoothingLength() const;
+        /**@brief Set the smoothing length.
+         *
+         * @param smoothingLength The new radius of the neighborhood of a particle.
+         */
+        void setSmoothingLength(float smoothingLength);
+
+        /**@brief Access to the rest density.
+         *
+         * @return The density of the fluid at rest.
+         */
+        float getRestDensity() const;
+        /**@brief Set the rest density.
+         *
+         * @param restDensity The new density of the fluid at rest.
+         */
+        void setRestDensity(float restDensity);
+
+        /**@brief Access to the stiffness.
+         *
+         * The pressure of a particle is stiffness * (density - restDensity),
+         * clamped to zero below the rest density so that the particles of the
+         * free surface do not clump together.
+         * @return The factor of the pressure.
+         */
+        float getStiffness() const;
+        /**@brief Set the stiffness.
+         *
+         * @param stiffness The new factor of the pressure.
+         */
+        void setStiffness(float stiffness);
+
+        /**@brief Access to the viscosity.
+         *
+         * @return The viscosity of the fluid.
+         */
+        float getViscosity() const;
+        /**@brief Set the viscosity.
+         *
+         * @param viscosity The new viscosity of the fluid.
+         */
+        void setViscosity(float viscosity);
+
+        /**@brief Access to the surface tension.
+         *
+         * @return The factor of the cohesion force.
+         */
+        float getSurfaceTension() const;
+        /**@brief Set the surface tension.
+         *
+         * @param surfaceTension The new factor of the cohesion force.
+         */
+        void setSurfaceTension(float surfaceTension);
+
+        /**@brief Access to the densities.
+         *
+         * The density of each particle computed by the last evaluation of
+         * the force, e.g. to color the particles.
+         * @return The densities, indexed as the particle store.
+         */
+        const std::vector<float>& getDensities() const;
+
+    private:
+        void do_addForce();
+        bool do_addForce(const ParticleStore& store, std::vector<glm::vec3>& forces);
+        void do_getParameters(std::vector<float>& parameters) const;
+        bool do_setParameters(const float* parameters, size_t count);
+
+        /**@brief Build the neighbor lists.
+         *
+         * Sort the active particles of the fluid into the grid, then list
+         * the neighbors of each particle of the fluid in m_neighbors.
+         * @param store The particle store of the fluid.
+         */
+        void findNeighbors(const ParticleStore& store);
+
+        std::vector<ParticlePtr> m_particles;
+        ParticleIndexCache m_indices;
+
+        float m_smoothingLength;
+        float m_restDensity;
+        float m_stiffness;
+        float m_viscosity;
+        float m_surfaceTension;
+
+        SpatialHashGrid m_grid;
+        /**@brief A non zero value for the store entries sorted into the grid. */
+        std::vector<unsigned char> m_included;
+        /**@brief First entry of the neighbors of each particle in m_neighbors. */
+        std::vector<unsigned int> m_neighborStart;
+        /**@brief Store index of the neighbors of each particle of the fluid. */
+        std::vector<unsigned int> m_neighbors;
+        /**@brief Neighbors listed by each thread, and the first particle of its range. */
+        std::vector<std::vector<unsigned int> > m_threadNeighbors;
+        std::vector<long> m_threadFirst;
+        /**@brief Density and pressure of each particle, indexed as the store. */
+        std::vector<float> m_densities;
+        std::vector<float> m_pressures;
+};
+
+typedef std::shared_ptr<SPHForceField> SPHForceFieldPtr;
+
+#endif // SPH_FORCE_FIELD_HPP
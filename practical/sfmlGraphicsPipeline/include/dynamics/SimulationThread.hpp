@@ -0,0 +1,162 @@
+#ifndef SIMULATION_THREAD_HPP
+#define SIMULATION_THREAD_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "DynamicSystem.hpp"
+#include "ParticleSnapshot.hpp"
+
+/**@brief Run a dynamic system on a dedicated thread.
+ *
+ * The thread computes the simulation steps of the system while the render
+ * thread draws, so that the cost of a step does not drop frames anymore.
+ * The render thread gives the time to simulate with advance(), e.g. from
+ * the viewer time in DynamicSystemRenderable::do_animate(), and the worker
+ * computes as many steps of the system time step as fit in this time, up to
+ * getMaximumSubsteps() steps behind: the remaining time is dropped.
+ *
+ * After each step, the worker publishes the particle state in a triple buffer:
+ * one snapshot is written by the worker, one is read by the render thread
+ * and the last one is the latest complete state, swapped atomically. Neither
+ * thread waits for the other. The render thread calls acquireSnapshot() once
+ * per frame, then the renderables read getSnapshot() without any lock.
+ *
+ * While the thread runs, only the worker can access the system: stop() it
+ * before changing the particles, the force fields or the parameters of the
+ * system, then start() it again. Parameters changed at every frame, e.g. the
+ * force of a controlled force field, are rather given to post(): the worker
+ * applies them between two steps.
+ */
+class SimulationThread
+{
+public:
+    /**@brief Build a simulation thread.
+     *
+     * The thread is not started.
+     * @param system The dynamic system to simulate.
+     */
+    SimulationThread(DynamicSystemPtr system);
+    /**@brief Stop the thread and destroy it. */
+    ~SimulationThread();
+
+    /**@brief Access to the simulated system.
+     *
+     * @return The dynamic system simulated by this thread.
+     */
+    const DynamicSystemPtr& getDynamicSystem() const;
+
+    /**@brief Start the simulation.
+     *
+     * Publish the current state of the system, then start the worker thread.
+     * The periodic reordering of the particles of the system is suspended
+     * until stop(), see DynamicSystem::setReorderInterval(). Nothing is done
+     * if the thread already runs.
+     */
+    void start();
+    /**@brief Stop the simulation.
+     *
+     * Wait for the end of the current step, then join the worker thread.
+     * The time not simulated yet is dropped.
+     */
+    void stop();
+    /**@brief Check if the simulation runs.
+     *
+     * @return True if the worker thread is started.
+     */
+    bool isRunning() const;
+
+    /**@brief Change the system between two steps.
+     *
+     * The command is queued and called by the worker before its next step,
+     * the queued commands being called in order. It is called at once if the
+     * thread does not run. A command must be short: it holds the lock of
+     * lockParameters().
+     * @param command The function changing the system, e.g. setting a force.
+     */
+    void post(const std::function<void()>& command);
+    /**@brief Lock the parameters changed by the commands.
+     *
+     * The worker only calls the commands given to post() while this lock is
+     * held: the render thread can read the parameters they change, e.g. the
+     * force of a controlled force field, while holding it.
+     * @return The lock, released when destroyed.
+     */
+    std::unique_lock<std::mutex> lockParameters() const;
+
+    /**@brief Give time to simulate.
+     *
+     * @param time The time to add to the time the worker has to simulate.
+     */
+    void advance(float time);
+
+    /**@brief Access to the maximum number of steps of delay.
+     *
+     * @return The maximum number of steps the worker can lag behind.
+     */
+    unsigned int getMaximumSubsteps() const;
+    /**@brief Set the maximum number of steps of delay.
+     *
+     * When the worker lags more than this number of steps behind the time
+     * given by advance(), the simulation is not able to keep up: the
+     * remaining time is dropped and the simulation slows down.
+     * @param substeps The new maximum number of steps the worker can lag behind.
+     */
+    void setMaximumSubsteps(unsigned int substeps);
+
+    /**@brief Take the latest state published by the worker.
+     *
+     * Must be called by the render thread only, once per frame, before
+     * drawing: the snapshot returned by getSnapshot() does not change until
+     * the next call.
+     * @return True if a new state was published since the previous call.
+     */
+    bool acquireSnapshot();
+    /**@brief Access to the state taken by the render thread.
+     *
+     * @return The state taken by the last call to acquireSnapshot().
+     */
+    const ParticleSnapshot& getSnapshot() const;
+
+private:
+    void run();
+    void applyCommands();
+    void copyState(ParticleSnapshot& snapshot, unsigned long step) const;
+    void publish(unsigned long step);
+
+    DynamicSystemPtr m_system;
+    std::thread m_thread;
+
+    /**@brief Protect m_budget, m_running and m_commands, to wake up the worker. */
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_running;
+    /**@brief Commands given by post() and not called yet. */
+    std::vector<std::function<void()> > m_commands;
+    /**@brief Time given by advance() and not simulated yet. */
+    float m_budget;
+    unsigned int m_maximumSubsteps;
+    /**@brief Reordering interval of the system, suspended while running. */
+    unsigned int m_reorderInterval;
+
+    /**@brief Snapshots of the triple buffer. */
+    ParticleSnapshot m_snapshots[3];
+    /**@brief Index of the latest published snapshot, with the FRESH bit if
+     * the render thread has not taken it yet. */
+    std::atomic<unsigned int> m_latest;
+    /**@brief Index of the snapshot written by the worker. */
+    unsigned int m_back;
+    /**@brief Index of the snapshot read by the render thread. */
+    unsigned int m_front;
+    /**@brief Number of steps computed since the thread was built. */
+    unsigned long m_step;
+};
+
+typedef std::shared_ptr<SimulationThread> SimulationThreadPtr;
+
+#endif //SIMULATION_THREAD_HPP
@@ -3,7 +3,10 @@
 
 #include <memory>
 #include <vector>
-#include "Particle.hpp"
+#include "ParticleStore.hpp"
+#include "ForceField.hpp"
+#include "MeshObstacle.hpp"
+#include "../Plane.hpp"
 
 /**@brief Dynamic system solver interface.
  *
@@ -17,19 +20,77 @@ public:
   /**@brief Solve the dynamic system of particles.
    *
    * Solve the dynamic system of particles for a specified time step.
+   * The forces of the force fields have already been added to the
+   * particles when this is called.
    * @param dt The time step for the integration.
-   * @param particles The collection of particles.
+   * @param particles The store holding the state of the particles.
+   * @param forceFields The force fields applied to the particles.
    */
-  void solve( const float& dt, std::vector<ParticlePtr>& particles );
+  void solve( const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields );
+
+  /**@brief Check if the solver resolves the collisions itself.
+   *
+   * Some solvers, e.g. position based ones, handle collisions as constraints
+   * of the system they solve. The dynamic system then calls
+   * solveWithCollisions() instead of running its own collision stage.
+   * @return True if the solver resolves the collisions.
+   */
+  bool handlesCollisions() const;
+
+  /**@brief Solve the dynamic system of particles, with collisions.
+   *
+   * Solve the dynamic system of particles for a specified time step,
+   * preventing particles from interpenetrating each other and the
+   * obstacles. Only meaningful if handlesCollisions() returns true.
+   * @param dt The time step for the integration.
+   * @param particles The store holding the state of the particles.
+   * @param forceFields The force fields applied to the particles.
+   * @param planeObstacles The plane obstacles of the dynamic system.
+   * @param meshObstacles The mesh obstacles of the dynamic system.
+   */
+  void solveWithCollisions( const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields,
+                            const std::vector<PlanePtr>& planeObstacles,
+                            const std::vector<MeshObstaclePtr>& meshObstacles );
+
+  /**@brief Time step suggested by the solver.
+   *
+   * Adaptive solvers estimate the error of their steps and choose the
+   * step size accordingly. The dynamic system takes the suggested step
+   * size as its time step for the next simulation step.
+   * @return The time step suggested for the next step, or zero if the
+   * solver does not choose its step size.
+   */
+  float getSuggestedDt() const;
 private:
   /**@brief Solve implementation.
    *
    * The actual implementation to solve the dynamic system. This should
    * be implemented in derived classes.
    * @param dt The time step for the integration.
-   * @param particles The collection of particles.
+   * @param particles The store holding the state of the particles.
+   * @param forceFields The force fields applied to the particles.
+   */
+  virtual void do_solve(const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields) = 0;
+
+  /**@brief Collisions support implementation.
+   *
+   * The default implementation returns false.
+   */
+  virtual bool do_handlesCollisions() const;
+
+  /**@brief Solve with collisions implementation.
+   *
+   * The default implementation ignores the collisions and calls do_solve().
+   */
+  virtual void do_solveWithCollisions(const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields,
+                                      const std::vector<PlanePtr>& planeObstacles,
+                                      const std::vector<MeshObstaclePtr>& meshObstacles);
+
+  /**@brief Suggested time step implementation.
+   *
+   * The default implementation returns zero.
    */
-  virtual void do_solve(const float& dt, std::vector<ParticlePtr>& particles) = 0;
+  virtual float do_getSuggestedDt() const;
 };
 
 typedef std::shared_ptr<Solver> SolverPtr;
@@ -0,0 +1,155 @@
+#ifndef SPATIAL_HASH_GRID_HPP
+#define SPATIAL_HASH_GRID_HPP
+
+#include <cmath>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**@brief Uniform grid over a set of points, stored in a hash table.
+ *
+ * This class sorts a set of points (typically particle positions) into the
+ * cells of an infinite uniform grid. Cells are stored in a hash table of
+ * size proportional to the number of points, so memory does not depend on
+ * the extent of the scene. Building the grid is a counting sort, in O(n),
+ * and a neighbor query only visits the cells overlapping the query box.
+ *
+ * It is used by the dynamic system as a broad phase for particle-particle
+ * collisions, but it can be used by any other component, e.g. a force field,
+ * that needs to find the points close to a position.
+ */
+class SpatialHashGrid
+{
+public:
+    SpatialHashGrid();
+    ~SpatialHashGrid();
+
+    /**@brief Sort a set of points into the grid.
+     *
+     * Build the grid for a set of points. The internal arrays are reused
+     * from one build to the next, so rebuilding the grid for the same
+     * number of points does not allocate memory.
+     * @param positions The positions of the points.
+     * @param cellSize The edge length of a grid cell. It is enlarged if it is
+     * less than a millionth of the largest coordinate of the points.
+     */
+    void build(const std::vector<glm::vec3>& positions, float cellSize);
+    /**@brief Sort a subset of points into the grid.
+     *
+     * Build the grid for the points having a non zero flag. The other points
+     * are never visited by the queries.
+     * @param positions The positions of the points.
+     * @param cellSize The edge length of a grid cell.
+     * @param included A non zero value for the points to sort into the grid.
+     */
+    void build(const std::vector<glm::vec3>& positions, float cellSize,
+               const std::vector<unsigned char>& included);
+
+    /**@brief Access to the cell size.
+     *
+     * Get the edge length of the cells used by the last build.
+     * @return The cell size.
+     */
+    float getCellSize() const;
+
+    /**@brief Visit the points close to a position.
+     *
+     * Call a visitor with the index of every point stored in the cells
+     * overlapping the box of half size radius centered at x. Every point of
+     * those cells is visited exactly once, but some of them can be farther
+     * than radius from x: the visitor should do the exact test.
+     * @param x The center of the query.
+     * @param radius The radius of the query.
+     * @param visit A callable taking the index of a point, as a size_t.
+     */
+    template<typename Visitor>
+    void forEachNeighbor(const glm::vec3& x, float radius, Visitor visit) const;
+
+    /**@brief Find the points close to a position.
+     *
+     * Fill a vector with the indices of the points that are at most at
+     * a distance radius from x.
+     * @param positions The positions used to build the grid.
+     * @param x The center of the query.
+     * @param radius The radius of the query.
+     * @param neighbors The indices of the neighbors found. It is cleared first.
+     */
+    void findNeighbors(const std::vector<glm::vec3>& positions, const glm::vec3& x,
+                       float radius, std::vector<size_t>& neighbors) const;
+
+    /**@brief Reserved size of the internal buffers.
+     *
+     * Used to detect the allocations of a simulation step.
+     * @param sizes The array to which the capacity of each buffer, in bytes,
+     * is appended.
+     */
+    void getBufferSizes(std::vector<size_t>& sizes) const;
+
+private:
+    glm::ivec3 cellCoordinates(const glm::vec3& x) const;
+    size_t cellBucket(const glm::ivec3& cell) const;
+
+    float m_cellSize;
+    float m_invCellSize;
+    size_t m_bucketMask;
+
+    /**@brief First entry of each bucket in the sorted arrays.
+     *
+     * The points of bucket b are stored between m_bucketStart[b] and
+     * m_bucketStart[b+1] in m_sortedIndices and m_sortedCells.
+     */
+    std::vector<unsigned int> m_bucketStart;
+    /**@brief Point indices, sorted by bucket. */
+    std::vector<unsigned int> m_sortedIndices;
+    /**@brief Cell of each sorted point.
+     *
+     * Used to skip the points of other cells sharing the same bucket.
+     */
+    std::vector<glm::ivec3> m_sortedCells;
+    /**@brief Bucket of each point, used during the build. */
+    std::vector<unsigned int> m_pointBuckets;
+};
+
+inline glm::ivec3 SpatialHashGrid::cellCoordinates(const glm::vec3& x) const
+{
+    //Cells are clamped to 2^30 so that the conversion, and the loops over
+    //the cells of a query, cannot overflow: far away points share the last cells
+    const glm::vec3 cell = glm::clamp(glm::floor(x*m_invCellSize), glm::vec3(-1073741824.0f), glm::vec3(1073741824.0f));
+    return glm::ivec3(cell);
+}
+
+inline size_t SpatialHashGrid::cellBucket(const glm::ivec3& cell) const
+{
+    const unsigned int h = (static_cast<unsigned int>(cell.x)*73856093u)
+                         ^ (static_cast<unsigned int>(cell.y)*19349663u)
+                         ^ (static_cast<unsigned int>(cell.z)*83492791u);
+    return h & m_bucketMask;
+}
+
+template<typename Visitor>
+void SpatialHashGrid::forEachNeighbor(const glm::vec3& x, float radius, Visitor visit) const
+{
+    if(m_sortedIndices.empty()) return;
+
+    const glm::ivec3 lo = cellCoordinates(x - glm::vec3(radius));
+    const glm::ivec3 hi = cellCoordinates(x + glm::vec3(radius));
+    glm::ivec3 cell;
+    for(cell.x = lo.x; cell.x <= hi.x; ++cell.x)
+    {
+        for(cell.y = lo.y; cell.y <= hi.y; ++cell.y)
+        {
+            for(cell.z = lo.z; cell.z <= hi.z; ++cell.z)
+            {
+                //Several cells can share a bucket: only keep the points of this cell,
+                //so that each point is visited once.
+                const size_t bucket = cellBucket(cell);
+                for(unsigned int k = m_bucketStart[bucket]; k < m_bucketStart[bucket+1]; ++k)
+                {
+                    if(m_sortedCells[k] == cell)
+                        visit(static_cast<size_t>(m_sortedIndices[k]));
+                }
+            }
+        }
+    }
+}
+
+#endif //SPATIAL_HASH_GRID_HPP
@@ -45,7 +45,29 @@ class SpringForceField : public ForceField
          * and add them to the particles.
          */
         void do_addForce();
+        bool do_addForce(const ParticleStore& store, std::vector<glm::vec3>& forces);
+        bool do_addJacobianProduct(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                   const std::vector<glm::vec3>& y, std::vector<glm::vec3>& out);
+        bool do_addJacobianDiagonal(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                    std::vector<glm::vec3>& diagonal);
+        void do_getConnections(const ParticleStore& store,
+                               std::vector<std::pair<unsigned int, unsigned int> >& connections);
+        bool do_getDistanceConstraints(const ParticleStore& store, std::vector<DistanceConstraint>& constraints);
+        void do_getParameters(std::vector<float>& parameters) const;
+        bool do_setParameters(const float* parameters, size_t count);
 
+        /**@brief Compute the force of this spring.
+         *
+         * Compute the force applied by this spring to its first particle.
+         * The opposite force is applied to the second one.
+         * @param x1 The position of the first particle.
+         * @param x2 The position of the second particle.
+         * @param v1 The velocity of the first particle.
+         * @param v2 The velocity of the second particle.
+         * @return The force applied to the first particle.
+         */
+        glm::vec3 computeForce(const glm::vec3& x1, const glm::vec3& x2,
+                               const glm::vec3& v1, const glm::vec3& v2) const;
 
         const ParticlePtr m_p1, m_p2;
         float m_stiffness;
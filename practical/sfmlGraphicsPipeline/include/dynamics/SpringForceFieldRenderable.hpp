@@ -3,6 +3,7 @@
 
 #include "../HierarchicalRenderable.hpp"
 #include "SpringForceField.hpp"
+#include "SimulationThread.hpp"
 
 /**@brief Render a spring force field.
  *
@@ -22,11 +23,23 @@ public:
      */
     SpringForceFieldRenderable( ShaderProgramPtr program, SpringForceFieldPtr springForceField );
 
+    /**@brief Draw the state published by a simulation thread.
+     *
+     * When the particles are simulated on a dedicated thread, their state
+     * must not be read directly: the spring is drawn between the positions
+     * of the latest snapshot of the thread instead.
+     * @param thread The thread simulating the particles, or nullptr to draw
+     * the particles directly.
+     */
+    void setSimulationThread(SimulationThreadPtr thread);
+
 private:
     void do_draw();
     void do_animate( float time );
+    glm::vec3 getPosition(const ParticlePtr& particle) const;
 
     SpringForceFieldPtr m_springForceField;
+    SimulationThreadPtr m_thread;
 
     std::vector< glm::vec3 > m_positions;
     std::vector< glm::vec4 > m_colors;
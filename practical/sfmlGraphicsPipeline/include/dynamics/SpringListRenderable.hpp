@@ -3,6 +3,9 @@
 
 #include "../HierarchicalRenderable.hpp"
 #include "SpringForceField.hpp"
+#include "SpringNetworkForceField.hpp"
+#include "SimulationThread.hpp"
+#include "Trajectory.hpp"
 #include <list>
 #include <vector>
 
@@ -25,12 +28,44 @@ public:
      * the springs we want to render.
      */
     SpringListRenderable( ShaderProgramPtr program, std::list<SpringForceFieldPtr>& springForceFields );
+    /**@brief Build a renderable to render a spring network.
+     *
+     * Build a new renderable to render the springs of a spring network.
+     * @param program The shader program used to render the springs.
+     * @param springNetwork The spring network to render.
+     */
+    SpringListRenderable( ShaderProgramPtr program, SpringNetworkForceFieldPtr springNetwork );
+
+    /**@brief Draw the state published by a simulation thread.
+     *
+     * When the particles are simulated on a dedicated thread, their state
+     * must not be read directly: the springs are drawn between the positions
+     * of the latest snapshot of the thread instead.
+     * @param thread The thread simulating the particles, or nullptr to draw
+     * the particles directly.
+     */
+    void setSimulationThread(SimulationThreadPtr thread);
+    /**@brief Draw the frames of a recorded trajectory.
+     *
+     * The springs are drawn between the positions of the current frame of
+     * the player, which must hold as many particles as the particle store
+     * of the springs.
+     * @param player The player of the trajectory, or nullptr to draw the
+     * particles directly.
+     */
+    void setTrajectoryPlayer(TrajectoryPlayerPtr player);
 
 private:
     void do_draw();
     void do_animate( float time );
+    void initialize();
+    void updatePositions();
+    glm::vec3 getPosition(const ParticlePtr& particle) const;
 
     std::list<SpringForceFieldPtr> m_springForceFields;
+    SpringNetworkForceFieldPtr m_springNetwork;
+    SimulationThreadPtr m_thread;
+    TrajectoryPlayerPtr m_player;
 
     std::vector< glm::vec3 > m_positions;
     std::vector< glm::vec4 > m_colors;
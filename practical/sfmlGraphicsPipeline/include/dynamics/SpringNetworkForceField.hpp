@@ -0,0 +1,164 @@
+#ifndef SPRING_NETWORK_FORCE_FIELD_HPP
+#define SPRING_NETWORK_FORCE_FIELD_HPP
+
+#include <vector>
+#include "ForceField.hpp"
+#include "Particle.hpp"
+#include "ParticleIndexCache.hpp"
+
+/**@brief Implement a network of springs as a single force field.
+ *
+ * This class models a whole set of damped springs, e.g. a cloth or a soft
+ * body, with a single force field. Instead of one SpringForceField object
+ * per spring, the springs are stored as arrays: the indices of their two
+ * particles, their stiffness, their equilibrium length and their damping.
+ *
+ * The forces are computed in two flat loops. The first one computes the
+ * force of each spring. The second one sums, for each particle, the forces
+ * of its springs. To do so, the springs attached to each particle are stored
+ * in compressed sparse row (CSR) form: the springs of particle k are listed
+ * between m_rowStart[k] and m_rowStart[k+1] in m_rowSprings. Both loops
+ * write to separate entries only, so they run in parallel without conflict.
+ */
+class SpringNetworkForceField : public ForceField
+{
+    public:
+        /**@brief Index returned by addSpring() when the spring is rejected. */
+        static const size_t INVALID_SPRING = static_cast<size_t>(-1);
+
+        /**@brief Build a new spring network.
+         *
+         * Build a new spring network, without any spring, over a set of particles.
+         * @param particles The set of particles that can be linked by springs.
+         */
+        SpringNetworkForceField(const std::vector<ParticlePtr>& particles);
+
+        /**@brief Add a spring to the network.
+         *
+         * Add a spring between two particles of the network.
+         * @param p1 The index of the first particle in the set of particles of the network.
+         * @param p2 The index of the second particle in the set of particles of the network.
+         * @param stiffness The spring stiffness.
+         * @param equilibriumLength The equilibrium length.
+         * @param damping The damping factor.
+         * @return The index of the new spring, or INVALID_SPRING if an index
+         * is out of the set of particles or both indices are equal, in which
+         * case no spring is added.
+         */
+        size_t addSpring(unsigned int p1, unsigned int p2,
+                float stiffness, float equilibriumLength, float damping);
+
+        /**@brief Access to the set of particles of the network.
+         *
+         * Get the particles that can be linked by springs.
+         * @return The particles of the network.
+         */
+        const std::vector<ParticlePtr>& getParticles() const;
+
+        /**@brief Number of springs of the network.
+         *
+         * @return The number of springs.
+         */
+        size_t getSpringNumber() const;
+
+        /**@brief Access to the first particle of a spring.
+         *
+         * @param spring The index of the spring.
+         * @return The index of the first particle in the set of particles of the network.
+         */
+        unsigned int getParticle1(size_t spring) const;
+        /**@brief Access to the second particle of a spring.
+         *
+         * @param spring The index of the spring.
+         * @return The index of the second particle in the set of particles of the network.
+         */
+        unsigned int getParticle2(size_t spring) const;
+
+        /**@brief Access to the stiffness of the springs.
+         *
+         * @return The stiffness of each spring.
+         */
+        const std::vector<float>& getStiffnesses() const;
+        /**@brief Access to the equilibrium length of the springs.
+         *
+         * @return The equilibrium length of each spring.
+         */
+        const std::vector<float>& getEquilibriumLengths() const;
+        /**@brief Access to the damping factor of the springs.
+         *
+         * @return The damping factor of each spring.
+         */
+        const std::vector<float>& getDampings() const;
+
+        /**@brief Remove all springs.
+         *
+         * Remove all springs of the network. The particles are kept.
+         */
+        void clear();
+
+    private:
+        void do_addForce();
+        bool do_addForce(const ParticleStore& store, std::vector<glm::vec3>& forces);
+        bool do_addJacobianProduct(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                   const std::vector<glm::vec3>& y, std::vector<glm::vec3>& out);
+        bool do_addJacobianDiagonal(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                    std::vector<glm::vec3>& diagonal);
+        void do_getConnections(const ParticleStore& store,
+                               std::vector<std::pair<unsigned int, unsigned int> >& connections);
+        bool do_getDistanceConstraints(const ParticleStore& store, std::vector<DistanceConstraint>& constraints);
+        void do_getParameters(std::vector<float>& parameters) const;
+        bool do_setParameters(const float* parameters, size_t count);
+
+        /**@brief Build the list of springs of each particle.
+         *
+         * Fill m_rowStart and m_rowSprings from the springs' particles.
+         */
+        void buildRows();
+
+        /**@brief Compute the force of each spring.
+         *
+         * Fill m_springForces with the force applied by each spring to its
+         * first particle. The opposite force is applied to the second one.
+         * @param positions The positions of the particles of the network.
+         * @param velocities The velocities of the particles of the network.
+         * @param indices The index of each particle of the network in the arrays.
+         */
+        void computeSpringForces(const std::vector<glm::vec3>& positions,
+                                 const std::vector<glm::vec3>& velocities,
+                                 const std::vector<size_t>& indices);
+
+        /**@brief Add the force of each spring to its two particles.
+         *
+         * Add the entries of m_springForces, following the list of springs
+         * of each particle.
+         * @param indices The index of each particle of the network in the arrays.
+         * @param forces The array of forces to add to.
+         */
+        void gatherSpringForces(const std::vector<size_t>& indices, std::vector<glm::vec3>& forces) const;
+
+        std::vector<ParticlePtr> m_particles;
+        ParticleIndexCache m_indices;
+
+        std::vector<unsigned int> m_particles1;
+        std::vector<unsigned int> m_particles2;
+        std::vector<float> m_stiffnesses;
+        std::vector<float> m_equilibriumLengths;
+        std::vector<float> m_dampings;
+
+        /**@brief First entry of the springs of each particle in m_rowSprings. */
+        std::vector<unsigned int> m_rowStart;
+        /**@brief Springs attached to each particle.
+         *
+         * Each entry is 2*spring + end, end being 0 if the particle is the first
+         * one of the spring and 1 if it is the second one.
+         */
+        std::vector<unsigned int> m_rowSprings;
+        bool m_rowsValid;
+
+        /**@brief Force of each spring on its first particle. */
+        std::vector<glm::vec3> m_springForces;
+};
+
+typedef std::shared_ptr<SpringNetworkForceField> SpringNetworkForceFieldPtr;
+
+#endif // SPRING_NETWORK_FORCE_FIELD_HPP
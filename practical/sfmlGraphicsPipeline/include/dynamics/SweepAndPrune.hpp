@@ -0,0 +1,117 @@
+#ifndef SWEEP_AND_PRUNE_HPP
+#define SWEEP_AND_PRUNE_HPP
+
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ParticleStore.hpp"
+
+/**@brief Incremental sweep and prune broad phase.
+ *
+ * This class maintains the set of particles whose bounding boxes overlap.
+ * The bounds of the boxes are kept sorted along each axis between two
+ * updates. Since particles barely move during a time step, the lists are
+ * almost sorted and an insertion sort restores the order in about O(n).
+ * Each swap of two bounds is an event where two boxes may start or stop
+ * to overlap, so the set of overlapping pairs is updated incrementally
+ * instead of being rebuilt.
+ *
+ * Contrary to the spatial hash grid, the cost does not depend on the
+ * ratio between the largest and the smallest particle radii.
+ */
+class SweepAndPrune
+{
+public:
+    /**@brief A pair of particle indices, the first one being the smallest. */
+    typedef std::pair<unsigned int, unsigned int> Pair;
+
+    SweepAndPrune();
+    ~SweepAndPrune();
+
+    /**@brief Update the set of overlapping pairs.
+     *
+     * Update the bounding boxes of the particles and the set of overlapping
+     * pairs. If the particles of the store are not the ones of the previous
+     * update, i.e. if its revision changed, everything is rebuilt from scratch.
+     * @param particles The store holding the particles' positions and radii.
+     */
+    void update(const ParticleStore& particles);
+
+    /**@brief Remove everything from the broad phase.
+     *
+     * The next update will rebuild the sorted lists from scratch.
+     */
+    void clear();
+
+    /**@brief Access to the overlapping pairs.
+     *
+     * Get the pairs of particles whose bounding boxes overlap.
+     * @return The overlapping pairs, in no particular order.
+     */
+    const std::vector<Pair>& getPairs() const;
+
+    /**@brief Access to the pairs that started to overlap.
+     *
+     * Get the pairs that overlap after the last update but did not before.
+     * After a rebuild, this is the set of all overlapping pairs.
+     * @return The pairs added by the last update.
+     */
+    const std::vector<Pair>& getAddedPairs() const;
+
+    /**@brief Access to the pairs that stopped to overlap.
+     *
+     * Get the pairs that overlapped before the last update but do not anymore.
+     * @return The pairs removed by the last update.
+     */
+    const std::vector<Pair>& getRemovedPairs() const;
+
+    /**@brief Reserved size of the internal buffers.
+     *
+     * Used to detect the allocations of a simulation step.
+     * @param sizes The array to which the capacity of each buffer, in bytes,
+     * is appended.
+     */
+    void getBufferSizes(std::vector<size_t>& sizes) const;
+
+private:
+    /**@brief A bound of a box along an axis.
+     *
+     * The particle index and a flag telling if this is the upper bound
+     * are packed in a single integer: data = 2*particle + isMax.
+     */
+    struct Endpoint
+    {
+        float value;
+        unsigned int data;
+    };
+
+    void rebuild(const ParticleStore& particles);
+    void sortAxis(int axis);
+    void computeBox(size_t i, const glm::vec3& position, float radius, bool active);
+    static bool precedes(const Endpoint& a, const Endpoint& b);
+    bool overlap(unsigned int a, unsigned int b) const;
+    void addPair(unsigned int a, unsigned int b);
+    void removePair(unsigned int a, unsigned int b);
+    static unsigned long long pairKey(unsigned int a, unsigned int b);
+
+    unsigned long m_revision;
+
+    std::vector<glm::vec3> m_min;
+    std::vector<glm::vec3> m_max;
+    std::vector<Endpoint> m_endpoints[3];
+
+    /**@brief Overlapping pairs, stored contiguously. */
+    std::vector<Pair> m_pairs;
+    /**@brief Position of each overlapping pair in m_pairs. */
+    std::unordered_map<unsigned long long, size_t> m_pairIndices;
+
+    std::vector<Pair> m_addedPairs;
+    std::vector<Pair> m_removedPairs;
+};
+
+typedef std::shared_ptr<SweepAndPrune> SweepAndPrunePtr;
+
+#endif //SWEEP_AND_PRUNE_HPP
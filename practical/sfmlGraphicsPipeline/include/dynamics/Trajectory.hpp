@@ -0,0 +1,223 @@
+#ifndef TRAJECTORY_HPP
+#define TRAJECTORY_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ParticleStore.hpp"
+#include "ParticleSnapshot.hpp"
+
+/**@brief Record the trajectory of the particles of a system in a file.
+ *
+ * A trajectory file stores the positions and active flags of a fixed set of
+ * particles at each recorded step, so that a simulation can be replayed
+ * without being computed again, see TrajectoryPlayer.
+ *
+ * Positions are quantized on a grid whose step is the precision of the
+ * recording, and each frame only stores the difference with the previous
+ * frame, as variable length integers: a particle moving less than 64 grid
+ * steps per axis between two frames costs 3 bytes instead of 12. At the
+ * key frame interval given to open(), a key frame stores the quantized positions
+ * themselves, so that playback can start from any key frame. The differences
+ * are taken between quantized positions: the error of a replayed position is
+ * at most half the precision, whatever the number of frames.
+ *
+ * Frames are written as they are recorded. The index of the frames is
+ * appended when the recording is closed; the frames of a recording which was
+ * not closed, e.g. after a crash, are still found by the player.
+ */
+class TrajectoryRecorder
+{
+public:
+    TrajectoryRecorder();
+    /**@brief Close the recording and destroy the recorder. */
+    ~TrajectoryRecorder();
+
+    /**@brief Start a recording.
+     *
+     * Create the file and write its header. A recording already started
+     * is closed first.
+     * @param filename The path of the trajectory file.
+     * @param particleNumber The number of particles of each frame.
+     * @param precision The quantization step of the positions.
+     * @param keyframeInterval The number of frames between two key frames.
+     * @return False if the file could not be created, true otherwise.
+     */
+    bool open(const std::string& filename, size_t particleNumber, float precision = 1e-4f,
+              unsigned int keyframeInterval = 64);
+    /**@brief Close the recording.
+     *
+     * Write the index of the frames and complete the header.
+     * @return False if the file could not be written, true otherwise.
+     */
+    bool close();
+    /**@brief Check if a recording is started.
+     *
+     * @return True if frames can be recorded.
+     */
+    bool isOpen() const;
+
+    /**@brief Record a frame.
+     *
+     * @param store The particle store, with the number of particles given to open().
+     * @param time The time of the frame.
+     * @param slots The index in the store of each particle to record, in the
+     * order they are recorded, or an empty array to record them in the order
+     * of the store.
+     * @return False if the store does not match the recording or the frame
+     * could not be written, in which case the recording is closed. True otherwise.
+     */
+    bool record(const ParticleStore& store, float time,
+                const std::vector<unsigned int>& slots = std::vector<unsigned int>());
+
+    /**@brief Number of recorded frames.
+     *
+     * @return The number of frames recorded since open().
+     */
+    size_t getFrameNumber() const;
+    /**@brief Size of the recording.
+     *
+     * @return The number of bytes written since open().
+     */
+    uint64_t getSize() const;
+
+private:
+    std::ofstream m_file;
+    std::string m_filename;
+    size_t m_particleNumber;
+    float m_precision;
+    unsigned int m_keyframeInterval;
+    /**@brief Offset and time of each frame. */
+    std::vector<uint64_t> m_frameOffsets;
+    std::vector<float> m_frameTimes;
+    uint64_t m_size;
+    /**@brief Quantized positions of the last frame. */
+    std::vector<int32_t> m_quantized;
+    std::vector<unsigned char> m_active;
+    std::vector<unsigned char> m_gatheredActive;
+    /**@brief Encoded frame, reused from one frame to the next. */
+    std::vector<unsigned char> m_buffer;
+};
+
+typedef std::shared_ptr<TrajectoryRecorder> TrajectoryRecorderPtr;
+
+/**@brief Replay a trajectory recorded by a TrajectoryRecorder.
+ *
+ * The file is memory mapped, and the frames are decoded on demand into a
+ * ParticleSnapshot, which the particle and spring renderables can draw in
+ * place of the particles, see setTrajectoryPlayer(). Seeking to a frame
+ * decodes the frames from the previous key frame: its cost is bounded by
+ * the key frame interval, whatever the length of the recording. Playing the
+ * frames in order decodes a single frame each time.
+ */
+class TrajectoryPlayer
+{
+public:
+    TrajectoryPlayer();
+    /**@brief Unmap the recording and destroy the player. */
+    ~TrajectoryPlayer();
+
+    /**@brief Open a recording.
+     *
+     * A recording already opened is closed first. The snapshot is set to
+     * the first frame.
+     * @param filename The path of the trajectory file.
+     * @return False if the file could not be read or is not a valid
+     * trajectory, true otherwise.
+     */
+    bool open(const std::string& filename);
+    /**@brief Close the recording. */
+    void close();
+    /**@brief Check if a recording is opened.
+     *
+     * @return True if frames can be read.
+     */
+    bool isOpen() const;
+
+    /**@brief Access to the number of particles.
+     *
+     * @return The number of particles of each frame.
+     */
+    size_t getParticleNumber() const;
+    /**@brief Access to the number of frames.
+     *
+     * @return The number of frames of the recording.
+     */
+    size_t getFrameNumber() const;
+    /**@brief Access to the time of a frame.
+     *
+     * @param frame The index of the frame.
+     * @return The time given to TrajectoryRecorder::record() for this frame.
+     */
+    float getFrameTime(size_t frame) const;
+    /**@brief Find the frame displayed at a time.
+     *
+     * @param time The time to look for.
+     * @return The last frame whose time is not after the given one, or the
+     * first frame if there is none.
+     */
+    size_t findFrame(float time) const;
+
+    /**@brief Decode a frame.
+     *
+     * @param frame The index of the frame.
+     * @return False if the frame does not exist or is corrupted, in which
+     * case the snapshot is left unchanged. True otherwise.
+     */
+    bool seek(size_t frame);
+    /**@brief Place the recorded particles in the store of a system.
+     *
+     * A system records its particles in the order they were added, whatever
+     * the reorderings of its store. The snapshot is indexed as the store, so
+     * that the renderables find a particle at its index: the recorded
+     * particles are placed at the given indices. The current frame is
+     * decoded again. Closing the player forgets the indices.
+     * @param slots The index in the store of each recorded particle, in the
+     * order they are recorded, or an empty array to keep the recorded order.
+     * @return False if no recording is opened or the indices are not a
+     * permutation of the recorded particles, in which case they are left
+     * unchanged. True otherwise.
+     */
+    bool setSlots(const std::vector<unsigned int>& slots);
+
+    /**@brief Access to the current frame.
+     *
+     * @return The index of the frame in the snapshot.
+     */
+    size_t getFrame() const;
+    /**@brief Access to the current frame.
+     *
+     * The step of the snapshot is the index of the frame. The arrays are in
+     * the recorded order, or indexed as given to setSlots().
+     * @return The state of the particles at the last frame given to seek().
+     */
+    const ParticleSnapshot& getSnapshot() const;
+
+private:
+    bool decode(size_t frame);
+
+    const unsigned char* m_data;
+    size_t m_size;
+#ifndef __unix__
+    std::vector<unsigned char> m_fileData;
+#endif
+    size_t m_particleNumber;
+    float m_precision;
+    unsigned int m_keyframeInterval;
+    std::vector<uint64_t> m_frameOffsets;
+    std::vector<float> m_frameTimes;
+    /**@brief Quantized positions of the current frame. */
+    std::vector<int32_t> m_quantized;
+    /**@brief Index in the snapshot of each recorded particle, empty for the recorded order. */
+    std::vector<unsigned int> m_slots;
+    size_t m_frame;
+    ParticleSnapshot m_snapshot;
+};
+
+typedef std::shared_ptr<TrajectoryPlayer> TrajectoryPlayerPtr;
+
+#endif //TRAJECTORY_HPP
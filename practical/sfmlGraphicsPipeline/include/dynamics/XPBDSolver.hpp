@@ -0,0 +1,109 @@
+#ifndef XPBD_SOLVER_HPP
+#define XPBD_SOLVER_HPP
+
+#include <utility>
+#include "Solver.hpp"
+#include "SpatialHashGrid.hpp"
+
+/**@brief Extended position based dynamics solver.
+ *
+ * Instead of integrating spring forces, this solver moves the particles to
+ * satisfy constraints. Each time step is split into substeps. In each substep,
+ * the particles are first moved by the remaining forces (gravity, damping...),
+ * then the constraints are projected with a fixed number of Gauss-Seidel
+ * iterations, and the velocities are deduced from the displacements.
+ *
+ * Force fields that can be expressed as distance constraints, i.e. springs,
+ * are solved as compliant constraints (XPBD): a spring of stiffness k is a
+ * constraint of compliance 1/k, so the stiffness does not depend on the
+ * number of iterations or on the time step. Contacts with planes, meshes and
+ * between particles are inequality constraints. They are inelastic and
+ * frictionless.
+ *
+ * Since constraints are projected instead of integrated, the solver remains
+ * stable whatever the time step and the stiffness: large time steps only
+ * make the springs softer than they should be.
+ */
+class XPBDSolver : public Solver
+{
+public:
+    XPBDSolver();
+    ~XPBDSolver();
+
+    /**@brief Access to the number of substeps.
+     *
+     * @return The number of substeps of each time step.
+     */
+    unsigned int getSubsteps() const;
+    /**@brief Set the number of substeps.
+     *
+     * More substeps are more accurate than more iterations for the same cost.
+     * @param substeps The new number of substeps of each time step.
+     */
+    void setSubsteps(unsigned int substeps);
+
+    /**@brief Access to the number of iterations.
+     *
+     * @return The number of constraint projection iterations of each substep.
+     */
+    unsigned int getIterations() const;
+    /**@brief Set the number of iterations.
+     *
+     * @param iterations The new number of constraint projection iterations of each substep.
+     */
+    void setIterations(unsigned int iterations);
+
+    /**@brief Check if the solver resolves the collisions.
+     *
+     * @return True if contacts are solved as constraints by this solver.
+     */
+    bool getCollisions() const;
+    /**@brief Set if the solver resolves the collisions.
+     *
+     * If set to false, the dynamic system detects and resolves the collisions
+     * after the solver, as with the other solvers.
+     * @param onOff True if contacts should be solved as constraints by this solver.
+     */
+    void setCollisions(bool onOff);
+
+private:
+    void do_solve(const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields);
+    bool do_handlesCollisions() const;
+    void do_solveWithCollisions(const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields,
+                                const std::vector<PlanePtr>& planeObstacles,
+                                const std::vector<MeshObstaclePtr>& meshObstacles);
+
+    /**@brief Split the force fields into constraints and external forces. */
+    void gatherConstraints(ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields);
+    /**@brief Find the contacts that can happen during the time step. */
+    void detectContacts(float dt, const ParticleStore& particles, const std::vector<PlanePtr>& planeObstacles,
+                        const std::vector<MeshObstaclePtr>& meshObstacles);
+    void step(float dt, ParticleStore& particles, const std::vector<PlanePtr>& planeObstacles,
+              const std::vector<MeshObstaclePtr>& meshObstacles);
+
+    unsigned int m_substeps;
+    unsigned int m_iterations;
+    bool m_collisions;
+
+    std::vector<DistanceConstraint> m_constraints;
+    /**@brief Lagrange multiplier of each distance constraint, over a substep. */
+    std::vector<float> m_lambdas;
+    /**@brief Forces of the force fields that are not constraints. */
+    std::vector<glm::vec3> m_externalForces;
+    std::vector<glm::vec3> m_constraintForces;
+    std::vector<unsigned char> m_constrainedFields;
+    std::vector<glm::vec3> m_previousPositions;
+    std::vector<float> m_inverseMasses;
+
+    /**@brief Contact candidates, as (particle, plane) pairs. */
+    std::vector<std::pair<unsigned int, unsigned int> > m_planeContacts;
+    /**@brief Contact candidates, as (particle, mesh) pairs. */
+    std::vector<std::pair<unsigned int, unsigned int> > m_meshContacts;
+    /**@brief Contact candidates, as (particle, particle) pairs. */
+    std::vector<std::pair<unsigned int, unsigned int> > m_particleContacts;
+    SpatialHashGrid m_grid;
+};
+
+typedef std::shared_ptr<XPBDSolver> XPBDSolverPtr;
+
+#endif //XPBD_SOLVER_HPP
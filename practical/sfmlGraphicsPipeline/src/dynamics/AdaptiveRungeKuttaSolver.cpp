@@ -0,0 +1,200 @@
+#include "./../../include/dynamics/AdaptiveRungeKuttaSolver.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+AdaptiveRungeKuttaSolver::AdaptiveRungeKuttaSolver() :
+    m_absoluteTolerance(1e-4),
+    m_relativeTolerance(1e-3),
+    m_minimumStep(1e-5),
+    m_maximumStep(0.1),
+    m_step(0),
+    m_evaluations(0),
+    m_rejectedSteps(0)
+{
+
+}
+
+AdaptiveRungeKuttaSolver::~AdaptiveRungeKuttaSolver()
+{
+
+}
+
+float AdaptiveRungeKuttaSolver::getAbsoluteTolerance() const
+{
+    return m_absoluteTolerance;
+}
+
+float AdaptiveRungeKuttaSolver::getRelativeTolerance() const
+{
+    return m_relativeTolerance;
+}
+
+void AdaptiveRungeKuttaSolver::setTolerance(float absolute, float relative)
+{
+    m_absoluteTolerance = absolute;
+    m_relativeTolerance = relative;
+}
+
+float AdaptiveRungeKuttaSolver::getMinimumStep() const
+{
+    return m_minimumStep;
+}
+
+float AdaptiveRungeKuttaSolver::getMaximumStep() const
+{
+    return m_maximumStep;
+}
+
+void AdaptiveRungeKuttaSolver::setStepRange(float minimum, float maximum)
+{
+    m_minimumStep = minimum;
+    m_maximumStep = std::max(minimum, maximum);
+}
+
+unsigned long AdaptiveRungeKuttaSolver::getEvaluations() const
+{
+    return m_evaluations;
+}
+
+unsigned long AdaptiveRungeKuttaSolver::getRejectedSteps() const
+{
+    return m_rejectedSteps;
+}
+
+float AdaptiveRungeKuttaSolver::do_getSuggestedDt() const
+{
+    return m_step;
+}
+
+void AdaptiveRungeKuttaSolver::do_solve(const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields)
+{
+    std::vector<glm::vec3>& positions = particles.getPositions();
+    std::vector<glm::vec3>& velocities = particles.getVelocities();
+    std::vector<glm::vec3>& forces = particles.getForces();
+    const std::vector<float>& invMasses = particles.getInverseMasses();
+    const std::vector<unsigned char>& fixed = particles.getFixed();
+    const std::vector<unsigned char>& sleeping = particles.getSleeping();
+    const size_t n = particles.size();
+
+    m_moving.resize(n);
+    for(size_t i = 0; i < n; ++i)
+        m_moving[i] = !fixed[i] && !sleeping[i];
+
+    //The forces at the start of the time step are already computed
+    m_stageVelocities[0] = velocities;
+    m_stageForces[0] = forces;
+    for(int stage = 1; stage < 4; ++stage)
+    {
+        m_stageVelocities[stage].resize(n);
+        m_stageForces[stage].resize(n);
+    }
+    if(m_step <= 0.0f)
+        m_step = std::min(dt, m_maximumStep);
+
+    float remaining = dt;
+    while(remaining > 0.0f)
+    {
+        //Do not leave a tiny step at the end of the time step
+        const float h = m_step >= 0.99f*remaining ? remaining : m_step;
+        const bool truncated = h < m_step;
+        m_startPositions = positions;
+        m_startVelocities = velocities;
+
+        //Bogacki-Shampine stages. The last stage is the third order solution.
+        setStage(particles, h, 0.5f, 0.0f, 0.0f);
+        m_stageVelocities[1] = velocities;
+        evaluateForces(particles, forceFields, m_stageForces[1]);
+        setStage(particles, h, 0.0f, 0.75f, 0.0f);
+        m_stageVelocities[2] = velocities;
+        evaluateForces(particles, forceFields, m_stageForces[2]);
+        setStage(particles, h, 2.0f/9.0f, 1.0f/3.0f, 4.0f/9.0f);
+        m_stageVelocities[3] = velocities;
+        evaluateForces(particles, forceFields, m_stageForces[3]);
+
+        //The error is the difference with the embedded second order solution
+        float ratio = 0.0f;
+        for(size_t i = 0; i < n; ++i)
+        {
+            if(!m_moving[i]) continue;
+            const glm::vec3 positionError = h*(-5.0f/72.0f*m_stageVelocities[0][i] + 1.0f/12.0f*m_stageVelocities[1][i]
+                                               + 1.0f/9.0f*m_stageVelocities[2][i] - 0.125f*m_stageVelocities[3][i]);
+            const glm::vec3 velocityError = h*invMasses[i]*(-5.0f/72.0f*m_stageForces[0][i] + 1.0f/12.0f*m_stageForces[1][i]
+                                                            + 1.0f/9.0f*m_stageForces[2][i] - 0.125f*m_stageForces[3][i]);
+            const float positionScale = m_absoluteTolerance
+                + m_relativeTolerance*std::max(glm::length(m_startPositions[i]), glm::length(positions[i]));
+            const float velocityScale = m_absoluteTolerance
+                + m_relativeTolerance*std::max(glm::length(m_startVelocities[i]), glm::length(velocities[i]));
+            ratio = std::max(ratio, glm::length(positionError)/positionScale);
+            ratio = std::max(ratio, glm::length(velocityError)/velocityScale);
+        }
+
+        //Third order method: the error grows as the cube of the step size
+        const float factor = ratio > 0.0f ? std::min(std::max(0.9f*std::pow(ratio, -1.0f/3.0f), 0.2f), 5.0f) : 5.0f;
+        if(ratio <= 1.0f || h <= m_minimumStep)
+        {
+            remaining -= h;
+            //The last stage of this step is the first one of the next step
+            std::swap(m_stageVelocities[0], m_stageVelocities[3]);
+            std::swap(m_stageForces[0], m_stageForces[3]);
+            //A step shortened to end the time step says little about larger ones
+            m_step = truncated ? std::min(m_step, h*factor) : h*factor;
+        }
+        else
+        {
+            positions = m_startPositions;
+            velocities = m_startVelocities;
+            ++m_rejectedSteps;
+            m_step = h*std::min(factor, 1.0f);
+        }
+        m_step = std::min(std::max(m_step, m_minimumStep), m_maximumStep);
+    }
+
+    //Leave the forces of the final state in the store
+    forces = m_stageForces[0];
+}
+
+void AdaptiveRungeKuttaSolver::setStage(ParticleStore& particles, float h, float a1, float a2, float a3)
+{
+    std::vector<glm::vec3>& positions = particles.getPositions();
+    std::vector<glm::vec3>& velocities = particles.getVelocities();
+    const std::vector<float>& invMasses = particles.getInverseMasses();
+    const size_t n = particles.size();
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(!m_moving[i]) continue;
+        positions[i] = m_startPositions[i] + h*(a1*m_stageVelocities[0][i] + a2*m_stageVelocities[1][i]
+                                                + a3*m_stageVelocities[2][i]);
+        velocities[i] = m_startVelocities[i] + h*invMasses[i]*(a1*m_stageForces[0][i] + a2*m_stageForces[1][i]
+                                                               + a3*m_stageForces[2][i]);
+    }
+}
+
+void AdaptiveRungeKuttaSolver::evaluateForces(ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields,
+                                              std::vector<glm::vec3>& forces)
+{
+    ++m_evaluations;
+    forces.assign(particles.size(), glm::vec3(0.0, 0.0, 0.0));
+
+    //Force fields that cannot use a separate array add their forces to the
+    //particles: gather them from the store afterwards
+    std::vector<glm::vec3>& storeForces = particles.getForces();
+    bool storeCleared = false;
+    for(const ForceFieldPtr& f : forceFields)
+    {
+        if(f->addForce(particles, forces))
+            continue;
+        if(!storeCleared)
+        {
+            std::fill(storeForces.begin(), storeForces.end(), glm::vec3(0.0, 0.0, 0.0));
+            storeCleared = true;
+        }
+        f->addForce();
+    }
+    if(storeCleared)
+    {
+        for(size_t i = 0; i < forces.size(); ++i)
+            forces[i] += storeForces[i];
+    }
+}
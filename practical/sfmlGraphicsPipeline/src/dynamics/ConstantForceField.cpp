@@ -8,10 +8,89 @@ ConstantForceField::ConstantForceField(const std::vector<ParticlePtr>& particles
 
 void ConstantForceField::do_addForce()
 {
-    for(ParticlePtr p : m_particles)
+    ParticleStore* store = m_indices.update(m_particles);
+    if(store)
     {
-        p->incrForce(m_force*p->getMass());
+        do_addForce(*store, store->getForces());
     }
+    else
+    {
+        for(ParticlePtr p : m_particles)
+        {
+            p->incrForce(m_force*p->getMass());
+        }
+    }
+}
+
+bool ConstantForceField::do_addForce(const ParticleStore& store, std::vector<glm::vec3>& forces)
+{
+    if(m_indices.update(m_particles) != &store)
+        return false;
+
+    const std::vector<float>& invMasses = store.getInverseMasses();
+    const std::vector<unsigned char>& sleeping = store.getSleeping();
+    for(size_t i : m_indices.getIndices())
+    {
+        if(!sleeping[i])
+            forces[i] += (1.0f/invMasses[i])*m_force;
+    }
+    return true;
+}
+
+bool ConstantForceField::do_prepareRange(const ParticleStore& store)
+{
+    return m_indices.update(m_particles) == &store;
+}
+
+void ConstantForceField::do_addForce(const ParticleStore& store, size_t begin, size_t end, std::vector<glm::vec3>& forces)
+{
+    const std::vector<float>& invMasses = store.getInverseMasses();
+    const std::vector<unsigned char>& sleeping = store.getSleeping();
+    const glm::vec3 force = m_force;
+    if(m_indices.coversRange(begin, end))
+    {
+        //The field influences the whole range: skip the indirection
+        for(size_t i = begin; i < end; ++i)
+        {
+            if(!sleeping[i])
+                forces[i] += (1.0f/invMasses[i])*force;
+        }
+        return;
+    }
+    const std::pair<const size_t*, const size_t*> range = m_indices.getRange(begin, end);
+    for(const size_t* i = range.first; i != range.second; ++i)
+    {
+        if(!sleeping[*i])
+            forces[*i] += (1.0f/invMasses[*i])*force;
+    }
+}
+
+bool ConstantForceField::do_addJacobianProduct(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                               const std::vector<glm::vec3>& y, std::vector<glm::vec3>& out)
+{
+    //A constant force does not depend on positions nor velocities
+    return true;
+}
+
+bool ConstantForceField::do_addJacobianDiagonal(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                                std::vector<glm::vec3>& diagonal)
+{
+    return true;
+}
+
+void ConstantForceField::do_getParameters(std::vector<float>& parameters) const
+{
+    parameters.push_back(m_force.x);
+    parameters.push_back(m_force.y);
+    parameters.push_back(m_force.z);
+}
+
+bool ConstantForceField::do_setParameters(const float* parameters, size_t count)
+{
+    if(count != 3)
+        return false;
+    m_force = glm::vec3(parameters[0], parameters[1], parameters[2]);
+    return true;
 }
 
 const std::vector<ParticlePtr> ConstantForceField::getParticles()
@@ -22,6 +101,7 @@ const std::vector<ParticlePtr> ConstantForceField::getParticles()
 void ConstantForceField::setParticles(const std::vector<ParticlePtr>& particles)
 {
     m_particles = particles;
+    m_indices.invalidate();
 }
 
 const glm::vec3& ConstantForceField::getForce()
@@ -50,11 +50,23 @@ void ConstantForceFieldRenderable::do_draw()
     m_positions.resize(2.0*particles.size());
     m_colors.resize(2.0*particles.size());
     m_normals.resize(2.0*particles.size());
+    glm::vec3 force;
+    if(m_thread)
+    {
+        //The force can be changed by the commands of the worker
+        std::unique_lock<std::mutex> lock = m_thread->lockParameters();
+        force = m_forceField->getForce();
+    }
+    else
+    {
+        force = m_forceField->getForce();
+    }
     int i=0; 
     for(ParticlePtr p : particles)
     {
-        m_positions[2*i+0] = p->getPosition();
-        m_positions[2*i+1] = p->getPosition() + 0.1f*m_forceField->getForce();
+        const glm::vec3 position = getPosition(p);
+        m_positions[2*i+0] = position;
+        m_positions[2*i+1] = position + 0.1f*force;
         m_colors[2*i+0] = glm::vec4(1.0,0.0,0.0,1.0);
         m_colors[2*i+1] = glm::vec4(1.0,0.0,0.0,1.0);
         m_normals[2*i+0] = glm::vec3(1.0,0.0,0.0);
@@ -119,6 +131,18 @@ void ConstantForceFieldRenderable::do_draw()
 
 void ConstantForceFieldRenderable::do_animate(float time) {}
 
+void ConstantForceFieldRenderable::setSimulationThread(SimulationThreadPtr thread)
+{
+    m_thread = thread;
+}
+
+glm::vec3 ConstantForceFieldRenderable::getPosition(const ParticlePtr& particle) const
+{
+    if(m_thread)
+        return m_thread->getSnapshot().positions[particle->getIndex()];
+    return particle->getPosition();
+}
+
 ConstantForceFieldRenderable::~ConstantForceFieldRenderable()
 {
     glcheck(glDeleteBuffers(1, &m_pBuffer));
@@ -0,0 +1,230 @@
+#include "./../../include/dynamics/ContactBuffer.hpp"
+
+#include <algorithm>
+
+static const unsigned long long PLANE_KEY_FLAG = 1ull << 63;
+static const unsigned long long MESH_KEY_FLAG = 1ull << 62;
+
+static unsigned long long contactKey(const Contact& c)
+{
+    const unsigned long long flag = c.isPlane ? PLANE_KEY_FLAG : c.isMesh ? MESH_KEY_FLAG : 0;
+    if(flag)
+        return flag | (static_cast<unsigned long long>(c.particle2) << 32) | c.particle1;
+    return (static_cast<unsigned long long>(c.particle1) << 32) | c.particle2;
+}
+
+ContactBuffer::ContactBuffer() :
+    m_revision(0)
+{}
+
+ContactBuffer::~ContactBuffer()
+{}
+
+void ContactBuffer::beginStep(unsigned long revision)
+{
+    std::swap(m_contacts, m_previousContacts);
+    m_contacts.clear();
+    if(revision != m_revision)
+    {
+        m_previousContacts.clear();
+        m_revision = revision;
+    }
+}
+
+void ContactBuffer::addParticleParticle(unsigned int particle1, unsigned int particle2)
+{
+    if(particle1 > particle2) std::swap(particle1, particle2);
+    Contact c;
+    c.particle1 = particle1;
+    c.particle2 = particle2;
+    c.isPlane = false;
+    c.isMesh = false;
+    c.key = contactKey(c);
+    c.normal = glm::vec3(0.0, 0.0, 0.0);
+    c.effectiveMass = 0;
+    c.targetVelocity = 0;
+    c.impulse = 0;
+    m_contacts.push_back(c);
+}
+
+void ContactBuffer::addParticlePlane(unsigned int particle, unsigned int plane)
+{
+    Contact c;
+    c.particle1 = particle;
+    c.particle2 = plane;
+    c.isPlane = true;
+    c.isMesh = false;
+    c.key = contactKey(c);
+    c.normal = glm::vec3(0.0, 0.0, 0.0);
+    c.effectiveMass = 0;
+    c.targetVelocity = 0;
+    c.impulse = 0;
+    m_contacts.push_back(c);
+}
+
+void ContactBuffer::addParticleMesh(unsigned int particle, unsigned int mesh)
+{
+    Contact c;
+    c.particle1 = particle;
+    c.particle2 = mesh;
+    c.isPlane = false;
+    c.isMesh = true;
+    c.key = contactKey(c);
+    c.normal = glm::vec3(0.0, 0.0, 0.0);
+    c.effectiveMass = 0;
+    c.targetVelocity = 0;
+    c.impulse = 0;
+    m_contacts.push_back(c);
+}
+
+size_t ContactBuffer::matchPrevious()
+{
+    //Previous contacts are already sorted: a merge finds the matching keys
+    auto byKey = [](const Contact& a, const Contact& b) { return a.key < b.key; };
+    std::sort(m_contacts.begin(), m_contacts.end(), byKey);
+
+    size_t matched = 0;
+    std::vector<Contact>::const_iterator previous = m_previousContacts.begin();
+    for(Contact& c : m_contacts)
+    {
+        while(previous != m_previousContacts.end() && previous->key < c.key)
+            ++previous;
+        if(previous != m_previousContacts.end() && previous->key == c.key)
+        {
+            c.impulse = previous->impulse;
+            ++matched;
+        }
+        else
+        {
+            c.impulse = 0;
+        }
+    }
+    return matched;
+}
+
+size_t ContactBuffer::color(const std::vector<unsigned char>& fixed)
+{
+    const size_t contactNumber = m_contacts.size();
+    m_contactColors.resize(contactNumber);
+    m_uncolored.resize(contactNumber);
+    for(size_t k = 0; k < contactNumber; ++k)
+        m_uncolored[k] = k;
+
+    //Greedy coloring with a bit mask of 64 colors per particle. Contacts whose
+    //particles already use all of them are colored again by a later pass, with
+    //the next 64 colors.
+    size_t colorNumber = 0;
+    for(unsigned int base = 0; !m_uncolored.empty(); base += 64)
+    {
+        m_particleColors.assign(fixed.size(), 0);
+        m_remaining.clear();
+        for(unsigned int k : m_uncolored)
+        {
+            const Contact& c = m_contacts[k];
+            const bool moves1 = !fixed[c.particle1];
+            const bool moves2 = !c.isObstacle() && !fixed[c.particle2];
+            unsigned long long used = 0;
+            if(moves1) used |= m_particleColors[c.particle1];
+            if(moves2) used |= m_particleColors[c.particle2];
+            if(used == ~0ull)
+            {
+                m_remaining.push_back(k);
+                continue;
+            }
+
+            unsigned int color = 0;
+            while(used & (1ull << color)) ++color;
+            if(moves1) m_particleColors[c.particle1] |= 1ull << color;
+            if(moves2) m_particleColors[c.particle2] |= 1ull << color;
+            m_contactColors[k] = base + color;
+            colorNumber = std::max<size_t>(colorNumber, base + color + 1);
+        }
+        std::swap(m_uncolored, m_remaining);
+    }
+
+    //Counting sort of the contacts by color
+    m_colorStart.assign(colorNumber + 1, 0);
+    for(size_t k = 0; k < contactNumber; ++k)
+        ++m_colorStart[m_contactColors[k] + 1];
+    for(size_t color = 0; color < colorNumber; ++color)
+        m_colorStart[color + 1] += m_colorStart[color];
+    m_coloredContacts.resize(contactNumber);
+    m_remaining.assign(m_colorStart.begin(), m_colorStart.end() - 1);
+    for(size_t k = 0; k < contactNumber; ++k)
+        m_coloredContacts[m_remaining[m_contactColors[k]]++] = k;
+
+    return colorNumber;
+}
+
+const std::vector<unsigned int>& ContactBuffer::getColoredContacts() const
+{
+    return m_coloredContacts;
+}
+
+const std::vector<unsigned int>& ContactBuffer::getColorStart() const
+{
+    return m_colorStart;
+}
+
+std::vector<Contact>& ContactBuffer::getContacts()
+{
+    return m_contacts;
+}
+
+const std::vector<Contact>& ContactBuffer::getContacts() const
+{
+    return m_contacts;
+}
+
+size_t ContactBuffer::size() const
+{
+    return m_contacts.size();
+}
+
+void ContactBuffer::restore(const Contact* contacts, size_t count, unsigned long revision)
+{
+    m_contacts.assign(contacts, contacts + count);
+    m_previousContacts.clear();
+    m_revision = revision;
+}
+
+void ContactBuffer::remap(const std::vector<unsigned int>& newIndices, unsigned long revision)
+{
+    for(Contact& c : m_contacts)
+    {
+        c.particle1 = newIndices[c.particle1];
+        if(!c.isObstacle())
+        {
+            c.particle2 = newIndices[c.particle2];
+            //The first particle of a pair has the lowest index
+            if(c.particle1 > c.particle2)
+            {
+                std::swap(c.particle1, c.particle2);
+                c.normal = -c.normal;
+            }
+        }
+        c.key = contactKey(c);
+    }
+    std::sort(m_contacts.begin(), m_contacts.end(), [](const Contact& a, const Contact& b) { return a.key < b.key; });
+    m_previousContacts.clear();
+    m_revision = revision;
+}
+
+void ContactBuffer::clear()
+{
+    m_contacts.clear();
+    m_previousContacts.clear();
+    m_revision = 0;
+}
+
+void ContactBuffer::getBufferSizes(std::vector<size_t>& sizes) const
+{
+    sizes.push_back(m_contacts.capacity()*sizeof(Contact));
+    sizes.push_back(m_previousContacts.capacity()*sizeof(Contact));
+    sizes.push_back(m_contactColors.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_colorStart.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_coloredContacts.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_particleColors.capacity()*sizeof(unsigned long long));
+    sizes.push_back(m_uncolored.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_remaining.capacity()*sizeof(unsigned int));
+}
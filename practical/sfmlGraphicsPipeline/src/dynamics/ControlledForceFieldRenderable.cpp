@@ -155,7 +155,17 @@ void ControlledForceFieldRenderable::do_animate( float time )
 
         m_status.intensity = glm::clamp( m_status.intensity, m_status.min_intensity, m_status.max_intensity );
 
-        m_force->setForce( m_status.movement * m_status.intensity );
+        const glm::vec3 force = m_status.movement * m_status.intensity;
+        if( m_thread )
+        {
+            //The worker reads the force during its steps
+            const ConstantForceFieldPtr forceField = m_force;
+            m_thread->post( [forceField, force]() { forceField->setForce( force ); } );
+        }
+        else
+        {
+            m_force->setForce( force );
+        }
     }
     m_status.last_time = time;
 }
@@ -171,8 +181,9 @@ void ControlledForceFieldRenderable::do_draw()
     //Display an arrow representing the movement of the particle
     for(ParticlePtr p : particles)
     {
-        m_positions.push_back(p->getPosition());
-        m_positions.push_back(p->getPosition()  + 2.0f* m_status.movement);
+        const glm::vec3 position = getPosition(p);
+        m_positions.push_back(position);
+        m_positions.push_back(position + 2.0f* m_status.movement);
         m_colors.push_back(glm::vec4(1.0,0.0,0.0,1.0));
         m_colors.push_back(glm::vec4(1.0,0.0,0.0,1.0));
         m_normals.push_back(glm::vec3(1.0,0.0,0.0));
@@ -233,3 +244,15 @@ void ControlledForceFieldRenderable::do_draw()
         glcheck(glDisableVertexAttribArray(normalLocation));
     }
 }
+
+void ControlledForceFieldRenderable::setSimulationThread(SimulationThreadPtr thread)
+{
+    m_thread = thread;
+}
+
+glm::vec3 ControlledForceFieldRenderable::getPosition(const ParticlePtr& particle) const
+{
+    if( m_thread )
+        return m_thread->getSnapshot().positions[particle->getIndex()];
+    return particle->getPosition();
+}
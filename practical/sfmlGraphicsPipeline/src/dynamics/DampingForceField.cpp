@@ -8,10 +8,101 @@ DampingForceField::DampingForceField(const std::vector<ParticlePtr> particles, c
 
 void DampingForceField::do_addForce()
 {
-    for(ParticlePtr p : m_particles)
+    ParticleStore* store = m_indices.update(m_particles);
+    if(store)
     {
-        p->incrForce(-m_damping*p->getVelocity());
+        do_addForce(*store, store->getForces());
     }
+    else
+    {
+        for(ParticlePtr p : m_particles)
+        {
+            p->incrForce(-m_damping*p->getVelocity());
+        }
+    }
+}
+
+bool DampingForceField::do_addForce(const ParticleStore& store, std::vector<glm::vec3>& forces)
+{
+    if(m_indices.update(m_particles) != &store)
+        return false;
+
+    const std::vector<glm::vec3>& velocities = store.getVelocities();
+    const std::vector<unsigned char>& sleeping = store.getSleeping();
+    for(size_t i : m_indices.getIndices())
+    {
+        if(!sleeping[i])
+            forces[i] -= m_damping*velocities[i];
+    }
+    return true;
+}
+
+bool DampingForceField::do_prepareRange(const ParticleStore& store)
+{
+    return m_indices.update(m_particles) == &store;
+}
+
+void DampingForceField::do_addForce(const ParticleStore& store, size_t begin, size_t end, std::vector<glm::vec3>& forces)
+{
+    const std::vector<glm::vec3>& velocities = store.getVelocities();
+    const std::vector<unsigned char>& sleeping = store.getSleeping();
+    const float damping = m_damping;
+    if(m_indices.coversRange(begin, end))
+    {
+        //The field influences the whole range: skip the indirection
+        for(size_t i = begin; i < end; ++i)
+        {
+            if(!sleeping[i])
+                forces[i] -= damping*velocities[i];
+        }
+        return;
+    }
+    const std::pair<const size_t*, const size_t*> range = m_indices.getRange(begin, end);
+    for(const size_t* i = range.first; i != range.second; ++i)
+    {
+        if(!sleeping[*i])
+            forces[*i] -= damping*velocities[*i];
+    }
+}
+
+bool DampingForceField::do_addJacobianProduct(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                              const std::vector<glm::vec3>& y, std::vector<glm::vec3>& out)
+{
+    if(m_indices.update(m_particles) != &store)
+        return false;
+
+    //dF/dv = -damping * I
+    for(size_t i : m_indices.getIndices())
+    {
+        out[i] -= dampingFactor*m_damping*y[i];
+    }
+    return true;
+}
+
+bool DampingForceField::do_addJacobianDiagonal(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                               std::vector<glm::vec3>& diagonal)
+{
+    if(m_indices.update(m_particles) != &store)
+        return false;
+
+    for(size_t i : m_indices.getIndices())
+    {
+        diagonal[i] -= glm::vec3(dampingFactor*m_damping);
+    }
+    return true;
+}
+
+void DampingForceField::do_getParameters(std::vector<float>& parameters) const
+{
+    parameters.push_back(m_damping);
+}
+
+bool DampingForceField::do_setParameters(const float* parameters, size_t count)
+{
+    if(count != 1)
+        return false;
+    m_damping = parameters[0];
+    return true;
 }
 
 const std::vector<ParticlePtr> DampingForceField::getParticles()
@@ -22,6 +113,7 @@ const std::vector<ParticlePtr> DampingForceField::getParticles()
 void DampingForceField::setParticles(const std::vector<ParticlePtr>& particles)
 {
     m_particles = particles;
+    m_indices.invalidate();
 }
 
 const float& DampingForceField::getDamping()
@@ -1,19 +1,54 @@
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/norm.hpp>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "./../../include/gl_helper.hpp"
+#include "./../../include/log.hpp"
 #include "./../../include/dynamics/DynamicSystem.hpp"
 #include "./../../include/dynamics/ParticlePlaneCollision.hpp"
 #include "./../../include/dynamics/ParticleParticleCollision.hpp"
 
 
 DynamicSystem::DynamicSystem() :
+    m_store(std::make_shared<ParticleStore>()),
+    m_parallelForces(false),
+    m_deterministicForces(false),
     m_dt(0.1),
     m_restitution(1.0),
-    m_handleCollisions(true)
+    m_handleCollisions(true),
+    m_restitutionThreshold(0.5),
+    m_broadPhase(BRUTE_FORCE_BROAD_PHASE),
+    m_collisionIterations(4),
+    m_warmStarting(true),
+    m_parallelCollisions(false),
+    m_continuousCollisions(false),
+    m_maximumImpacts(4),
+    m_sleeping(false),
+    m_sleepVelocity(0.1),
+    m_sleepDelay(0.5),
+    m_sleepRevision(0),
+    m_reorderInterval(0),
+    m_stepsSinceReorder(0),
+    m_recordingTime(0),
+    m_lastStepTimings(),
+    m_loggedSteps(0)
 {
 }
 
@@ -25,7 +60,18 @@ const std::vector<ParticlePtr>& DynamicSystem::getParticles() const
 
 void DynamicSystem::setParticles(const std::vector<ParticlePtr> &particles)
 {
-    m_particles = particles;
+    for(ParticlePtr p : m_particles)
+        p->detach();
+    m_store->clear();
+    m_particles.clear();
+    m_particleSlots.clear();
+    for(ParticlePtr p : particles)
+        addParticle(p);
+}
+
+ParticleStorePtr DynamicSystem::getParticleStore() const
+{
+    return m_store;
 }
 
 const std::vector<ForceFieldPtr>& DynamicSystem::getForceFields() const
@@ -38,6 +84,25 @@ void DynamicSystem::setForceFields(const std::vector<ForceFieldPtr> &forceFields
     m_forceFields = forceFields;
 }
 
+bool DynamicSystem::getParallelForces() const
+{
+    return m_parallelForces;
+}
+
+void DynamicSystem::setParallelForces(bool onOff)
+{
+    m_parallelForces = onOff;
+}
+
+bool DynamicSystem::getDeterministicForces() const
+{
+    return m_deterministicForces;
+}
+
+void DynamicSystem::setDeterministicForces(bool onOff)
+{
+    m_deterministicForces = onOff;
+}
 
 float DynamicSystem::getDt() const
 {
@@ -53,9 +118,19 @@ DynamicSystem::~DynamicSystem() {}
 
 void DynamicSystem::clear()
 {
+    for(ParticlePtr p : m_particles)
+        p->detach();
+    m_store->clear();
     m_particles.clear();
+    m_particleSlots.clear();
+    m_sweepAndPrune.clear();
+    m_contacts.clear();
     m_forceFields.clear();
     m_planeObstacles.clear();
+    m_meshObstacles.clear();
+    m_emitters.clear();
+    stopRecording();
+    wakeUp();
 }
 
 bool DynamicSystem::getCollisionDetection()
@@ -68,8 +143,31 @@ void DynamicSystem::setCollisionsDetection(bool onOff)
     m_handleCollisions = onOff;
 }
 
+DynamicSystem::COLLISION_BROAD_PHASE DynamicSystem::getBroadPhase() const
+{
+    return m_broadPhase;
+}
+
+void DynamicSystem::setBroadPhase(const COLLISION_BROAD_PHASE& broadPhase)
+{
+    m_broadPhase = broadPhase;
+}
+
+const SpatialHashGrid& DynamicSystem::getSpatialHashGrid() const
+{
+    return m_grid;
+}
+
+const SweepAndPrune& DynamicSystem::getSweepAndPrune() const
+{
+    return m_sweepAndPrune;
+}
+
 void DynamicSystem::addParticle(ParticlePtr p)
 {
+    p->moveTo(m_store);
+    if(!m_particleSlots.empty())
+        m_particleSlots.push_back(p->getIndex());
     m_particles.push_back(p);
 }
 
@@ -83,6 +181,28 @@ void DynamicSystem::addPlaneObstacle(PlanePtr planeObstacle)
     m_planeObstacles.push_back(planeObstacle);
 }
 
+const std::vector<PlanePtr>& DynamicSystem::getPlaneObstacles() const
+{
+    return m_planeObstacles;
+}
+
+void DynamicSystem::addMeshObstacle(MeshObstaclePtr meshObstacle)
+{
+    m_meshObstacles.push_back(meshObstacle);
+}
+
+const std::vector<MeshObstaclePtr>& DynamicSystem::getMeshObstacles() const
+{
+    return m_meshObstacles;
+}
+
+void DynamicSystem::addParticleEmitter(ParticleEmitterPtr emitter)
+{
+    for(ParticlePtr p : emitter->getParticles())
+        addParticle(p);
+    m_emitters.push_back(emitter);
+}
+
 SolverPtr DynamicSystem::getSolver()
 {
     return m_solver;
@@ -95,68 +215,1058 @@ void DynamicSystem::setSolver(SolverPtr solver)
 
 void DynamicSystem::detectCollisions()
 {
+    const std::vector<glm::vec3>& positions = m_store->getPositions();
+    const std::vector<float>& radii = m_store->getRadii();
+    const std::vector<unsigned char>& sleeping = m_store->getSleeping();
+    const std::vector<unsigned char>& active = m_store->getActive();
+    const size_t n = m_store->size();
+
+    m_contacts.beginStep(m_store->getRevision());
+
     //Detect particle plane collisions
-    for(ParticlePtr p : m_particles)
+    for(size_t i=0; i<n; ++i)
     {
-        for(PlanePtr o : m_planeObstacles)
+        if(sleeping[i] || !active[i]) continue;
+        m_lastStepTimings.obstacleTests += m_planeObstacles.size();
+        for(size_t o=0; o<m_planeObstacles.size(); ++o)
         {
-            if(testParticlePlane(p, o))
+            if(testParticlePlane(positions[i], radii[i], *m_planeObstacles[o]))
             {
-                ParticlePlaneCollisionPtr c = std::make_shared<ParticlePlaneCollision>(p,o,m_restitution);
-                m_collisions.push_back(c);
+                m_contacts.addParticlePlane(i, o);
             }
         }
     }
 
+    //Detect particle mesh collisions. The hierarchy queries are independent:
+    //run them in parallel, then add the contacts in the order of the particles.
+    for(size_t o=0; o<m_meshObstacles.size(); ++o)
+    {
+        const MeshObstacle& mesh = *m_meshObstacles[o];
+        m_meshHits.assign(n, 0);
+        #pragma omp parallel for schedule(dynamic, 64)
+        for(long i=0; i<static_cast<long>(n); ++i)
+        {
+            if(sleeping[i] || !active[i]) continue;
+            glm::vec3 normal;
+            float distance;
+            m_meshHits[i] = mesh.findContact(positions[i], radii[i], normal, distance);
+        }
+        for(size_t i=0; i<n; ++i)
+        {
+            if(!sleeping[i] && active[i])
+                ++m_lastStepTimings.obstacleTests;
+            if(m_meshHits[i])
+                m_contacts.addParticleMesh(i, o);
+        }
+    }
+
     //Detect particle particle collisions
-    for(size_t i=0; i<m_particles.size(); ++i)
+    typedef std::chrono::steady_clock clock;
+    typedef std::chrono::duration<double> seconds;
+    if(m_broadPhase == SPATIAL_HASH_BROAD_PHASE)
     {
-        for(size_t j=i; j<m_particles.size(); ++j)
+        //Two particles can only collide if their centers are closer than
+        //twice the largest radius: it is enough to look in neighbor cells.
+        const clock::time_point start = clock::now();
+        float maxRadius = 0;
+        for(size_t i=0; i<n; ++i)
         {
-            ParticlePtr p1 = m_particles[i];
-            ParticlePtr p2 = m_particles[j];
-            if(testParticleParticle(p1,p2))
+            if(active[i]) maxRadius = std::max(maxRadius, radii[i]);
+        }
+        m_grid.build(positions, 2.0f*maxRadius, active);
+        m_lastStepTimings.broadPhase = seconds(clock::now() - start).count();
+
+        //Only awake particles look for neighbors: sleeping ones are found by them
+        for(size_t i=0; i<n; ++i)
+        {
+            if(sleeping[i] || !active[i]) continue;
+            m_grid.forEachNeighbor(positions[i], radii[i]+maxRadius, [&](size_t j)
             {
-                ParticleParticleCollisionPtr c = std::make_shared<ParticleParticleCollision>(p1,p2,m_restitution);
-                m_collisions.push_back(c);
+                if(j>i || sleeping[j]) detectParticleParticleCollision(i, j);
+            });
+        }
+    }
+    else if(m_broadPhase == SWEEP_AND_PRUNE_BROAD_PHASE)
+    {
+        const clock::time_point start = clock::now();
+        m_sweepAndPrune.update(*m_store);
+        m_lastStepTimings.broadPhase = seconds(clock::now() - start).count();
+        m_lastStepTimings.allocations += m_sweepAndPrune.getAddedPairs().size();
+        for(const SweepAndPrune::Pair& pair : m_sweepAndPrune.getPairs())
+        {
+            if(sleeping[pair.first] && sleeping[pair.second]) continue;
+            detectParticleParticleCollision(pair.first, pair.second);
+        }
+    }
+    else
+    {
+        for(size_t i=0; i<n; ++i)
+        {
+            if(!active[i]) continue;
+            for(size_t j=i+1; j<n; ++j)
+            {
+                if((sleeping[i] && sleeping[j]) || !active[j]) continue;
+                detectParticleParticleCollision(i, j);
             }
         }
     }
+
+    //Wake up the islands touched by awake particles before resolving the contacts
+    for(unsigned int p : m_wakeRequests)
+        wakeIsland(p);
+    m_wakeRequests.clear();
+}
+
+void DynamicSystem::detectParticleParticleCollision(size_t i, size_t j)
+{
+    const std::vector<glm::vec3>& positions = m_store->getPositions();
+    const std::vector<float>& radii = m_store->getRadii();
+    ++m_lastStepTimings.pairsTested;
+    if(testParticleParticle(positions[i], radii[i], positions[j], radii[j]))
+    {
+        m_contacts.addParticleParticle(i, j);
+        //A sleeping island is woken up by particles hitting it. Particles at
+        //rest on it do not wake it up: it supports them like a fixed obstacle.
+        const std::vector<unsigned char>& sleeping = m_store->getSleeping();
+        if(sleeping[i] != sleeping[j])
+        {
+            const size_t awake = sleeping[i] ? j : i;
+            if(glm::length2(m_store->getVelocities()[awake]) >= m_sleepVelocity*m_sleepVelocity)
+                m_wakeRequests.push_back(sleeping[i] ? i : j);
+        }
+    }
 }
 
 void DynamicSystem::solveCollisions()
 {
-    while(!m_collisions.empty())
+    std::vector<Contact>& contacts = m_contacts.getContacts();
+
+    //Contacts are sorted by key, so the resolution order does not depend
+    //on the broad phase.
+    m_lastStepTimings.warmStartedContacts = m_contacts.matchPrevious();
+
+    if(!m_parallelCollisions)
+    {
+        for(Contact& c : contacts)
+            prepareContact(c);
+        for(const Contact& c : contacts)
+            warmStartContact(c);
+        for(unsigned int iteration = 0; iteration < m_collisionIterations; ++iteration)
+        {
+            for(Contact& c : contacts)
+                solveContact(c);
+        }
+        return;
+    }
+
+    //Contacts of a color share no particle: each color is resolved in parallel,
+    //one color after the other.
+    const size_t colorNumber = m_contacts.color(m_store->getFixed());
+    const std::vector<unsigned int>& colorStart = m_contacts.getColorStart();
+    const std::vector<unsigned int>& colored = m_contacts.getColoredContacts();
+
+    #pragma omp parallel
     {
-        CollisionPtr collision = m_collisions.back();
-        collision->solveCollision();
-        m_collisions.pop_back();
+        for(size_t color = 0; color < colorNumber; ++color)
+        {
+            #pragma omp for schedule(static)
+            for(long k = colorStart[color]; k < long(colorStart[color+1]); ++k)
+                prepareContact(contacts[colored[k]]);
+        }
+        for(size_t color = 0; color < colorNumber; ++color)
+        {
+            #pragma omp for schedule(static)
+            for(long k = colorStart[color]; k < long(colorStart[color+1]); ++k)
+                warmStartContact(contacts[colored[k]]);
+        }
+        for(unsigned int iteration = 0; iteration < m_collisionIterations; ++iteration)
+        {
+            for(size_t color = 0; color < colorNumber; ++color)
+            {
+                #pragma omp for schedule(static)
+                for(long k = colorStart[color]; k < long(colorStart[color+1]); ++k)
+                    solveContact(contacts[colored[k]]);
+            }
+        }
     }
 }
 
-void DynamicSystem::computeSimulationStep()
+void DynamicSystem::solveContinuousCollisions()
 {
-    //Compute particle's force
-    for(ParticlePtr p : m_particles)
+    std::vector<glm::vec3>& positions = m_store->getPositions();
+    std::vector<glm::vec3>& velocities = m_store->getVelocities();
+    const std::vector<float>& radii = m_store->getRadii();
+    const std::vector<unsigned char>& fixed = m_store->getFixed();
+    const std::vector<unsigned char>& sleeping = m_store->getSleeping();
+    const std::vector<unsigned char>& active = m_store->getActive();
+    const size_t n = m_store->size();
+
+    for(size_t i = 0; i < n; ++i)
     {
-        p->setForce(glm::vec3(0.0,0.0,0.0));
+        if(fixed[i] || sleeping[i] || !active[i]) continue;
+
+        //A particle moving less than its radius cannot go through a plane or
+        //a mesh without the discrete detection noticing it
+        glm::vec3 start = m_stepStartPositions[i];
+        glm::vec3 motion = positions[i] - start;
+        if(glm::length2(motion) <= radii[i]*radii[i]) continue;
+
+        //Sweep the sphere along its motion, handling the impacts in order
+        unsigned int impact = 0;
+        for(; impact < m_maximumImpacts; ++impact)
+        {
+            float firstTime = 1.0f;
+            size_t firstPlane = m_planeObstacles.size();
+            for(size_t o = 0; o < m_planeObstacles.size(); ++o)
+            {
+                //As in the contact resolution, particles are kept on the side
+                //the normal points to. Particles entirely behind a plane are ignored.
+                const Plane& plane = *m_planeObstacles[o];
+                const float startDistance = glm::dot(start, plane.normal()) - plane.distanceToOrigin();
+                const float approach = -glm::dot(motion, plane.normal());
+                if(startDistance <= -radii[i] || approach <= 0.0f) continue;
+                const float distance = startDistance - radii[i];
+                if(distance >= approach) continue;
+                const float time = std::max(distance, 0.0f)/approach;
+                if(time < firstTime)
+                {
+                    firstTime = time;
+                    firstPlane = o;
+                }
+            }
+            bool found = firstPlane < m_planeObstacles.size();
+            glm::vec3 normal = found ? m_planeObstacles[firstPlane]->normal() : glm::vec3(0.0f);
+
+            //Meshes have no closed form time of impact: march the sphere along
+            //its motion by steps of at most its radius, so that the center
+            //cannot cross a triangle between two samples
+            if(!m_meshObstacles.empty() && radii[i] > 0.0f)
+            {
+                const unsigned int sampleNumber = static_cast<unsigned int>(std::ceil(glm::length(motion)/radii[i]));
+                for(unsigned int k = 0; k <= sampleNumber; ++k)
+                {
+                    const float time = static_cast<float>(k)/sampleNumber;
+                    if(found && time >= firstTime) break;
+                    for(size_t o = 0; o < m_meshObstacles.size(); ++o)
+                    {
+                        glm::vec3 meshNormal;
+                        float distance;
+                        if(m_meshObstacles[o]->findContact(start + time*motion, radii[i], meshNormal, distance)
+                           && glm::dot(motion, meshNormal) < 0.0f)
+                        {
+                            firstTime = time;
+                            normal = meshNormal;
+                            found = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            if(!found)
+                break;
+
+            //Move to the time of impact, then bounce for the rest of the step
+            //The discrete detection resolves the remaining overlap with a mesh
+            start += firstTime*motion;
+            motion *= 1.0f - firstTime;
+            motion -= (1.0f + m_restitution)*glm::dot(motion, normal)*normal;
+            const float normalVelocity = glm::dot(velocities[i], normal);
+            if(normalVelocity < 0.0f)
+                velocities[i] -= (1.0f + m_restitution)*normalVelocity*normal;
+            positions[i] = start + motion;
+        }
+        //Too many impacts: stop at the last one rather than risk going through
+        if(m_maximumImpacts > 0 && impact == m_maximumImpacts)
+            positions[i] = start;
     }
-    for(ForceFieldPtr f : m_forceFields)
+}
+
+void DynamicSystem::prepareContact(Contact& c)
+{
+    //Project the particles out of the obstacles and prepare the contact
+    std::vector<glm::vec3>& positions = m_store->getPositions();
+    const std::vector<glm::vec3>& velocities = m_store->getVelocities();
+    const std::vector<float>& invMasses = m_store->getInverseMasses();
+    const std::vector<float>& radii = m_store->getRadii();
+    const std::vector<unsigned char>& fixed = m_store->getFixed();
+    const std::vector<unsigned char>& sleeping = m_store->getSleeping();
+
+    //Sleeping particles are not moved by the contacts: they act as fixed ones
+    const unsigned int i = c.particle1;
+    const float w1 = (fixed[i] || sleeping[i]) ? 0.0f : invMasses[i];
+    float w2 = 0.0f;
+    float relativeVelocity = 0.0f;
+    if(c.isPlane)
+    {
+        const Plane& plane = *m_planeObstacles[c.particle2];
+        float distToPlane = glm::dot(positions[i], plane.normal())-plane.distanceToOrigin();
+        if(w1 > 0.0f)
+            positions[i] -= (distToPlane-radii[i])*plane.normal();
+        c.normal = plane.normal();
+        relativeVelocity = glm::dot(velocities[i], c.normal);
+    }
+    else if(c.isMesh)
+    {
+        //Earlier contacts may have moved the particle: find the closest point again
+        glm::vec3 normal;
+        float distance;
+        if(!m_meshObstacles[c.particle2]->findContact(positions[i], radii[i], normal, distance))
+        {
+            c.normal = glm::vec3(0.0, 0.0, 0.0);
+            c.effectiveMass = 0.0f;
+            c.targetVelocity = 0.0f;
+            c.impulse = 0.0f;
+            return;
+        }
+        if(w1 > 0.0f)
+            positions[i] -= (distance-radii[i])*normal;
+        c.normal = normal;
+        relativeVelocity = glm::dot(velocities[i], c.normal);
+    }
+    else
+    {
+        const unsigned int j = c.particle2;
+        w2 = (fixed[j] || sleeping[j]) ? 0.0f : invMasses[j];
+        glm::vec3 k = positions[i]-positions[j];
+        float particleParticleDist = glm::length(k);
+        k = (particleParticleDist > std::numeric_limits<float>::epsilon())
+                ? k/particleParticleDist : glm::vec3(0.0, 1.0, 0.0);
+        //Project each particle along the particle-particle vector, with a part of the
+        //interpenetration distance inversely proportional to its mass
+        float interpenetrationDist = radii[i]+radii[j]-particleParticleDist;
+        if(w1+w2 > 0.0f)
+        {
+            positions[i] += w1/(w1+w2)*interpenetrationDist*k;
+            positions[j] -= w2/(w1+w2)*interpenetrationDist*k;
+        }
+        c.normal = k;
+        relativeVelocity = glm::dot(k, velocities[i]-velocities[j]);
+    }
+
+    c.effectiveMass = (w1+w2 > 0.0f) ? 1.0f/(w1+w2) : 0.0f;
+    //Resting contacts do not bounce, otherwise stacks of particles never settle
+    c.targetVelocity = (relativeVelocity < -m_restitutionThreshold) ? -m_restitution*relativeVelocity : 0.0f;
+    if(!m_warmStarting || c.effectiveMass == 0.0f)
+        c.impulse = 0.0f;
+}
+
+void DynamicSystem::warmStartContact(const Contact& c)
+{
+    //Warm starting: apply the impulse of the previous step, once all the
+    //target velocities are computed from the velocities before collision
+    if(c.impulse == 0.0f) return;
+    std::vector<glm::vec3>& velocities = m_store->getVelocities();
+    const std::vector<float>& invMasses = m_store->getInverseMasses();
+    const std::vector<unsigned char>& fixed = m_store->getFixed();
+    const std::vector<unsigned char>& sleeping = m_store->getSleeping();
+    if(!fixed[c.particle1] && !sleeping[c.particle1])
+        velocities[c.particle1] += invMasses[c.particle1]*c.impulse*c.normal;
+    if(!c.isObstacle() && !fixed[c.particle2] && !sleeping[c.particle2])
+        velocities[c.particle2] -= invMasses[c.particle2]*c.impulse*c.normal;
+}
+
+void DynamicSystem::solveContact(Contact& c)
+{
+    //Sequential impulses: the accumulated impulse of the contact is
+    //corrected until the normal relative velocity reaches its target
+    if(c.effectiveMass == 0.0f) return;
+    std::vector<glm::vec3>& velocities = m_store->getVelocities();
+    const std::vector<float>& invMasses = m_store->getInverseMasses();
+    const std::vector<unsigned char>& fixed = m_store->getFixed();
+    const std::vector<unsigned char>& sleeping = m_store->getSleeping();
+    const unsigned int i = c.particle1;
+    const unsigned int j = c.particle2;
+    float relativeVelocity = c.isObstacle()
+            ? glm::dot(velocities[i], c.normal)
+            : glm::dot(velocities[i]-velocities[j], c.normal);
+    float impulse = std::max(c.impulse + (c.targetVelocity-relativeVelocity)*c.effectiveMass, 0.0f);
+    float delta = impulse - c.impulse;
+    c.impulse = impulse;
+
+    if(!fixed[i] && !sleeping[i])
+        velocities[i] += invMasses[i]*delta*c.normal;
+    if(!c.isObstacle() && !fixed[j] && !sleeping[j])
+        velocities[j] -= invMasses[j]*delta*c.normal;
+}
+
+//Number of particles of a block of the fused force fields: the forces,
+//velocities and masses of a block fit in the L1 cache
+static const long FORCE_BLOCK_SIZE = 1024;
+
+void DynamicSystem::computeForces()
+{
+    const long n = m_store->size();
+    const ParticleStore& store = *m_store;
+    std::vector<glm::vec3>& forces = m_store->getForces();
+
+    //Force fields computing the force of a particle from its own state only
+    //are evaluated together, block by block
+    m_blockForceFields.clear();
+    m_otherForceFields.clear();
+    for(const ForceFieldPtr& f : m_forceFields)
+    {
+        if(f->prepareRange(store))
+            m_blockForceFields.push_back(f.get());
+        else
+            m_otherForceFields.push_back(f.get());
+    }
+
+    int threadNumber = 1;
+#ifdef _OPENMP
+    if(m_parallelForces)
+        threadNumber = omp_get_max_threads();
+#endif
+
+    //Forces are cleared in the same pass, so that the store is read and
+    //written once for all the block force fields
+    const long blockNumber = (n + FORCE_BLOCK_SIZE - 1) / FORCE_BLOCK_SIZE;
+    #pragma omp parallel for schedule(static) num_threads(threadNumber) if(threadNumber > 1)
+    for(long b = 0; b < blockNumber; ++b)
+    {
+        const size_t begin = b * FORCE_BLOCK_SIZE;
+        const size_t end = std::min(begin + FORCE_BLOCK_SIZE, size_t(n));
+        std::fill(forces.begin() + begin, forces.begin() + end, glm::vec3(0.0, 0.0, 0.0));
+        for(ForceField* f : m_blockForceFields)
+            f->addForce(store, begin, end, forces);
+    }
+
+    if(threadNumber < 2 || m_otherForceFields.size() < 2)
+    {
+        for(ForceField* f : m_otherForceFields)
+        {
+            f->addForce();
+        }
+        return;
+    }
+
+    //Each thread evaluates a part of the other force fields in its own force
+    //array, so that force fields modifying the same particles do not conflict.
+    //The team can be smaller than requested, e.g. when nested in another
+    //parallel region: only the arrays of the threads of the team are used.
+    const long fieldNumber = m_otherForceFields.size();
+    int teamSize = 1;
+    m_parallelForceFields.assign(fieldNumber, 0);
+
+    #pragma omp parallel num_threads(threadNumber)
+    {
+#ifdef _OPENMP
+        #pragma omp single
+        {
+            teamSize = omp_get_num_threads();
+            m_threadForces.resize(teamSize);
+        }
+        std::vector<glm::vec3>& threadForces = m_threadForces[omp_get_thread_num()];
+#else
+        m_threadForces.resize(1);
+        std::vector<glm::vec3>& threadForces = m_threadForces[0];
+#endif
+        threadForces.assign(n, glm::vec3(0.0, 0.0, 0.0));
+
+        if(m_deterministicForces)
+        {
+            #pragma omp for schedule(static)
+            for(long f = 0; f < fieldNumber; ++f)
+                m_parallelForceFields[f] = m_otherForceFields[f]->addForce(store, threadForces);
+        }
+        else
+        {
+            #pragma omp for schedule(dynamic, 16)
+            for(long f = 0; f < fieldNumber; ++f)
+                m_parallelForceFields[f] = m_otherForceFields[f]->addForce(store, threadForces);
+        }
+
+        //Sum the thread arrays, always in the same order
+        #pragma omp for schedule(static)
+        for(long i = 0; i < n; ++i)
+        {
+            glm::vec3 force(0.0, 0.0, 0.0);
+            for(int t = 0; t < teamSize; ++t)
+                force += m_threadForces[t][i];
+            forces[i] += force;
+        }
+    }
+
+    for(long f = 0; f < fieldNumber; ++f)
     {
-        f->addForce();
+        if(!m_parallelForceFields[f])
+            m_otherForceFields[f]->addForce();
     }
+}
+
+void DynamicSystem::computeSimulationStep()
+{
+    typedef std::chrono::steady_clock clock;
+    typedef std::chrono::duration<double> seconds;
+    m_lastStepTimings = StepTimings();
+    m_stepStartBufferSizes.clear();
+    getBufferSizes(m_stepStartBufferSizes);
+
+    if(m_reorderInterval > 0 && ++m_stepsSinceReorder >= m_reorderInterval)
+        reorderParticles();
+
+    //Sleeping islands refer to particle indices: forget them if the particles changed
+    if(m_sleepRevision != m_store->getRevision())
+        wakeUp();
+
+    for(ParticleEmitterPtr e : m_emitters)
+        e->update(m_dt);
+
+    //Compute particle's force
+    clock::time_point start = clock::now();
+    computeForces();
+    clock::time_point end = clock::now();
+    m_lastStepTimings.forces = seconds(end - start).count();
 
     //Integrate position and velocity of particles
-    m_solver->solve(m_dt, m_particles);
+    start = end;
+    //Some solvers resolve the collisions themselves, as constraints
+    const bool solverCollisions = m_handleCollisions && m_solver->handlesCollisions();
+    const bool continuousCollisions = m_handleCollisions && !solverCollisions && m_continuousCollisions;
+    if(continuousCollisions)
+        m_stepStartPositions = m_store->getPositions();
+    if(solverCollisions)
+    {
+        m_solver->solveWithCollisions(m_dt, *m_store, m_forceFields, m_planeObstacles, m_meshObstacles);
+        m_contacts.beginStep(m_store->getRevision());
+    }
+    else
+    {
+        m_solver->solve(m_dt, *m_store, m_forceFields);
+    }
+    end = clock::now();
+    m_lastStepTimings.integration = seconds(end - start).count();
 
     //Detect and resolve collisions
-    if(m_handleCollisions)
+    if(m_handleCollisions && !solverCollisions)
     {
+        start = end;
+        if(continuousCollisions)
+            solveContinuousCollisions();
+        const clock::time_point detectionStart = clock::now();
         detectCollisions();
+        end = clock::now();
+        m_lastStepTimings.detection = seconds(end - start).count();
+        m_lastStepTimings.narrowPhase = seconds(end - detectionStart).count() - m_lastStepTimings.broadPhase;
+        m_lastStepTimings.contacts = m_contacts.size();
+
+        start = end;
         solveCollisions();
+        end = clock::now();
+        m_lastStepTimings.resolution = seconds(end - start).count();
+    }
+
+    if(m_sleeping)
+        updateSleeping();
+
+    //A buffer whose capacity changed has been allocated during the step
+    m_stepEndBufferSizes.clear();
+    getBufferSizes(m_stepEndBufferSizes);
+    for(size_t k = 0; k < m_stepEndBufferSizes.size(); ++k)
+    {
+        const size_t before = k < m_stepStartBufferSizes.size() ? m_stepStartBufferSizes[k] : 0;
+        if(m_stepEndBufferSizes[k] != before && m_stepEndBufferSizes[k] > 0)
+        {
+            ++m_lastStepTimings.allocations;
+            m_lastStepTimings.allocatedBytes += m_stepEndBufferSizes[k];
+        }
+    }
+
+    //Record the state at the end of the step
+    if(m_recorder)
+    {
+        m_recordingTime += m_dt;
+        if(!m_recorder->record(*m_store, m_recordingTime, m_particleSlots))
+            m_recorder.reset();
+    }
+
+    //Adaptive solvers choose the time step of the next step
+    const float suggestedDt = m_solver->getSuggestedDt();
+    if(suggestedDt > 0.0f)
+        m_dt = suggestedDt;
+
+    if(m_timingsLog.is_open())
+        writeTimingsLog();
+}
+
+void DynamicSystem::getBufferSizes(std::vector<size_t>& sizes) const
+{
+    m_store->getBufferSizes(sizes);
+    m_contacts.getBufferSizes(sizes);
+    m_grid.getBufferSizes(sizes);
+    m_sweepAndPrune.getBufferSizes(sizes);
+    m_islands.getBufferSizes(sizes);
+    sizes.push_back(m_parallelForceFields.capacity());
+    sizes.push_back(m_blockForceFields.capacity()*sizeof(ForceField*));
+    sizes.push_back(m_otherForceFields.capacity()*sizeof(ForceField*));
+    sizes.push_back(m_meshHits.capacity());
+    sizes.push_back(m_stepStartPositions.capacity()*sizeof(glm::vec3));
+    sizes.push_back(m_sleepTimers.capacity()*sizeof(float));
+    sizes.push_back(m_sleepMotions.capacity()*sizeof(float));
+    sizes.push_back(m_connections.capacity()*sizeof(std::pair<unsigned int, unsigned int>));
+    sizes.push_back(m_islandExcluded.capacity());
+    sizes.push_back(m_freeIslandSlots.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_sleepingIslandOf.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_rootSlots.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_nextSlots.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_wakeRequests.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_particleSlots.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_mortonKeys.capacity()*sizeof(uint64_t));
+    sizes.push_back(m_reorder.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_newIndices.capacity()*sizeof(unsigned int));
+    //Arrays of arrays last: their number may change from one step to the next
+    sizes.push_back(m_threadForces.capacity()*sizeof(std::vector<glm::vec3>));
+    for(const std::vector<glm::vec3>& forces : m_threadForces)
+        sizes.push_back(forces.capacity()*sizeof(glm::vec3));
+    sizes.push_back(m_sleepingIslands.capacity()*sizeof(std::vector<unsigned int>));
+    for(const std::vector<unsigned int>& island : m_sleepingIslands)
+        sizes.push_back(island.capacity()*sizeof(unsigned int));
+}
+
+void DynamicSystem::writeTimingsLog()
+{
+    const StepTimings& t = m_lastStepTimings;
+    m_timingsLog << m_loggedSteps++ << ","
+                 << m_store->size() << ","
+                 << t.forces << ","
+                 << t.integration << ","
+                 << t.detection << ","
+                 << t.broadPhase << ","
+                 << t.narrowPhase << ","
+                 << t.resolution << ","
+                 << t.pairsTested << ","
+                 << t.obstacleTests << ","
+                 << t.contacts << ","
+                 << t.warmStartedContacts << ","
+                 << t.allocations << ","
+                 << t.allocatedBytes << "\n";
+    if(!m_timingsLog)
+    {
+        LOG(error, "cannot write timings log");
+        m_timingsLog.close();
+    }
+}
+
+unsigned int DynamicSystem::getReorderInterval() const
+{
+    return m_reorderInterval;
+}
+
+void DynamicSystem::setReorderInterval(unsigned int steps)
+{
+    m_reorderInterval = steps;
+    m_stepsSinceReorder = 0;
+}
+
+//Spread the 10 lowest bits of a value to every third bit
+static uint32_t spreadBits(uint32_t v)
+{
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+void DynamicSystem::reorderParticles()
+{
+    m_stepsSinceReorder = 0;
+    const size_t n = m_store->size();
+    if(n < 2 || m_particles.size() != n)
+        return;
+    const std::vector<glm::vec3>& positions = m_store->getPositions();
+    const std::vector<unsigned char>& active = m_store->getActive();
+
+    //Morton code of the cell of each particle in a 1024^3 grid over the
+    //active particles: particles close in space get close codes
+    glm::vec3 minimum(std::numeric_limits<float>::max());
+    glm::vec3 maximum(-std::numeric_limits<float>::max());
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(!active[i]) continue;
+        minimum = glm::min(minimum, positions[i]);
+        maximum = glm::max(maximum, positions[i]);
+    }
+    if(minimum.x > maximum.x)
+        return;
+    const glm::vec3 extent = glm::max(maximum - minimum, glm::vec3(std::numeric_limits<float>::min()));
+    const glm::vec3 scale = 1023.0f/extent;
+    m_mortonKeys.resize(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        //Inactive particles, e.g. dead particles of an emitter, go last
+        uint64_t code = 1ull << 30;
+        if(active[i])
+        {
+            const glm::vec3 cell = glm::clamp((positions[i] - minimum)*scale, glm::vec3(0.0f), glm::vec3(1023.0f));
+            code = spreadBits(static_cast<uint32_t>(cell.x)) | (spreadBits(static_cast<uint32_t>(cell.y)) << 1)
+                | (spreadBits(static_cast<uint32_t>(cell.z)) << 2);
+        }
+        m_mortonKeys[i] = (code << 32) | i;
+    }
+    std::sort(m_mortonKeys.begin(), m_mortonKeys.end());
+
+    m_reorder.resize(n);
+    m_newIndices.resize(n);
+    bool identity = true;
+    for(size_t k = 0; k < n; ++k)
+    {
+        m_reorder[k] = m_mortonKeys[k] & 0xffffffff;
+        m_newIndices[m_reorder[k]] = k;
+        identity = identity && m_reorder[k] == k;
+    }
+    if(identity)
+        return;
+
+    const unsigned long previousRevision = m_store->getRevision();
+    m_store->permute(m_reorder);
+    if(m_particleSlots.empty())
+    {
+        m_particleSlots.resize(n);
+        for(size_t k = 0; k < n; ++k)
+            m_particleSlots[k] = k;
+    }
+    for(size_t k = 0; k < n; ++k)
+    {
+        m_particleSlots[k] = m_newIndices[m_particleSlots[k]];
+        m_particles[k]->setIndex(m_particleSlots[k]);
+    }
+
+    //Keep the warm starting and the sleeping islands across the reordering
+    m_contacts.remap(m_newIndices, m_store->getRevision());
+    if(m_sleepRevision == previousRevision && m_sleepTimers.size() == n)
+    {
+        std::vector<float> values(n);
+        for(size_t k = 0; k < n; ++k) values[k] = m_sleepTimers[m_reorder[k]];
+        m_sleepTimers.swap(values);
+        for(size_t k = 0; k < n; ++k) values[k] = m_sleepMotions[m_reorder[k]];
+        m_sleepMotions.swap(values);
+        std::vector<unsigned int> islands(n);
+        for(size_t k = 0; k < n; ++k) islands[k] = m_sleepingIslandOf[m_reorder[k]];
+        m_sleepingIslandOf.swap(islands);
+        for(std::vector<unsigned int>& island : m_sleepingIslands)
+        {
+            for(unsigned int& p : island)
+                p = m_newIndices[p];
+        }
+        for(unsigned int& p : m_wakeRequests)
+            p = m_newIndices[p];
+        m_sleepRevision = m_store->getRevision();
+    }
+}
+
+bool DynamicSystem::startRecording(const std::string& filename, float precision)
+{
+    m_recorder = std::make_shared<TrajectoryRecorder>();
+    if(!m_recorder->open(filename, m_store->size(), precision))
+    {
+        m_recorder.reset();
+        return false;
+    }
+    //The first frame is the state before the next step
+    m_recordingTime = 0;
+    if(!m_recorder->record(*m_store, m_recordingTime, m_particleSlots))
+    {
+        m_recorder.reset();
+        return false;
+    }
+    return true;
+}
+
+bool DynamicSystem::stopRecording()
+{
+    if(!m_recorder)
+        return true;
+    const bool closed = m_recorder->close();
+    m_recorder.reset();
+    return closed;
+}
+
+bool DynamicSystem::isRecording() const
+{
+    return m_recorder != nullptr;
+}
+
+const DynamicSystem::StepTimings& DynamicSystem::getLastStepTimings() const
+{
+    return m_lastStepTimings;
+}
+
+bool DynamicSystem::startTimingsLog(const std::string& filename)
+{
+    stopTimingsLog();
+    m_timingsLog.clear();
+    m_timingsLog.open(filename.c_str());
+    if(!m_timingsLog)
+    {
+        LOG(error, "cannot open timings log " << filename << " for writing");
+        m_timingsLog.close();
+        return false;
+    }
+    m_timingsLog << "step,particles,forces,integration,detection,broadPhase,narrowPhase,resolution,"
+                 << "pairsTested,obstacleTests,contacts,warmStartedContacts,allocations,allocatedBytes\n";
+    m_loggedSteps = 0;
+    return true;
+}
+
+void DynamicSystem::stopTimingsLog()
+{
+    if(m_timingsLog.is_open())
+        m_timingsLog.close();
+}
+
+bool DynamicSystem::isLoggingTimings() const
+{
+    return m_timingsLog.is_open();
+}
+
+unsigned int DynamicSystem::getCollisionIterations() const
+{
+    return m_collisionIterations;
+}
+
+void DynamicSystem::setCollisionIterations(unsigned int iterations)
+{
+    m_collisionIterations = iterations;
+}
+
+bool DynamicSystem::getContinuousCollisions() const
+{
+    return m_continuousCollisions;
+}
+
+void DynamicSystem::setContinuousCollisions(bool onOff)
+{
+    m_continuousCollisions = onOff;
+}
+
+unsigned int DynamicSystem::getMaximumImpacts() const
+{
+    return m_maximumImpacts;
+}
+
+void DynamicSystem::setMaximumImpacts(unsigned int impacts)
+{
+    m_maximumImpacts = impacts;
+}
+
+bool DynamicSystem::getWarmStarting() const
+{
+    return m_warmStarting;
+}
+
+void DynamicSystem::setWarmStarting(bool onOff)
+{
+    m_warmStarting = onOff;
+}
+
+bool DynamicSystem::getParallelCollisions() const
+{
+    return m_parallelCollisions;
+}
+
+void DynamicSystem::setParallelCollisions(bool onOff)
+{
+    m_parallelCollisions = onOff;
+}
+
+bool DynamicSystem::getSleeping() const
+{
+    return m_sleeping;
+}
+
+void DynamicSystem::setSleeping(bool onOff)
+{
+    m_sleeping = onOff;
+    if(!m_sleeping)
+        wakeUp();
+}
+
+float DynamicSystem::getSleepVelocity() const
+{
+    return m_sleepVelocity;
+}
+
+void DynamicSystem::setSleepVelocity(float velocity)
+{
+    m_sleepVelocity = velocity;
+}
+
+float DynamicSystem::getSleepDelay() const
+{
+    return m_sleepDelay;
+}
+
+void DynamicSystem::setSleepDelay(float delay)
+{
+    m_sleepDelay = delay;
+}
+
+void DynamicSystem::wakeUp()
+{
+    const size_t n = m_store->size();
+    //Woken particles must stay at rest for the whole delay before falling asleep again
+    const float threshold = m_sleepVelocity*m_sleepVelocity;
+    std::vector<unsigned char>& sleeping = m_store->getSleeping();
+    std::fill(sleeping.begin(), sleeping.end(), 0);
+    m_sleepTimers.assign(n, 0.0f);
+    m_sleepMotions.assign(n, threshold);
+    m_sleepingIslandOf.assign(n, 0);
+    m_sleepingIslands.clear();
+    m_freeIslandSlots.clear();
+    m_wakeRequests.clear();
+    m_sleepRevision = m_store->getRevision();
+}
+
+size_t DynamicSystem::getSleepingParticleNumber() const
+{
+    const std::vector<unsigned char>& sleeping = m_store->getSleeping();
+    return std::count(sleeping.begin(), sleeping.end(), 1);
+}
+
+void DynamicSystem::wakeIsland(unsigned int particle)
+{
+    std::vector<unsigned char>& sleeping = m_store->getSleeping();
+    if(!sleeping[particle]) return;
+
+    const unsigned int slot = m_sleepingIslandOf[particle];
+    const float threshold = m_sleepVelocity*m_sleepVelocity;
+    for(unsigned int p : m_sleepingIslands[slot])
+    {
+        sleeping[p] = 0;
+        m_sleepTimers[p] = 0.0f;
+        m_sleepMotions[p] = threshold;
+    }
+    m_sleepingIslands[slot].clear();
+    m_freeIslandSlots.push_back(slot);
+}
+
+//Marks the end of a list of sleeping islands in m_rootSlots and m_nextSlots
+static const unsigned int NO_ISLAND_SLOT = std::numeric_limits<unsigned int>::max();
+
+void DynamicSystem::updateSleeping()
+{
+    const size_t n = m_store->size();
+    std::vector<glm::vec3>& velocities = m_store->getVelocities();
+    const std::vector<unsigned char>& fixed = m_store->getFixed();
+    std::vector<unsigned char>& sleeping = m_store->getSleeping();
+
+    //Time each awake particle has been at rest. Resting contacts make the
+    //speed of stacked particles flicker, so the squared speed is smoothed
+    //over about a tenth of a second before being compared to the threshold.
+    const float threshold = m_sleepVelocity*m_sleepVelocity;
+    const float bias = std::exp(-m_dt/0.1f);
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(fixed[i] || sleeping[i]) continue;
+        m_sleepMotions[i] = bias*m_sleepMotions[i] + (1.0f-bias)*glm::length2(velocities[i]);
+        if(m_sleepMotions[i] < threshold)
+            m_sleepTimers[i] += m_dt;
+        else
+            m_sleepTimers[i] = 0.0f;
+    }
+
+    //Islands of awake particles, connected by contacts and force fields.
+    //Fixed particles do not move, so they do not connect the particles they touch.
+    //The particles of a sleeping island are connected too, so that an island
+    //resting on sleeping islands is connected to all of them.
+    m_islands.reset(n);
+    for(const std::vector<unsigned int>& island : m_sleepingIslands)
+    {
+        for(unsigned int p : island)
+            m_islands.merge(island.front(), p);
+    }
+    if(m_handleCollisions)
+    {
+        for(const Contact& c : m_contacts.getContacts())
+        {
+            if(!c.isObstacle() && !fixed[c.particle1] && !fixed[c.particle2])
+                m_islands.merge(c.particle1, c.particle2);
+        }
+    }
+    m_connections.clear();
+    for(ForceFieldPtr f : m_forceFields)
+        f->getConnections(*m_store, m_connections);
+    for(const std::pair<unsigned int, unsigned int>& c : m_connections)
+    {
+        if(fixed[c.first] || fixed[c.second]) continue;
+        //A particle connected to a sleeping island wakes it up
+        if(sleeping[c.first] != sleeping[c.second])
+            wakeIsland(sleeping[c.first] ? c.first : c.second);
+        m_islands.merge(c.first, c.second);
+    }
+
+    m_islandExcluded.resize(n);
+    for(size_t i = 0; i < n; ++i)
+        m_islandExcluded[i] = fixed[i] || sleeping[i];
+    m_islands.build(m_islandExcluded);
+
+    //Sleeping islands touched by each awake island, listed by the root of
+    //the awake island in m_islands
+    const unsigned int slotNumber = m_sleepingIslands.size();
+    m_rootSlots.assign(n, NO_ISLAND_SLOT);
+    m_nextSlots.assign(slotNumber, NO_ISLAND_SLOT);
+    for(unsigned int slot = 0; slot < slotNumber; ++slot)
+    {
+        if(m_sleepingIslands[slot].empty()) continue;
+        const unsigned int root = m_islands.find(m_sleepingIslands[slot].front());
+        m_nextSlots[slot] = m_rootSlots[root];
+        m_rootSlots[root] = slot;
+    }
+
+    //Put to sleep the islands whose particles all have been at rest long enough
+    const std::vector<unsigned int>& islandStart = m_islands.getIslandStart();
+    const std::vector<unsigned int>& islandParticles = m_islands.getIslandParticles();
+    for(size_t k = 0; k < m_islands.getIslandNumber(); ++k)
+    {
+        bool atRest = true;
+        for(unsigned int e = islandStart[k]; e < islandStart[k+1] && atRest; ++e)
+            atRest = m_sleepTimers[islandParticles[e]] >= m_sleepDelay;
+        if(!atRest) continue;
+
+        //An island resting on sleeping islands joins them, so that they all
+        //wake up together: otherwise it would float once its support is woken
+        unsigned int slot = m_rootSlots[m_islands.find(islandParticles[islandStart[k]])];
+        if(slot != NO_ISLAND_SLOT)
+        {
+            for(unsigned int other = m_nextSlots[slot]; other != NO_ISLAND_SLOT; other = m_nextSlots[other])
+            {
+                for(unsigned int p : m_sleepingIslands[other])
+                {
+                    m_sleepingIslands[slot].push_back(p);
+                    m_sleepingIslandOf[p] = slot;
+                }
+                m_sleepingIslands[other].clear();
+                m_freeIslandSlots.push_back(other);
+            }
+            m_nextSlots[slot] = NO_ISLAND_SLOT;
+        }
+        else if(m_freeIslandSlots.empty())
+        {
+            slot = m_sleepingIslands.size();
+            m_sleepingIslands.push_back(std::vector<unsigned int>());
+        }
+        else
+        {
+            slot = m_freeIslandSlots.back();
+            m_freeIslandSlots.pop_back();
+        }
+        for(unsigned int e = islandStart[k]; e < islandStart[k+1]; ++e)
+        {
+            const unsigned int p = islandParticles[e];
+            m_sleepingIslands[slot].push_back(p);
+            sleeping[p] = 1;
+            velocities[p] = glm::vec3(0.0, 0.0, 0.0);
+            m_sleepingIslandOf[p] = slot;
+        }
     }
 }
 
+const ContactBuffer& DynamicSystem::getContacts() const
+{
+    return m_contacts;
+}
+
 const float DynamicSystem::getRestitution()
 {
     return m_restitution;
@@ -167,6 +1277,16 @@ void DynamicSystem::setRestitution(const float& restitution)
     m_restitution = std::max(0.0f,std::min(restitution,1.0f));
 }
 
+float DynamicSystem::getRestitutionThreshold() const
+{
+    return m_restitutionThreshold;
+}
+
+void DynamicSystem::setRestitutionThreshold(float threshold)
+{
+    m_restitutionThreshold = std::max(0.0f, threshold);
+}
+
 std::ostream& operator<<(std::ostream& os, const DynamicSystemPtr& system)
 {
     std::vector<ParticlePtr> particles = system->getParticles();
@@ -175,3 +1295,310 @@ std::ostream& operator<<(std::ostream& os, const DynamicSystemPtr& system)
         os << p << std::endl;
     return os;
 }
+
+//Checkpoint file layout: a header followed by the arrays listed in
+//CheckpointSection, each one starting on a 64 bytes boundary.
+static const char CHECKPOINT_MAGIC[8] = {'D', 'Y', 'N', 'S', 'Y', 'S', 'C', 'K'};
+static const uint32_t CHECKPOINT_VERSION = 4;
+static const uint64_t CHECKPOINT_ALIGNMENT = 64;
+
+enum CheckpointSection
+{
+    POSITIONS_SECTION,
+    VELOCITIES_SECTION,
+    INVERSE_MASSES_SECTION,
+    RADII_SECTION,
+    FIXED_SECTION,
+    ACTIVE_SECTION,
+    INITIAL_POSITIONS_SECTION,
+    INITIAL_VELOCITIES_SECTION,
+    PLANES_SECTION,
+    PARAMETER_COUNTS_SECTION,
+    PARAMETERS_SECTION,
+    CONTACTS_SECTION,
+    SLOTS_SECTION,
+    SECTION_NUMBER
+};
+
+struct CheckpointHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t contactSize;
+    uint64_t particleNumber;
+    uint64_t planeNumber;
+    uint64_t forceFieldNumber;
+    uint64_t parameterNumber;
+    uint64_t contactNumber;
+    float dt;
+    float restitution;
+    float restitutionThreshold;
+    uint32_t padding;
+    uint64_t offsets[SECTION_NUMBER];
+    uint64_t sizes[SECTION_NUMBER];
+};
+
+static uint64_t alignCheckpointOffset(uint64_t offset)
+{
+    return (offset + CHECKPOINT_ALIGNMENT - 1) / CHECKPOINT_ALIGNMENT * CHECKPOINT_ALIGNMENT;
+}
+
+bool DynamicSystem::saveCheckpoint(const std::string& filename) const
+{
+    std::vector<glm::vec4> planes(m_planeObstacles.size());
+    for(size_t o = 0; o < m_planeObstacles.size(); ++o)
+        planes[o] = glm::vec4(m_planeObstacles[o]->normal(), m_planeObstacles[o]->distanceToOrigin());
+
+    std::vector<uint32_t> parameterCounts(m_forceFields.size());
+    std::vector<float> parameters;
+    for(size_t f = 0; f < m_forceFields.size(); ++f)
+    {
+        const size_t previousSize = parameters.size();
+        m_forceFields[f]->getParameters(parameters);
+        parameterCounts[f] = parameters.size() - previousSize;
+    }
+    const std::vector<Contact>& contacts = m_contacts.getContacts();
+    //Index of each particle in the store, which differs from its rank in
+    //m_particles once the store has been reordered
+    std::vector<uint32_t> slots(m_particles.size());
+    for(size_t k = 0; k < m_particles.size(); ++k)
+        slots[k] = m_particles[k]->getIndex();
+
+    const void* sections[SECTION_NUMBER];
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.contactSize = sizeof(Contact);
+    header.particleNumber = m_store->size();
+    header.planeNumber = planes.size();
+    header.forceFieldNumber = parameterCounts.size();
+    header.parameterNumber = parameters.size();
+    header.contactNumber = contacts.size();
+    header.dt = m_dt;
+    header.restitution = m_restitution;
+    header.restitutionThreshold = m_restitutionThreshold;
+
+    const size_t n = m_store->size();
+    sections[POSITIONS_SECTION] = m_store->getPositions().data();
+    header.sizes[POSITIONS_SECTION] = n*sizeof(glm::vec3);
+    sections[VELOCITIES_SECTION] = m_store->getVelocities().data();
+    header.sizes[VELOCITIES_SECTION] = n*sizeof(glm::vec3);
+    sections[INVERSE_MASSES_SECTION] = m_store->getInverseMasses().data();
+    header.sizes[INVERSE_MASSES_SECTION] = n*sizeof(float);
+    sections[RADII_SECTION] = m_store->getRadii().data();
+    header.sizes[RADII_SECTION] = n*sizeof(float);
+    sections[FIXED_SECTION] = m_store->getFixed().data();
+    header.sizes[FIXED_SECTION] = n*sizeof(unsigned char);
+    sections[ACTIVE_SECTION] = m_store->getActive().data();
+    header.sizes[ACTIVE_SECTION] = n*sizeof(unsigned char);
+    sections[INITIAL_POSITIONS_SECTION] = m_store->getInitialPositions().data();
+    header.sizes[INITIAL_POSITIONS_SECTION] = n*sizeof(glm::vec3);
+    sections[INITIAL_VELOCITIES_SECTION] = m_store->getInitialVelocities().data();
+    header.sizes[INITIAL_VELOCITIES_SECTION] = n*sizeof(glm::vec3);
+    sections[PLANES_SECTION] = planes.data();
+    header.sizes[PLANES_SECTION] = planes.size()*sizeof(glm::vec4);
+    sections[PARAMETER_COUNTS_SECTION] = parameterCounts.data();
+    header.sizes[PARAMETER_COUNTS_SECTION] = parameterCounts.size()*sizeof(uint32_t);
+    sections[PARAMETERS_SECTION] = parameters.data();
+    header.sizes[PARAMETERS_SECTION] = parameters.size()*sizeof(float);
+    sections[CONTACTS_SECTION] = contacts.data();
+    header.sizes[CONTACTS_SECTION] = contacts.size()*sizeof(Contact);
+    sections[SLOTS_SECTION] = slots.data();
+    header.sizes[SLOTS_SECTION] = slots.size()*sizeof(uint32_t);
+
+    uint64_t offset = alignCheckpointOffset(sizeof(CheckpointHeader));
+    for(int section = 0; section < SECTION_NUMBER; ++section)
+    {
+        header.offsets[section] = offset;
+        offset = alignCheckpointOffset(offset + header.sizes[section]);
+    }
+
+    std::ofstream file(filename.c_str(), std::ios::binary | std::ios::trunc);
+    if(!file)
+    {
+        LOG(error, "cannot open checkpoint file " << filename << " for writing");
+        return false;
+    }
+    const char padding[CHECKPOINT_ALIGNMENT] = {0};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+    for(int section = 0; section < SECTION_NUMBER; ++section)
+    {
+        file.write(padding, header.offsets[section] - written);
+        file.write(static_cast<const char*>(sections[section]), header.sizes[section]);
+        written = header.offsets[section] + header.sizes[section];
+    }
+    if(!file)
+    {
+        LOG(error, "cannot write checkpoint file " << filename);
+        return false;
+    }
+    return true;
+}
+
+bool DynamicSystem::loadCheckpoint(const std::string& filename)
+{
+#ifdef __unix__
+    //Map the file: each array is then restored by a single copy from the page cache
+    int descriptor = open(filename.c_str(), O_RDONLY);
+    if(descriptor < 0)
+    {
+        LOG(error, "cannot open checkpoint file " << filename);
+        return false;
+    }
+    struct stat status;
+    if(fstat(descriptor, &status) != 0 || status.st_size == 0)
+    {
+        close(descriptor);
+        LOG(error, "cannot read checkpoint file " << filename);
+        return false;
+    }
+    const size_t size = status.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if(mapping == MAP_FAILED)
+    {
+        LOG(error, "cannot map checkpoint file " << filename);
+        return false;
+    }
+    const bool restored = restoreCheckpoint(static_cast<const char*>(mapping), size);
+    munmap(mapping, size);
+#else
+    std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+    if(!file)
+    {
+        LOG(error, "cannot open checkpoint file " << filename);
+        return false;
+    }
+    std::vector<char> data(file.tellg());
+    file.seekg(0);
+    file.read(data.data(), data.size());
+    const bool restored = file && restoreCheckpoint(data.data(), data.size());
+#endif
+    if(!restored)
+        LOG(error, "checkpoint file " << filename << " does not match the dynamic system");
+    return restored;
+}
+
+bool DynamicSystem::restoreCheckpoint(const char* data, size_t size)
+{
+    //Check everything before modifying the system
+    if(size < sizeof(CheckpointHeader))
+        return false;
+    CheckpointHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if(std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0
+            || header.version != CHECKPOINT_VERSION
+            || header.contactSize != sizeof(Contact)
+            || header.particleNumber != m_store->size()
+            || header.planeNumber != m_planeObstacles.size()
+            || header.forceFieldNumber != m_forceFields.size())
+        return false;
+    for(int section = 0; section < SECTION_NUMBER; ++section)
+    {
+        if(header.offsets[section] > size || header.sizes[section] > size - header.offsets[section])
+            return false;
+    }
+    const size_t n = m_store->size();
+    if(header.sizes[POSITIONS_SECTION] != n*sizeof(glm::vec3)
+            || header.sizes[VELOCITIES_SECTION] != n*sizeof(glm::vec3)
+            || header.sizes[INVERSE_MASSES_SECTION] != n*sizeof(float)
+            || header.sizes[RADII_SECTION] != n*sizeof(float)
+            || header.sizes[FIXED_SECTION] != n*sizeof(unsigned char)
+            || header.sizes[ACTIVE_SECTION] != n*sizeof(unsigned char)
+            || header.sizes[INITIAL_POSITIONS_SECTION] != n*sizeof(glm::vec3)
+            || header.sizes[INITIAL_VELOCITIES_SECTION] != n*sizeof(glm::vec3)
+            || header.sizes[PLANES_SECTION] != header.planeNumber*sizeof(glm::vec4)
+            || header.sizes[PARAMETER_COUNTS_SECTION] != header.forceFieldNumber*sizeof(uint32_t)
+            || header.sizes[PARAMETERS_SECTION] != header.parameterNumber*sizeof(float)
+            || header.sizes[CONTACTS_SECTION] != header.contactNumber*sizeof(Contact)
+            || header.sizes[SLOTS_SECTION] != n*sizeof(uint32_t)
+            || m_particles.size() != n)
+        return false;
+
+    //The saved store may have been reordered: the slots must be a permutation
+    std::vector<uint32_t> slots(n);
+    std::memcpy(slots.data(), data + header.offsets[SLOTS_SECTION], header.sizes[SLOTS_SECTION]);
+    std::vector<unsigned char> usedSlots(n, 0);
+    for(uint32_t slot : slots)
+    {
+        if(slot >= n || usedSlots[slot])
+            return false;
+        usedSlots[slot] = 1;
+    }
+
+    std::vector<uint32_t> parameterCounts(header.forceFieldNumber);
+    std::memcpy(parameterCounts.data(), data + header.offsets[PARAMETER_COUNTS_SECTION], header.sizes[PARAMETER_COUNTS_SECTION]);
+    std::vector<float> parameters;
+    uint64_t parameterNumber = 0;
+    for(size_t f = 0; f < m_forceFields.size(); ++f)
+    {
+        parameters.clear();
+        m_forceFields[f]->getParameters(parameters);
+        if(parameters.size() != parameterCounts[f])
+            return false;
+        parameterNumber += parameterCounts[f];
+    }
+    if(parameterNumber != header.parameterNumber)
+        return false;
+
+    std::vector<Contact> contacts(header.contactNumber);
+    std::memcpy(contacts.data(), data + header.offsets[CONTACTS_SECTION], header.sizes[CONTACTS_SECTION]);
+    for(const Contact& c : contacts)
+    {
+        const size_t objectNumber = c.isPlane ? m_planeObstacles.size() : c.isMesh ? m_meshObstacles.size() : n;
+        if(c.particle1 >= n || c.particle2 >= objectNumber || (c.isPlane && c.isMesh))
+            return false;
+    }
+
+    //Restore the state
+    std::memcpy(m_store->getPositions().data(), data + header.offsets[POSITIONS_SECTION], header.sizes[POSITIONS_SECTION]);
+    std::memcpy(m_store->getVelocities().data(), data + header.offsets[VELOCITIES_SECTION], header.sizes[VELOCITIES_SECTION]);
+    std::memcpy(m_store->getInverseMasses().data(), data + header.offsets[INVERSE_MASSES_SECTION], header.sizes[INVERSE_MASSES_SECTION]);
+    std::memcpy(m_store->getRadii().data(), data + header.offsets[RADII_SECTION], header.sizes[RADII_SECTION]);
+    std::memcpy(m_store->getFixed().data(), data + header.offsets[FIXED_SECTION], header.sizes[FIXED_SECTION]);
+    std::memcpy(m_store->getActive().data(), data + header.offsets[ACTIVE_SECTION], header.sizes[ACTIVE_SECTION]);
+    std::memcpy(m_store->getInitialPositions().data(), data + header.offsets[INITIAL_POSITIONS_SECTION], header.sizes[INITIAL_POSITIONS_SECTION]);
+    std::memcpy(m_store->getInitialVelocities().data(), data + header.offsets[INITIAL_VELOCITIES_SECTION], header.sizes[INITIAL_VELOCITIES_SECTION]);
+    m_store->clearForces();
+    bool reordered = false;
+    for(size_t k = 0; k < n; ++k)
+    {
+        m_particles[k]->setIndex(slots[k]);
+        reordered = reordered || slots[k] != k;
+    }
+    m_particleSlots.clear();
+    if(reordered)
+        m_particleSlots.assign(slots.begin(), slots.end());
+    //Indices cached on the store are no longer valid
+    m_store->touch();
+
+    const glm::vec4* planes = reinterpret_cast<const glm::vec4*>(data + header.offsets[PLANES_SECTION]);
+    for(size_t o = 0; o < m_planeObstacles.size(); ++o)
+    {
+        glm::vec4 plane;
+        std::memcpy(&plane, planes + o, sizeof(plane));
+        m_planeObstacles[o]->setNormal(glm::vec3(plane));
+        m_planeObstacles[o]->setDistanceToOrigin(plane.w);
+    }
+
+    const char* parameterData = data + header.offsets[PARAMETERS_SECTION];
+    for(size_t f = 0; f < m_forceFields.size(); ++f)
+    {
+        parameters.resize(parameterCounts[f]);
+        std::memcpy(parameters.data(), parameterData, parameterCounts[f]*sizeof(float));
+        m_forceFields[f]->setParameters(parameters.data(), parameters.size());
+        parameterData += parameterCounts[f]*sizeof(float);
+    }
+
+    m_dt = header.dt;
+    m_restitution = header.restitution;
+    m_restitutionThreshold = header.restitutionThreshold;
+
+    //Particles have moved: the sweep and prune lists are rebuilt at the next step
+    m_sweepAndPrune.clear();
+    m_contacts.restore(contacts.data(), contacts.size(), m_store->getRevision());
+    wakeUp();
+    return true;
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <map>
@@ -7,13 +8,18 @@
 
 #include "./../../include/gl_helper.hpp"
 #include "./../../include/dynamics/DynamicSystemRenderable.hpp"
+#include "./../../include/log.hpp"
 #include "./../../include/Viewer.hpp"
 
 DynamicSystemRenderable::~DynamicSystemRenderable()
-{}
+{
+    //Stop the simulation before the system can be destroyed
+    m_thread.reset();
+}
 
 DynamicSystemRenderable::DynamicSystemRenderable(DynamicSystemPtr system) :
-    HierarchicalRenderable(nullptr), m_lastUpdateTime( 0 )
+    HierarchicalRenderable(nullptr), m_lastUpdateTime( 0 ), m_accumulator( 0 ), m_maximumSubsteps( 5 ),
+    m_playbackTime( 0 )
 {
     m_system = system;
 }
@@ -23,22 +29,160 @@ void DynamicSystemRenderable::do_draw()
 
 void DynamicSystemRenderable::do_animate(float time )
 {
-    if( time - m_lastUpdateTime >= m_system->getDt() )
+    //The viewer time can go backward, e.g. when the animation loops
+    const float elapsed = std::max( time - m_lastUpdateTime, 0.0f );
+    m_lastUpdateTime = time;
+    if( m_player )
     {
+        //Frame times start at the beginning of the recording, if the player
+        //has not been closed since
+        m_playbackTime += elapsed;
+        if( m_player->getFrameNumber() > 0 )
+            m_player->seek( m_player->findFrame( m_player->getFrameTime( 0 ) + m_playbackTime ) );
+        return;
+    }
+    if( m_thread )
+    {
+        m_thread->advance( elapsed );
+        m_thread->acquireSnapshot();
+        return;
+    }
+    m_accumulator += elapsed;
+
+    //The time step can change at each step with an adaptive solver
+    unsigned int steps = 0;
+    while( steps < m_maximumSubsteps && m_accumulator >= m_system->getDt() )
+    {
+        const float dt = m_system->getDt();
+        m_previousPositions = m_system->getParticleStore()->getPositions();
+        const unsigned long revision = m_system->getParticleStore()->getRevision();
         //Dynamic system step
         m_system->computeSimulationStep();
-        m_lastUpdateTime = time;
+        //The particles may have been reordered: do not blend unrelated entries
+        if( m_system->getParticleStore()->getRevision() != revision )
+            m_previousPositions.clear();
+        m_accumulator -= dt;
+        ++steps;
     }
-
+    if( m_accumulator >= m_system->getDt() )
+    {
+        //Cannot keep up: drop the time we are late, so that the next frames
+        //do not have to take even more steps
+        m_accumulator = std::fmod( m_accumulator, m_system->getDt() );
+    }
+    m_accumulator = std::max( m_accumulator, 0.0f );
 }
 
 void DynamicSystemRenderable::setDynamicSystem(const DynamicSystemPtr &system)
 {
+    const bool asynchronous = isAsynchronous();
+    setAsynchronous( false );
     m_system = system;
+    m_accumulator = 0;
+    m_previousPositions.clear();
+    setAsynchronous( asynchronous );
+}
+
+bool DynamicSystemRenderable::isAsynchronous() const
+{
+    return m_thread != nullptr;
+}
+
+void DynamicSystemRenderable::setAsynchronous(bool onOff)
+{
+    if( onOff == isAsynchronous() )
+        return;
+    if( onOff )
+    {
+        m_thread = std::make_shared<SimulationThread>( m_system );
+        m_thread->setMaximumSubsteps( m_maximumSubsteps );
+        m_thread->start();
+    }
+    else
+    {
+        m_thread->stop();
+        m_thread.reset();
+    }
+    m_accumulator = 0;
+    m_previousPositions.clear();
+}
+
+const SimulationThreadPtr& DynamicSystemRenderable::getSimulationThread() const
+{
+    return m_thread;
+}
+
+void DynamicSystemRenderable::setTrajectoryPlayer(TrajectoryPlayerPtr player)
+{
+    if( player && !player->isOpen() )
+    {
+        LOG( error, "cannot replay a trajectory player without an opened recording" );
+        return;
+    }
+    m_player = player;
+    m_playbackTime = 0;
+    if( m_player )
+    {
+        //The renderables read the snapshot at the store index of the particles,
+        //which differs from their recorded order once the store is reordered
+        const std::vector<ParticlePtr>& particles = m_system->getParticles();
+        std::vector<unsigned int> slots( particles.size() );
+        for( size_t k = 0; k < particles.size(); ++k )
+            slots[k] = particles[k]->getIndex();
+        m_player->setSlots( slots );
+        m_player->seek( 0 );
+    }
+}
+
+const TrajectoryPlayerPtr& DynamicSystemRenderable::getTrajectoryPlayer() const
+{
+    return m_player;
+}
+
+unsigned int DynamicSystemRenderable::getMaximumSubsteps() const
+{
+    return m_maximumSubsteps;
+}
+
+void DynamicSystemRenderable::setMaximumSubsteps(unsigned int substeps)
+{
+    m_maximumSubsteps = substeps;
+    if( m_thread )
+        m_thread->setMaximumSubsteps( substeps );
+}
+
+float DynamicSystemRenderable::getInterpolationAlpha() const
+{
+    return std::min( m_accumulator / m_system->getDt(), 1.0f );
+}
+
+const std::vector<glm::vec3>& DynamicSystemRenderable::getPreviousPositions() const
+{
+    return m_previousPositions;
+}
+
+glm::vec3 DynamicSystemRenderable::getInterpolatedPosition(size_t index) const
+{
+    if( m_player && index < m_player->getParticleNumber() )
+        return m_player->getSnapshot().positions[index];
+    //The worker owns the particle store: use the state it published
+    if( m_thread )
+        return m_thread->getSnapshot().positions[index];
+    const std::vector<glm::vec3>& positions = m_system->getParticleStore()->getPositions();
+    const glm::vec3& current = positions[index];
+    //No previous state for particles added since the last step
+    if( m_previousPositions.size() != positions.size() )
+        return current;
+    return glm::mix( m_previousPositions[index], current, getInterpolationAlpha() );
 }
 
 void DynamicSystemRenderable::do_keyPressedEvent(sf::Event &e)
 {
+    //The system cannot be modified while the worker simulates it, and the
+    //children can modify it too
+    if( m_thread )
+        m_thread->stop();
+
     if(e.key.code == sf::Keyboard::A ) //Toggle collision detection
     {
         m_system->setCollisionsDetection( !m_system->getCollisionDetection() );
@@ -53,6 +197,7 @@ void DynamicSystemRenderable::do_keyPressedEvent(sf::Event &e)
             pos += glm::ballRand(1.0f);
             p->setPosition(pos);
         }
+        m_system->wakeUp();
     }
     else if( e.key.code == sf::Keyboard::F5 ) //Reset the simulation
     {
@@ -60,7 +205,10 @@ void DynamicSystemRenderable::do_keyPressedEvent(sf::Event &e)
         {
             p->restart();
         }
-        m_lastUpdateTime = 0;
+        m_system->wakeUp();
+        m_accumulator = 0;
+        m_previousPositions.clear();
+        m_playbackTime = 0;
     }
     else //Propagate events to the children
     {
@@ -69,13 +217,20 @@ void DynamicSystemRenderable::do_keyPressedEvent(sf::Event &e)
             c->keyPressedEvent(e);
         }
     }
+
+    if( m_thread )
+        m_thread->start();
 }
 
 void DynamicSystemRenderable::do_keyReleasedEvent(sf::Event& e)
 {
+    if( m_thread )
+        m_thread->stop();
     //Propagate events to the children
     for(HierarchicalRenderablePtr c : getChildren())
     {
         c->keyReleasedEvent(e);
     }
+    if( m_thread )
+        m_thread->start();
 }
@@ -0,0 +1,94 @@
+#include "./../../include/dynamics/EnsembleRunner.hpp"
+#include "./../../include/log.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+EnsembleRunner::EnsembleRunner() :
+    m_threadNumber(0)
+{}
+
+EnsembleRunner::~EnsembleRunner()
+{}
+
+bool EnsembleRunner::addSystem(DynamicSystemPtr system)
+{
+    if(!system || !system->getSolver())
+    {
+        LOG(error, "cannot add a system without solver to an ensemble");
+        return false;
+    }
+    if(!m_systems.empty())
+    {
+        const DynamicSystem& first = *m_systems.front();
+        if(system->getParticles().size() != first.getParticles().size()
+                || system->getForceFields().size() != first.getForceFields().size()
+                || system->getPlaneObstacles().size() != first.getPlaneObstacles().size()
+                || system->getMeshObstacles().size() != first.getMeshObstacles().size())
+        {
+            LOG(error, "the system does not have the topology of the ensemble: "
+                << system->getParticles().size() << " particles and "
+                << system->getForceFields().size() << " force fields instead of "
+                << first.getParticles().size() << " and " << first.getForceFields().size());
+            return false;
+        }
+    }
+    m_systems.push_back(system);
+    return true;
+}
+
+const std::vector<DynamicSystemPtr>& EnsembleRunner::getSystems() const
+{
+    return m_systems;
+}
+
+size_t EnsembleRunner::size() const
+{
+    return m_systems.size();
+}
+
+void EnsembleRunner::clear()
+{
+    m_systems.clear();
+}
+
+unsigned int EnsembleRunner::getThreadNumber() const
+{
+    return m_threadNumber;
+}
+
+void EnsembleRunner::setThreadNumber(unsigned int threadNumber)
+{
+    m_threadNumber = threadNumber;
+}
+
+void EnsembleRunner::step(unsigned int steps)
+{
+    const long systemNumber = m_systems.size();
+    int threadNumber = 1;
+#ifdef _OPENMP
+    threadNumber = m_threadNumber > 0 ? m_threadNumber : omp_get_max_threads();
+#endif
+
+    //Systems are independent: no synchronization until all of them are done.
+    //Their costs can differ, e.g. with the number of contacts, hence the
+    //dynamic distribution.
+    #pragma omp parallel num_threads(threadNumber) if(threadNumber > 1)
+    {
+#ifdef _OPENMP
+        //The parallel parts of a system, e.g. the parallel force
+        //accumulation, run on the thread of the system: this only changes
+        //the number of threads of the regions nested in this one.
+        if(omp_get_num_threads() > 1)
+            omp_set_num_threads(1);
+#endif
+        #pragma omp for schedule(dynamic, 1)
+        for(long s = 0; s < systemNumber; ++s)
+        {
+            DynamicSystem& system = *m_systems[s];
+            for(unsigned int k = 0; k < steps; ++k)
+                system.computeSimulationStep();
+        }
+    }
+}
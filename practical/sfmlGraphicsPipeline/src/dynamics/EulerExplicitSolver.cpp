@@ -10,18 +10,22 @@ EulerExplicitSolver::~EulerExplicitSolver()
 
 }
 
-void EulerExplicitSolver::do_solve(const float& dt, std::vector<ParticlePtr>& particles)
+void EulerExplicitSolver::do_solve(const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields)
 {
-    for(ParticlePtr p : particles)
+    std::vector<glm::vec3>& positions = particles.getPositions();
+    std::vector<glm::vec3>& velocities = particles.getVelocities();
+    const std::vector<glm::vec3>& forces = particles.getForces();
+    const std::vector<float>& invMasses = particles.getInverseMasses();
+    const std::vector<unsigned char>& fixed = particles.getFixed();
+    const std::vector<unsigned char>& sleeping = particles.getSleeping();
+
+    const size_t n = particles.size();
+    for(size_t i = 0; i < n; ++i)
     {
-        if(!p->isFixed())
+        if(!fixed[i] && !sleeping[i])
         {
-            //TODO: Implement explicit euler solver
-            //Functions to use:
-            //Particle::getPosition(), Particle::getVelocity(), Particle::getMass(), Particle::getForce()
-            //Particle::setPosition(), Particle::setVelocity()
-            p->setVelocity( p->getVelocity() + dt * ( 1.0f/p->getMass() ) * p->getForce() );
-            p->setPosition( p->getPosition() + dt * p->getVelocity() );
+            velocities[i] += dt * invMasses[i] * forces[i];
+            positions[i] += dt * velocities[i];
         }
     }
 }
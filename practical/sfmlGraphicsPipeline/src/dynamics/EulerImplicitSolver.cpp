@@ -0,0 +1,149 @@
+#include "./../../include/dynamics/EulerImplicitSolver.hpp"
+
+#include <limits>
+
+EulerImplicitSolver::EulerImplicitSolver() :
+    m_maximumIterations(100),
+    m_tolerance(1e-4),
+    m_lastIterations(0)
+{
+
+}
+
+EulerImplicitSolver::~EulerImplicitSolver()
+{
+
+}
+
+unsigned int EulerImplicitSolver::getMaximumIterations() const
+{
+    return m_maximumIterations;
+}
+
+void EulerImplicitSolver::setMaximumIterations(unsigned int iterations)
+{
+    m_maximumIterations = iterations;
+}
+
+float EulerImplicitSolver::getTolerance() const
+{
+    return m_tolerance;
+}
+
+void EulerImplicitSolver::setTolerance(float tolerance)
+{
+    m_tolerance = tolerance;
+}
+
+unsigned int EulerImplicitSolver::getLastIterations() const
+{
+    return m_lastIterations;
+}
+
+static double dot(const std::vector<glm::vec3>& a, const std::vector<glm::vec3>& b)
+{
+    double sum = 0;
+    for(size_t i = 0; i < a.size(); ++i)
+        sum += glm::dot(a[i], b[i]);
+    return sum;
+}
+
+void EulerImplicitSolver::multiply(float dt, const ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields,
+                                   const std::vector<glm::vec3>& y, std::vector<glm::vec3>& out) const
+{
+    const std::vector<float>& invMasses = particles.getInverseMasses();
+    const std::vector<unsigned char>& fixed = particles.getFixed();
+    const std::vector<unsigned char>& sleeping = particles.getSleeping();
+    const size_t n = particles.size();
+
+    out.resize(n);
+    for(size_t i = 0; i < n; ++i)
+        out[i] = (fixed[i] || sleeping[i]) ? glm::vec3(0.0) : y[i]/invMasses[i];
+    for(ForceFieldPtr f : forceFields)
+        f->addJacobianProduct(particles, -dt*dt, -dt, y, out);
+
+    //Fixed and sleeping particles do not move: filter their entries out
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(fixed[i] || sleeping[i])
+            out[i] = glm::vec3(0.0);
+    }
+}
+
+void EulerImplicitSolver::do_solve(const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields)
+{
+    std::vector<glm::vec3>& positions = particles.getPositions();
+    std::vector<glm::vec3>& velocities = particles.getVelocities();
+    const std::vector<glm::vec3>& forces = particles.getForces();
+    const std::vector<float>& invMasses = particles.getInverseMasses();
+    const std::vector<unsigned char>& fixed = particles.getFixed();
+    const std::vector<unsigned char>& sleeping = particles.getSleeping();
+    const size_t n = particles.size();
+
+    //Right hand side: dt * (F + dt * dF/dx * v)
+    m_rhs.assign(n, glm::vec3(0.0));
+    for(ForceFieldPtr f : forceFields)
+        f->addJacobianProduct(particles, dt, 0.0f, velocities, m_rhs);
+    for(size_t i = 0; i < n; ++i)
+        m_rhs[i] = (fixed[i] || sleeping[i]) ? glm::vec3(0.0) : dt*(forces[i] + m_rhs[i]);
+
+    //Jacobi preconditioner
+    m_inverseDiagonal.assign(n, glm::vec3(0.0));
+    for(ForceFieldPtr f : forceFields)
+        f->addJacobianDiagonal(particles, -dt*dt, -dt, m_inverseDiagonal);
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(fixed[i] || sleeping[i])
+        {
+            m_inverseDiagonal[i] = glm::vec3(0.0);
+            continue;
+        }
+        const float mass = 1.0f/invMasses[i];
+        for(int k = 0; k < 3; ++k)
+        {
+            const float d = mass + m_inverseDiagonal[i][k];
+            m_inverseDiagonal[i][k] = d > std::numeric_limits<float>::epsilon() ? 1.0f/d : invMasses[i];
+        }
+    }
+
+    //Preconditioned conjugate gradient, starting from dv = 0
+    m_deltaVelocities.assign(n, glm::vec3(0.0));
+    m_residual = m_rhs;
+    m_preconditioned.resize(n);
+    for(size_t i = 0; i < n; ++i)
+        m_preconditioned[i] = m_inverseDiagonal[i]*m_residual[i];
+    m_direction = m_preconditioned;
+
+    const double threshold = double(m_tolerance)*double(m_tolerance)*dot(m_rhs, m_rhs);
+    double rz = dot(m_residual, m_preconditioned);
+    m_lastIterations = 0;
+    while(m_lastIterations < m_maximumIterations && dot(m_residual, m_residual) > threshold)
+    {
+        multiply(dt, particles, forceFields, m_direction, m_product);
+        const double pq = dot(m_direction, m_product);
+        if(pq <= 0.0)
+            break;
+        const float alpha = rz/pq;
+        for(size_t i = 0; i < n; ++i)
+        {
+            m_deltaVelocities[i] += alpha*m_direction[i];
+            m_residual[i] -= alpha*m_product[i];
+            m_preconditioned[i] = m_inverseDiagonal[i]*m_residual[i];
+        }
+        const double newRz = dot(m_residual, m_preconditioned);
+        const float beta = newRz/rz;
+        rz = newRz;
+        for(size_t i = 0; i < n; ++i)
+            m_direction[i] = m_preconditioned[i] + beta*m_direction[i];
+        ++m_lastIterations;
+    }
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(!fixed[i] && !sleeping[i])
+        {
+            velocities[i] += m_deltaVelocities[i];
+            positions[i] += dt * velocities[i];
+        }
+    }
+}
@@ -8,3 +8,96 @@ void ForceField::addForce()
 {
   do_addForce();
 }
+
+bool ForceField::addForce(const ParticleStore& store, std::vector<glm::vec3>& forces)
+{
+  return do_addForce(store, forces);
+}
+
+bool ForceField::prepareRange(const ParticleStore& store)
+{
+  return do_prepareRange(store);
+}
+
+void ForceField::addForce(const ParticleStore& store, size_t begin, size_t end, std::vector<glm::vec3>& forces)
+{
+  do_addForce(store, begin, end, forces);
+}
+
+bool ForceField::addJacobianProduct(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                    const std::vector<glm::vec3>& y, std::vector<glm::vec3>& out)
+{
+  return do_addJacobianProduct(store, stiffnessFactor, dampingFactor, y, out);
+}
+
+bool ForceField::addJacobianDiagonal(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                     std::vector<glm::vec3>& diagonal)
+{
+  return do_addJacobianDiagonal(store, stiffnessFactor, dampingFactor, diagonal);
+}
+
+void ForceField::getConnections(const ParticleStore& store,
+                                std::vector<std::pair<unsigned int, unsigned int> >& connections)
+{
+  do_getConnections(store, connections);
+}
+
+bool ForceField::getDistanceConstraints(const ParticleStore& store, std::vector<DistanceConstraint>& constraints)
+{
+  return do_getDistanceConstraints(store, constraints);
+}
+
+void ForceField::getParameters(std::vector<float>& parameters) const
+{
+  do_getParameters(parameters);
+}
+
+bool ForceField::setParameters(const float* parameters, size_t count)
+{
+  return do_setParameters(parameters, count);
+}
+
+bool ForceField::do_addForce(const ParticleStore& store, std::vector<glm::vec3>& forces)
+{
+  return false;
+}
+
+bool ForceField::do_prepareRange(const ParticleStore& store)
+{
+  return false;
+}
+
+void ForceField::do_addForce(const ParticleStore& store, size_t begin, size_t end, std::vector<glm::vec3>& forces)
+{
+}
+
+bool ForceField::do_addJacobianProduct(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                       const std::vector<glm::vec3>& y, std::vector<glm::vec3>& out)
+{
+  return false;
+}
+
+bool ForceField::do_addJacobianDiagonal(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                        std::vector<glm::vec3>& diagonal)
+{
+  return false;
+}
+
+void ForceField::do_getConnections(const ParticleStore& store,
+                                   std::vector<std::pair<unsigned int, unsigned int> >& connections)
+{
+}
+
+bool ForceField::do_getDistanceConstraints(const ParticleStore& store, std::vector<DistanceConstraint>& constraints)
+{
+  return false;
+}
+
+void ForceField::do_getParameters(std::vector<float>& parameters) const
+{
+}
+
+bool ForceField::do_setParameters(const float* parameters, size_t count)
+{
+  return count == 0;
+}
@@ -0,0 +1,334 @@
+#include "./../../include/dynamics/MeshObstacle.hpp"
+#include "./../../include/Io.hpp"
+#include "./../../include/log.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <glm/gtx/norm.hpp>
+
+//Binned SAH construction: candidate splits are taken at the bounds of bins
+//of triangle centroids, along each axis
+static const unsigned int BIN_NUMBER = 16;
+static const unsigned int MAX_LEAF_SIZE = 4;
+//Bounds the size of the traversal stack of the queries
+static const unsigned int MAX_DEPTH = 48;
+
+static float surfaceArea(const glm::vec3& min, const glm::vec3& max)
+{
+    const glm::vec3 d = glm::max(max - min, glm::vec3(0.0, 0.0, 0.0));
+    return 2.0f*(d.x*d.y + d.y*d.z + d.z*d.x);
+}
+
+static glm::vec3 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    //Find the Voronoi region of the triangle the point projects in
+    const glm::vec3 ab = b - a;
+    const glm::vec3 ac = c - a;
+    const glm::vec3 ap = p - a;
+    const float d1 = glm::dot(ab, ap);
+    const float d2 = glm::dot(ac, ap);
+    if(d1 <= 0.0f && d2 <= 0.0f) return a;
+
+    const glm::vec3 bp = p - b;
+    const float d3 = glm::dot(ab, bp);
+    const float d4 = glm::dot(ac, bp);
+    if(d3 >= 0.0f && d4 <= d3) return b;
+
+    const float vc = d1*d4 - d3*d2;
+    if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        return a + d1/(d1 - d3)*ab;
+
+    const glm::vec3 cp = p - c;
+    const float d5 = glm::dot(ab, cp);
+    const float d6 = glm::dot(ac, cp);
+    if(d6 >= 0.0f && d5 <= d6) return c;
+
+    const float vb = d5*d2 - d1*d6;
+    if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        return a + d2/(d2 - d6)*ac;
+
+    const float va = d3*d6 - d5*d4;
+    if(va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+        return b + (d4 - d3)/((d4 - d3) + (d5 - d6))*(c - b);
+
+    const float denominator = 1.0f/(va + vb + vc);
+    return a + vb*denominator*ab + vc*denominator*ac;
+}
+
+MeshObstacle::MeshObstacle(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices) :
+    m_minimum(0.0, 0.0, 0.0),
+    m_maximum(0.0, 0.0, 0.0)
+{
+    //Degenerate triangles cannot be collided
+    m_vertices.reserve(indices.size());
+    for(size_t t = 0; t + 2 < indices.size(); t += 3)
+    {
+        const glm::vec3& a = positions[indices[t]];
+        const glm::vec3& b = positions[indices[t+1]];
+        const glm::vec3& c = positions[indices[t+2]];
+        const glm::vec3 n = glm::cross(b - a, c - a);
+        if(glm::length2(n) <= std::numeric_limits<float>::min())
+            continue;
+        m_vertices.push_back(a);
+        m_vertices.push_back(b);
+        m_vertices.push_back(c);
+        m_normals.push_back(glm::normalize(n));
+        m_centroids.push_back((a + b + c)/3.0f);
+    }
+
+    const unsigned int triangleNumber = m_normals.size();
+    std::vector<unsigned int> order(triangleNumber);
+    for(unsigned int t = 0; t < triangleNumber; ++t)
+        order[t] = t;
+    if(triangleNumber > 0)
+    {
+        m_nodes.reserve(2*triangleNumber);
+        build(order, 0, triangleNumber, 0);
+        m_minimum = m_nodes[0].min;
+        m_maximum = m_nodes[0].max;
+    }
+
+    //Store the triangles in the order of the leaves
+    std::vector<glm::vec3> vertices(m_vertices.size());
+    std::vector<glm::vec3> normals(triangleNumber);
+    for(unsigned int t = 0; t < triangleNumber; ++t)
+    {
+        for(int k = 0; k < 3; ++k)
+            vertices[3*t+k] = m_vertices[3*order[t]+k];
+        normals[t] = m_normals[order[t]];
+    }
+    m_vertices.swap(vertices);
+    m_normals.swap(normals);
+    std::vector<glm::vec3>().swap(m_centroids);
+}
+
+MeshObstacle::~MeshObstacle()
+{}
+
+MeshObstaclePtr MeshObstacle::fromObj(const std::string& filename)
+{
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texcoords;
+    if(!read_obj(filename, positions, indices, normals, texcoords))
+    {
+        LOG(error, "cannot build a mesh obstacle from " << filename);
+        return nullptr;
+    }
+    return std::make_shared<MeshObstacle>(positions, indices);
+}
+
+void MeshObstacle::build(std::vector<unsigned int>& order, unsigned int begin, unsigned int end, unsigned int depth)
+{
+    const unsigned int index = m_nodes.size();
+    m_nodes.push_back(Node());
+
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(-std::numeric_limits<float>::max());
+    glm::vec3 centroidMin = min;
+    glm::vec3 centroidMax = max;
+    for(unsigned int t = begin; t < end; ++t)
+    {
+        for(int k = 0; k < 3; ++k)
+        {
+            min = glm::min(min, m_vertices[3*order[t]+k]);
+            max = glm::max(max, m_vertices[3*order[t]+k]);
+        }
+        centroidMin = glm::min(centroidMin, m_centroids[order[t]]);
+        centroidMax = glm::max(centroidMax, m_centroids[order[t]]);
+    }
+    m_nodes[index].min = min;
+    m_nodes[index].max = max;
+
+    const unsigned int count = end - begin;
+    if(count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH)
+    {
+        m_nodes[index].first = begin;
+        m_nodes[index].count = count;
+        return;
+    }
+
+    //Find the split of lowest cost, the cost of a child being its number of
+    //triangles times its area, i.e. the probability to visit it
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1;
+    unsigned int bestBin = 0;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        const float extent = centroidMax[axis] - centroidMin[axis];
+        if(extent <= 0.0f) continue;
+        const float scale = BIN_NUMBER/extent;
+
+        unsigned int binCounts[BIN_NUMBER] = {0};
+        glm::vec3 binMin[BIN_NUMBER];
+        glm::vec3 binMax[BIN_NUMBER];
+        for(unsigned int b = 0; b < BIN_NUMBER; ++b)
+        {
+            binMin[b] = glm::vec3(std::numeric_limits<float>::max());
+            binMax[b] = glm::vec3(-std::numeric_limits<float>::max());
+        }
+        for(unsigned int t = begin; t < end; ++t)
+        {
+            const unsigned int tri = order[t];
+            const unsigned int b = std::min(BIN_NUMBER - 1, static_cast<unsigned int>((m_centroids[tri][axis] - centroidMin[axis])*scale));
+            ++binCounts[b];
+            for(int k = 0; k < 3; ++k)
+            {
+                binMin[b] = glm::min(binMin[b], m_vertices[3*tri+k]);
+                binMax[b] = glm::max(binMax[b], m_vertices[3*tri+k]);
+            }
+        }
+
+        //Sweep from the right to get the cost of the right side of each split
+        float rightCosts[BIN_NUMBER];
+        glm::vec3 rightMin(std::numeric_limits<float>::max());
+        glm::vec3 rightMax(-std::numeric_limits<float>::max());
+        unsigned int rightCount = 0;
+        for(unsigned int b = BIN_NUMBER - 1; b > 0; --b)
+        {
+            rightMin = glm::min(rightMin, binMin[b]);
+            rightMax = glm::max(rightMax, binMax[b]);
+            rightCount += binCounts[b];
+            rightCosts[b] = rightCount*surfaceArea(rightMin, rightMax);
+        }
+        glm::vec3 leftMin(std::numeric_limits<float>::max());
+        glm::vec3 leftMax(-std::numeric_limits<float>::max());
+        unsigned int leftCount = 0;
+        for(unsigned int b = 0; b + 1 < BIN_NUMBER; ++b)
+        {
+            leftMin = glm::min(leftMin, binMin[b]);
+            leftMax = glm::max(leftMax, binMax[b]);
+            leftCount += binCounts[b];
+            if(leftCount == 0 || leftCount == count) continue;
+            const float cost = leftCount*surfaceArea(leftMin, leftMax) + rightCosts[b+1];
+            if(cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    unsigned int middle = begin + count/2;
+    if(bestAxis >= 0)
+    {
+        const float extent = centroidMax[bestAxis] - centroidMin[bestAxis];
+        const float scale = BIN_NUMBER/extent;
+        const float axisMin = centroidMin[bestAxis];
+        const std::vector<glm::vec3>& centroids = m_centroids;
+        middle = std::partition(order.begin() + begin, order.begin() + end, [&](unsigned int tri)
+        {
+            return std::min(BIN_NUMBER - 1, static_cast<unsigned int>((centroids[tri][bestAxis] - axisMin)*scale)) <= bestBin;
+        }) - order.begin();
+    }
+    else
+    {
+        //All the centroids are at the same place: split in two halves
+        std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end);
+    }
+
+    build(order, begin, middle, depth + 1);
+    m_nodes[index].first = m_nodes.size();
+    m_nodes[index].count = 0;
+    build(order, middle, end, depth + 1);
+}
+
+float MeshObstacle::boxDistance2(const Node& node, const glm::vec3& point) const
+{
+    const glm::vec3 d = glm::max(glm::max(node.min - point, point - node.max), glm::vec3(0.0, 0.0, 0.0));
+    return glm::dot(d, d);
+}
+
+bool MeshObstacle::findContact(const glm::vec3& center, float radius, glm::vec3& normal, float& distance) const
+{
+    if(m_nodes.empty())
+        return false;
+
+    //Closest point search, pruning the nodes farther than the best point found
+    float best2 = radius*radius;
+    unsigned int bestTriangle = m_normals.size();
+    glm::vec3 bestPoint;
+    unsigned int stack[MAX_DEPTH + 2];
+    unsigned int top = 0;
+    stack[top++] = 0;
+    while(top > 0)
+    {
+        const unsigned int index = stack[--top];
+        const Node& node = m_nodes[index];
+        if(boxDistance2(node, center) > best2)
+            continue;
+        if(node.count > 0)
+        {
+            for(unsigned int t = node.first; t < node.first + node.count; ++t)
+            {
+                const glm::vec3 p = closestPointOnTriangle(center, m_vertices[3*t], m_vertices[3*t+1], m_vertices[3*t+2]);
+                const float d2 = glm::distance2(center, p);
+                if(d2 <= best2)
+                {
+                    best2 = d2;
+                    bestTriangle = t;
+                    bestPoint = p;
+                }
+            }
+            continue;
+        }
+        //Visit the closest child first, it is more likely to shrink the search
+        const unsigned int left = index + 1;
+        const unsigned int right = node.first;
+        if(boxDistance2(m_nodes[left], center) < boxDistance2(m_nodes[right], center))
+        {
+            stack[top++] = right;
+            stack[top++] = left;
+        }
+        else
+        {
+            stack[top++] = left;
+            stack[top++] = right;
+        }
+    }
+    if(bestTriangle == m_normals.size())
+        return false;
+
+    const glm::vec3 offset = center - bestPoint;
+    const float length = glm::length(offset);
+    const glm::vec3& faceNormal = m_normals[bestTriangle];
+    if(glm::dot(offset, faceNormal) < 0.0f)
+    {
+        //Behind the closest triangle: push back to the front side
+        normal = faceNormal;
+        distance = -length;
+    }
+    else if(length > std::numeric_limits<float>::epsilon())
+    {
+        normal = offset/length;
+        distance = length;
+    }
+    else
+    {
+        normal = faceNormal;
+        distance = 0.0f;
+    }
+    return true;
+}
+
+size_t MeshObstacle::getTriangleNumber() const
+{
+    return m_normals.size();
+}
+
+size_t MeshObstacle::getNodeNumber() const
+{
+    return m_nodes.size();
+}
+
+const glm::vec3& MeshObstacle::getMinimum() const
+{
+    return m_minimum;
+}
+
+const glm::vec3& MeshObstacle::getMaximum() const
+{
+    return m_maximum;
+}
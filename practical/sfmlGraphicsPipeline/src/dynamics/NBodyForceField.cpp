@@ -0,0 +1,381 @@
+#include "./../../include/dynamics/NBodyForceField.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/gtx/norm.hpp>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**@brief Number of bits of a Morton code per axis, i.e. depth of the octree. */
+static const int MORTON_BITS = 21;
+/**@brief Maximum number of particles of a leaf cell. */
+static const unsigned int LEAF_SIZE = 8;
+
+/**@brief Insert two zero bits between the 21 lower bits of an integer. */
+static uint64_t spreadBits(uint64_t v)
+{
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8) & 0x100f00f00f00f00fULL;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+}
+
+/**@brief Split the sorted codes of a cell among its eight children.
+ *
+ * @param codes The first code of the cell.
+ * @param count The number of codes of the cell.
+ * @param shift The position of the three bits of the children in the codes.
+ * @param bounds The first code of each child, relative to codes, followed by count.
+ * @return The number of non empty children.
+ */
+static unsigned int splitCell(const uint64_t* codes, unsigned int count, int shift, unsigned int bounds[9])
+{
+    unsigned int childNumber = 0;
+    bounds[0] = 0;
+    for(uint64_t digit = 1; digit < 8; ++digit)
+    {
+        bounds[digit] = std::partition_point(codes + bounds[digit-1], codes + count,
+            [=](uint64_t code) { return ((code >> shift) & 7) < digit; }) - codes;
+        childNumber += bounds[digit] > bounds[digit-1];
+    }
+    bounds[8] = count;
+    childNumber += bounds[8] > bounds[7];
+    return childNumber;
+}
+
+NBodyForceField::NBodyForceField(const std::vector<ParticlePtr>& particles, float gravitationalConstant,
+                                 float softening, float theta) :
+    m_particles(particles),
+    m_gravitationalConstant(gravitationalConstant),
+    m_softening(softening),
+    m_theta(theta)
+{
+}
+
+void NBodyForceField::do_addForce()
+{
+    //The octree is built over the arrays of a store: the particles of
+    //a dynamic system always share one.
+    ParticleStore* store = m_indices.update(m_particles);
+    if(store)
+        do_addForce(*store, store->getForces());
+}
+
+float NBodyForceField::sortParticles(const ParticleStore& store)
+{
+    const std::vector<glm::vec3>& positions = store.getPositions();
+    const std::vector<float>& inverseMasses = store.getInverseMasses();
+    const std::vector<unsigned char>& active = store.getActive();
+
+    //Bounding cube of the particles
+    m_keys.clear();
+    glm::vec3 minimum(std::numeric_limits<float>::max());
+    glm::vec3 maximum(-std::numeric_limits<float>::max());
+    for(size_t i : m_indices.getIndices())
+    {
+        if(!active[i] || inverseMasses[i] <= 0) continue;
+        m_keys.push_back(std::make_pair(uint64_t(0), static_cast<unsigned int>(i)));
+        minimum = glm::min(minimum, positions[i]);
+        maximum = glm::max(maximum, positions[i]);
+    }
+    const long n = m_keys.size();
+    if(n == 0)
+        return 0.0f;
+    const glm::vec3 extent = maximum - minimum;
+    float size = std::max(std::max(extent.x, extent.y), extent.z);
+    if(size <= 0.0f)
+        size = 1.0f;
+    const float scale = float(1 << MORTON_BITS)/size;
+    const float maxCoordinate = float((1 << MORTON_BITS) - 1);
+
+    #pragma omp parallel for schedule(static) if(n > 4096)
+    for(long k = 0; k < n; ++k)
+    {
+        const glm::vec3 q = glm::min(glm::vec3(maxCoordinate), (positions[m_keys[k].second] - minimum)*scale);
+        m_keys[k].first = spreadBits(uint64_t(q.x)) | (spreadBits(uint64_t(q.y)) << 1) | (spreadBits(uint64_t(q.z)) << 2);
+    }
+
+    //Each thread sorts a chunk, then the chunks are merged two by two
+    long chunkNumber = 1;
+#ifdef _OPENMP
+    if(n > 4096)
+        chunkNumber = omp_get_max_threads();
+#endif
+    #pragma omp parallel for schedule(static, 1) if(chunkNumber > 1)
+    for(long c = 0; c < chunkNumber; ++c)
+        std::sort(m_keys.begin() + n*c/chunkNumber, m_keys.begin() + n*(c+1)/chunkNumber);
+    for(long width = 1; width < chunkNumber; width *= 2)
+    {
+        #pragma omp parallel for schedule(static, 1) if(chunkNumber > 2*width)
+        for(long c = 0; c < chunkNumber - width; c += 2*width)
+        {
+            std::inplace_merge(m_keys.begin() + n*c/chunkNumber,
+                               m_keys.begin() + n*(c+width)/chunkNumber,
+                               m_keys.begin() + n*std::min(c+2*width, chunkNumber)/chunkNumber);
+        }
+    }
+
+    m_order.resize(n);
+    m_codes.resize(n);
+    m_sortedPositions.resize(n);
+    m_sortedMasses.resize(n);
+    #pragma omp parallel for schedule(static) if(n > 4096)
+    for(long k = 0; k < n; ++k)
+    {
+        const unsigned int i = m_keys[k].second;
+        m_order[k] = i;
+        m_codes[k] = m_keys[k].first;
+        m_sortedPositions[k] = positions[i];
+        m_sortedMasses[k] = 1.0f/inverseMasses[i];
+    }
+    return size;
+}
+
+void NBodyForceField::buildTree(float size)
+{
+    const unsigned int n = m_codes.size();
+    m_cells.clear();
+    m_levelStart.clear();
+    if(n == 0)
+        return;
+
+    //Split the cells one level at a time: the children of a level are
+    //counted, then created, each cell of the level in parallel
+    Cell root = {glm::vec3(0.0, 0.0, 0.0), 0.0f, size, 0, n, 0, 0};
+    m_cells.push_back(root);
+    m_levelStart.push_back(0);
+    m_levelStart.push_back(1);
+    for(int level = 0; level < MORTON_BITS; ++level)
+    {
+        const long begin = m_levelStart[level];
+        const long cellNumber = m_levelStart[level+1] - begin;
+        const int shift = 3*(MORTON_BITS - 1 - level);
+        m_childOffsets.resize(cellNumber+1);
+        m_childOffsets[0] = 0;
+        #pragma omp parallel for schedule(static) if(cellNumber > 256)
+        for(long c = 0; c < cellNumber; ++c)
+        {
+            const Cell& cell = m_cells[begin + c];
+            unsigned int bounds[9];
+            m_childOffsets[c+1] = cell.end - cell.begin > LEAF_SIZE
+                ? splitCell(&m_codes[cell.begin], cell.end - cell.begin, shift, bounds) : 0;
+        }
+        for(long c = 0; c < cellNumber; ++c)
+            m_childOffsets[c+1] += m_childOffsets[c];
+        const unsigned int childNumber = m_childOffsets[cellNumber];
+        if(childNumber == 0)
+            break;
+
+        const unsigned int firstChild = m_cells.size();
+        m_cells.resize(firstChild + childNumber);
+        #pragma omp parallel for schedule(static) if(cellNumber > 256)
+        for(long c = 0; c < cellNumber; ++c)
+        {
+            Cell& cell = m_cells[begin + c];
+            cell.firstChild = firstChild + m_childOffsets[c];
+            cell.childNumber = m_childOffsets[c+1] - m_childOffsets[c];
+            if(cell.childNumber == 0) continue;
+            unsigned int bounds[9];
+            splitCell(&m_codes[cell.begin], cell.end - cell.begin, shift, bounds);
+            unsigned int child = cell.firstChild;
+            for(int digit = 0; digit < 8; ++digit)
+            {
+                if(bounds[digit+1] == bounds[digit]) continue;
+                Cell& childCell = m_cells[child++];
+                childCell.size = 0.5f*cell.size;
+                childCell.begin = cell.begin + bounds[digit];
+                childCell.end = cell.begin + bounds[digit+1];
+                childCell.firstChild = 0;
+                childCell.childNumber = 0;
+            }
+        }
+        m_levelStart.push_back(m_cells.size());
+    }
+
+    //Mass and center of mass of the cells, from the leaves to the root
+    for(long level = m_levelStart.size() - 2; level >= 0; --level)
+    {
+        const long begin = m_levelStart[level];
+        const long end = m_levelStart[level+1];
+        #pragma omp parallel for schedule(static) if(end - begin > 256)
+        for(long c = begin; c < end; ++c)
+        {
+            Cell& cell = m_cells[c];
+            glm::vec3 moment(0.0, 0.0, 0.0);
+            float mass = 0.0f;
+            if(cell.childNumber == 0)
+            {
+                for(unsigned int k = cell.begin; k < cell.end; ++k)
+                {
+                    moment += m_sortedMasses[k]*m_sortedPositions[k];
+                    mass += m_sortedMasses[k];
+                }
+            }
+            else
+            {
+                for(unsigned int child = cell.firstChild; child < cell.firstChild + cell.childNumber; ++child)
+                {
+                    moment += m_cells[child].mass*m_cells[child].centerOfMass;
+                    mass += m_cells[child].mass;
+                }
+            }
+            cell.mass = mass;
+            cell.centerOfMass = moment/mass;
+        }
+    }
+}
+
+bool NBodyForceField::do_addForce(const ParticleStore& store, std::vector<glm::vec3>& forces)
+{
+    if(m_indices.update(m_particles) != &store)
+        return false;
+
+    buildTree(sortParticles(store));
+
+    const std::vector<unsigned char>& sleeping = store.getSleeping();
+    const long cellNumber = m_cells.size();
+    const float softening2 = m_softening*m_softening;
+
+    //The particles of a leaf visit the octree together: the cells far enough
+    //from the sphere bounding the leaf, and the particles of the other leaves
+    //too close to it, are listed once, then summed for each particle.
+    #pragma omp parallel if(cellNumber > 256)
+    {
+        std::vector<glm::vec4> interactions;
+        #pragma omp for schedule(dynamic, 16)
+        for(long l = 0; l < cellNumber; ++l)
+        {
+            const Cell& leaf = m_cells[l];
+            if(leaf.childNumber != 0) continue;
+
+            glm::vec3 minimum = m_sortedPositions[leaf.begin];
+            glm::vec3 maximum = minimum;
+            for(unsigned int k = leaf.begin + 1; k < leaf.end; ++k)
+            {
+                minimum = glm::min(minimum, m_sortedPositions[k]);
+                maximum = glm::max(maximum, m_sortedPositions[k]);
+            }
+            const glm::vec3 center = 0.5f*(minimum + maximum);
+            const float radius = 0.5f*glm::length(maximum - minimum);
+
+            interactions.clear();
+            //Each visited cell pushes at most 8 children, at each level
+            unsigned int stack[8*(MORTON_BITS+1)];
+            int top = 0;
+            stack[top++] = 0;
+            while(top > 0)
+            {
+                const Cell& cell = m_cells[stack[--top]];
+                //The leaf and its ancestors are always opened
+                if(cell.end <= leaf.begin || cell.begin >= leaf.end)
+                {
+                    const float distance = glm::length(cell.centerOfMass - center) - radius;
+                    if(distance > 0 && cell.size < m_theta*distance)
+                    {
+                        interactions.push_back(glm::vec4(cell.centerOfMass, cell.mass));
+                        continue;
+                    }
+                    if(cell.childNumber == 0)
+                    {
+                        for(unsigned int j = cell.begin; j < cell.end; ++j)
+                            interactions.push_back(glm::vec4(m_sortedPositions[j], m_sortedMasses[j]));
+                        continue;
+                    }
+                }
+                for(unsigned int child = cell.firstChild; child < cell.firstChild + cell.childNumber; ++child)
+                    stack[top++] = child;
+            }
+
+            for(unsigned int k = leaf.begin; k < leaf.end; ++k)
+            {
+                const unsigned int i = m_order[k];
+                if(sleeping[i]) continue;
+                const glm::vec3 x = m_sortedPositions[k];
+                glm::vec3 acceleration(0.0, 0.0, 0.0);
+                for(const glm::vec4& source : interactions)
+                {
+                    const glm::vec3 d = glm::vec3(source) - x;
+                    const float inverseDistance = 1.0f/std::sqrt(glm::length2(d) + softening2);
+                    acceleration += (source.w*inverseDistance*inverseDistance*inverseDistance)*d;
+                }
+                for(unsigned int j = leaf.begin; j < leaf.end; ++j)
+                {
+                    if(j == k) continue;
+                    const glm::vec3 d = m_sortedPositions[j] - x;
+                    const float inverseDistance = 1.0f/std::sqrt(glm::length2(d) + softening2);
+                    acceleration += (m_sortedMasses[j]*inverseDistance*inverseDistance*inverseDistance)*d;
+                }
+                forces[i] += (m_gravitationalConstant*m_sortedMasses[k])*acceleration;
+            }
+        }
+    }
+    return true;
+}
+
+void NBodyForceField::do_getParameters(std::vector<float>& parameters) const
+{
+    parameters.push_back(m_gravitationalConstant);
+    parameters.push_back(m_softening);
+    parameters.push_back(m_theta);
+}
+
+bool NBodyForceField::do_setParameters(const float* parameters, size_t count)
+{
+    if(count != 3)
+        return false;
+    m_gravitationalConstant = parameters[0];
+    m_softening = parameters[1];
+    m_theta = parameters[2];
+    return true;
+}
+
+const std::vector<ParticlePtr>& NBodyForceField::getParticles() const
+{
+    return m_particles;
+}
+
+void NBodyForceField::setParticles(const std::vector<ParticlePtr>& particles)
+{
+    m_particles = particles;
+    m_indices.invalidate();
+}
+
+float NBodyForceField::getGravitationalConstant() const
+{
+    return m_gravitationalConstant;
+}
+
+void NBodyForceField::setGravitationalConstant(float gravitationalConstant)
+{
+    m_gravitationalConstant = gravitationalConstant;
+}
+
+float NBodyForceField::getSoftening() const
+{
+    return m_softening;
+}
+
+void NBodyForceField::setSoftening(float softening)
+{
+    m_softening = softening;
+}
+
+float NBodyForceField::getTheta() const
+{
+    return m_theta;
+}
+
+void NBodyForceField::setTheta(float theta)
+{
+    m_theta = theta;
+}
+
+size_t NBodyForceField::getCellNumber() const
+{
+    return m_cells.size();
+}
@@ -2,28 +2,35 @@
 
 void Particle::setRadius(const float &radius)
 {
-    m_radius = radius;
+    m_store->getRadii()[m_index] = radius;
 }
 
 
 bool Particle::isFixed() const
 {
-    return m_isFixed;
+    return m_store->getFixed()[m_index] != 0;
 }
 
 void Particle::setFixed(bool isFixed)
 {
-    m_isFixed = isFixed;
+    m_store->getFixed()[m_index] = isFixed ? 1 : 0;
+}
+
+bool Particle::isActive() const
+{
+    return m_store->getActive()[m_index] != 0;
+}
+
+void Particle::setActive(bool isActive)
+{
+    m_store->getActive()[m_index] = isActive ? 1 : 0;
 }
 
 Particle::Particle(const glm::vec3 &position, const glm::vec3 &velocity, const float &mass, const float &radius)
-    : m_initialPosition( position ), m_initialVelocity( velocity ),
-        m_position(position),
-      m_velocity(velocity),
-      m_force(glm::vec3(0.0,0.0,0.0)),
-      m_mass(mass),
-      m_radius(radius), m_isFixed( false )
-{}
+    : m_store( std::make_shared<ParticleStore>() )
+{
+    m_index = m_store->addParticle(position, velocity, mass, radius);
+}
 
 Particle::~Particle()
 {}
@@ -31,63 +38,91 @@ Particle::~Particle()
 
 const glm::vec3 & Particle::getPosition() const
 {
-    return m_position;
+    return m_store->getPositions()[m_index];
 }
 
 const glm::vec3 & Particle::getVelocity() const
 {
-    return m_velocity;
+    return m_store->getVelocities()[m_index];
 }
 
 const glm::vec3 & Particle::getForce() const
 {
-    return m_force;
+    return m_store->getForces()[m_index];
 }
 
 float Particle::getMass() const
 {
-    return m_mass;
+    return 1.0f/m_store->getInverseMasses()[m_index];
 }
 
 float Particle::getRadius() const
 {
-    return m_radius;
+    return m_store->getRadii()[m_index];
 }
 
 void Particle::setPosition(const glm::vec3 &pos)
 {
-    m_position = pos;
+    m_store->getPositions()[m_index] = pos;
 }
 
 void Particle::setVelocity(const glm::vec3 &vel)
 {	
-    m_velocity = vel;
+    m_store->getVelocities()[m_index] = vel;
 }
 
 void Particle::setForce(const glm::vec3 &force)
 {
-    m_force = force;
+    m_store->getForces()[m_index] = force;
 }
 
 void Particle::incrPosition(const glm::vec3 &pos)
 {
-    m_position += pos;
+    m_store->getPositions()[m_index] += pos;
 }
 
 void Particle::incrVelocity(const glm::vec3 &vel)
 {
-    m_velocity += vel;
+    m_store->getVelocities()[m_index] += vel;
 }
 
 void Particle::incrForce(const glm::vec3& force)
 {
-    m_force +=force;
+    m_store->getForces()[m_index] += force;
 }
 
 void Particle::restart()
 {
-  m_position = m_initialPosition;
-  m_velocity = m_initialVelocity;
+    m_store->restart(m_index);
+}
+
+const ParticleStorePtr& Particle::getStore() const
+{
+    return m_store;
+}
+
+size_t Particle::getIndex() const
+{
+    return m_index;
+}
+
+void Particle::setIndex(size_t index)
+{
+    m_index = index;
+}
+
+void Particle::moveTo(const ParticleStorePtr& store)
+{
+    if(store == m_store) return;
+    size_t index = store->copyParticle(*m_store, m_index);
+    m_store->touch();
+    m_store = store;
+    m_index = index;
+}
+
+void Particle::detach()
+{
+    moveTo(std::make_shared<ParticleStore>());
 }
 
 std::ostream& operator<<(std::ostream& os, const ParticlePtr& p)
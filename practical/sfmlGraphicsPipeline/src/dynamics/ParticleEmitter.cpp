@@ -0,0 +1,222 @@
+#include "./../../include/dynamics/ParticleEmitter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtx/norm.hpp>
+
+ParticleEmitter::ParticleEmitter(size_t capacity, float mass, float radius) :
+    m_position(0.0, 0.0, 0.0),
+    m_spawnRadius(0.0),
+    m_rate(10.0),
+    m_spawnAccumulator(0.0),
+    m_minimumLifetime(1.0),
+    m_maximumLifetime(1.0),
+    m_direction(0.0, 1.0, 0.0),
+    m_minimumSpeed(1.0),
+    m_maximumSpeed(1.0),
+    m_spread(0.0)
+{
+    m_particles.reserve(capacity);
+    for(size_t slot = 0; slot < capacity; ++slot)
+    {
+        ParticlePtr p = std::make_shared<Particle>(m_position, glm::vec3(0.0, 0.0, 0.0), mass, radius);
+        p->setFixed(true);
+        p->setActive(false);
+        m_particles.push_back(p);
+    }
+    m_ages.assign(capacity, 0.0f);
+    m_lifetimes.assign(capacity, 0.0f);
+    m_alive.assign(capacity, 0);
+
+    //Slots are handed out in increasing order
+    m_freeSlots.reserve(capacity);
+    for(size_t slot = capacity; slot > 0; --slot)
+        m_freeSlots.push_back(slot-1);
+}
+
+ParticleEmitter::~ParticleEmitter()
+{}
+
+const std::vector<ParticlePtr>& ParticleEmitter::getParticles() const
+{
+    return m_particles;
+}
+
+size_t ParticleEmitter::getCapacity() const
+{
+    return m_particles.size();
+}
+
+size_t ParticleEmitter::getAliveNumber() const
+{
+    return m_particles.size() - m_freeSlots.size();
+}
+
+const glm::vec3& ParticleEmitter::getPosition() const
+{
+    return m_position;
+}
+
+void ParticleEmitter::setPosition(const glm::vec3& position)
+{
+    m_position = position;
+}
+
+float ParticleEmitter::getSpawnRadius() const
+{
+    return m_spawnRadius;
+}
+
+void ParticleEmitter::setSpawnRadius(float radius)
+{
+    m_spawnRadius = radius;
+}
+
+float ParticleEmitter::getRate() const
+{
+    return m_rate;
+}
+
+void ParticleEmitter::setRate(float rate)
+{
+    m_rate = rate;
+}
+
+void ParticleEmitter::setLifetime(float minimum, float maximum)
+{
+    m_minimumLifetime = minimum;
+    m_maximumLifetime = std::max(minimum, maximum);
+}
+
+float ParticleEmitter::getMinimumLifetime() const
+{
+    return m_minimumLifetime;
+}
+
+float ParticleEmitter::getMaximumLifetime() const
+{
+    return m_maximumLifetime;
+}
+
+void ParticleEmitter::setVelocity(const glm::vec3& direction, float minimumSpeed, float maximumSpeed, float spread)
+{
+    m_direction = glm::length2(direction) > 0.0f ? glm::normalize(direction) : glm::vec3(0.0, 1.0, 0.0);
+    m_minimumSpeed = minimumSpeed;
+    m_maximumSpeed = std::max(minimumSpeed, maximumSpeed);
+    m_spread = spread;
+}
+
+void ParticleEmitter::setSeed(unsigned int seed)
+{
+    m_generator.seed(seed);
+}
+
+bool ParticleEmitter::spawn()
+{
+    if(m_freeSlots.empty())
+        return false;
+    const unsigned int slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> symmetric(-1.0f, 1.0f);
+
+    //Position drawn uniformly in the spawn sphere
+    glm::vec3 offset;
+    do
+    {
+        offset = glm::vec3(symmetric(m_generator), symmetric(m_generator), symmetric(m_generator));
+    } while(glm::length2(offset) > 1.0f);
+
+    //Direction drawn uniformly in the cone around the emission direction
+    const float cosTheta = 1.0f - unit(m_generator)*(1.0f - std::cos(m_spread));
+    const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta*cosTheta));
+    const float phi = 2.0f*float(M_PI)*unit(m_generator);
+    const glm::vec3 helper = std::abs(m_direction.x) < 0.9f ? glm::vec3(1.0, 0.0, 0.0) : glm::vec3(0.0, 1.0, 0.0);
+    const glm::vec3 tangent = glm::normalize(glm::cross(m_direction, helper));
+    const glm::vec3 bitangent = glm::cross(m_direction, tangent);
+    const glm::vec3 direction = cosTheta*m_direction
+                                + sinTheta*(std::cos(phi)*tangent + std::sin(phi)*bitangent);
+    const float speed = m_minimumSpeed + unit(m_generator)*(m_maximumSpeed - m_minimumSpeed);
+
+    m_ages[slot] = 0.0f;
+    m_lifetimes[slot] = m_minimumLifetime + unit(m_generator)*(m_maximumLifetime - m_minimumLifetime);
+    m_alive[slot] = 1;
+
+    ParticlePtr p = m_particles[slot];
+    p->setPosition(m_position + m_spawnRadius*offset);
+    p->setVelocity(speed*direction);
+    p->setForce(glm::vec3(0.0, 0.0, 0.0));
+    //The particle may have fallen asleep in its previous life
+    p->getStore()->getSleeping()[p->getIndex()] = 0;
+    p->setFixed(false);
+    p->setActive(true);
+    return true;
+}
+
+void ParticleEmitter::kill(size_t slot)
+{
+    ParticlePtr p = m_particles[slot];
+    p->setVelocity(glm::vec3(0.0, 0.0, 0.0));
+    p->setFixed(true);
+    p->setActive(false);
+    m_alive[slot] = 0;
+    m_freeSlots.push_back(slot);
+}
+
+void ParticleEmitter::killAll()
+{
+    for(size_t slot = 0; slot < m_particles.size(); ++slot)
+    {
+        if(m_alive[slot])
+            kill(slot);
+    }
+    m_spawnAccumulator = 0.0f;
+}
+
+void ParticleEmitter::checkSlots()
+{
+    //The active flags can be changed behind the emitter, e.g. by restoring a
+    //checkpoint: rebuild the free list from them if they do not match.
+    bool consistent = true;
+    for(size_t slot = 0; slot < m_particles.size() && consistent; ++slot)
+        consistent = (m_particles[slot]->isActive() == (m_alive[slot] != 0));
+    if(consistent)
+        return;
+
+    m_freeSlots.clear();
+    for(size_t slot = m_particles.size(); slot > 0; --slot)
+    {
+        const size_t s = slot-1;
+        const bool active = m_particles[s]->isActive();
+        if(active && !m_alive[s])
+        {
+            m_ages[s] = 0.0f;
+            m_lifetimes[s] = m_maximumLifetime;
+        }
+        m_alive[s] = active ? 1 : 0;
+        if(!active)
+            m_freeSlots.push_back(s);
+    }
+}
+
+void ParticleEmitter::update(float dt)
+{
+    checkSlots();
+
+    for(size_t slot = 0; slot < m_particles.size(); ++slot)
+    {
+        if(!m_alive[slot]) continue;
+        m_ages[slot] += dt;
+        if(m_ages[slot] >= m_lifetimes[slot])
+            kill(slot);
+    }
+
+    //Particles that do not fit in the pool are dropped, not delayed
+    m_spawnAccumulator += m_rate*dt;
+    while(m_spawnAccumulator >= 1.0f)
+    {
+        m_spawnAccumulator -= 1.0f;
+        spawn();
+    }
+}
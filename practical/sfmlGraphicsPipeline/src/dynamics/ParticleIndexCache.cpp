@@ -0,0 +1,69 @@
+#include "./../../include/dynamics/ParticleIndexCache.hpp"
+
+#include <algorithm>
+
+ParticleIndexCache::ParticleIndexCache() :
+    m_revision(0),
+    m_duplicates(false)
+{}
+
+ParticleIndexCache::~ParticleIndexCache()
+{}
+
+ParticleStore* ParticleIndexCache::update(const std::vector<ParticlePtr>& particles)
+{
+    if(m_store && m_store->getRevision() == m_revision)
+        return m_store.get();
+
+    m_store.reset();
+    m_indices.clear();
+    m_sortedIndices.clear();
+    if(particles.empty())
+        return nullptr;
+
+    const ParticleStorePtr& store = particles.front()->getStore();
+    m_indices.reserve(particles.size());
+    for(const ParticlePtr& p : particles)
+    {
+        if(p->getStore() != store)
+        {
+            m_indices.clear();
+            return nullptr;
+        }
+        m_indices.push_back(p->getIndex());
+    }
+    m_sortedIndices = m_indices;
+    std::sort(m_sortedIndices.begin(), m_sortedIndices.end());
+    m_duplicates = std::adjacent_find(m_sortedIndices.begin(), m_sortedIndices.end()) != m_sortedIndices.end();
+
+    m_store = store;
+    m_revision = store->getRevision();
+    return m_store.get();
+}
+
+const std::vector<size_t>& ParticleIndexCache::getIndices() const
+{
+    return m_indices;
+}
+
+std::pair<const size_t*, const size_t*> ParticleIndexCache::getRange(size_t begin, size_t end) const
+{
+    const size_t* first = m_sortedIndices.data();
+    const size_t* last = first + m_sortedIndices.size();
+    return std::make_pair(std::lower_bound(first, last, begin), std::lower_bound(first, last, end));
+}
+
+bool ParticleIndexCache::coversRange(size_t begin, size_t end) const
+{
+    if(m_duplicates)
+        return false;
+    const std::pair<const size_t*, const size_t*> range = getRange(begin, end);
+    return size_t(range.second - range.first) == end - begin;
+}
+
+void ParticleIndexCache::invalidate()
+{
+    m_store.reset();
+    m_indices.clear();
+    m_sortedIndices.clear();
+}
@@ -0,0 +1,93 @@
+#include "./../../include/dynamics/ParticleIslands.hpp"
+
+#include <utility>
+
+ParticleIslands::ParticleIslands()
+{}
+
+ParticleIslands::~ParticleIslands()
+{}
+
+void ParticleIslands::reset(size_t particleNumber)
+{
+    m_parents.resize(particleNumber);
+    for(size_t i = 0; i < particleNumber; ++i)
+        m_parents[i] = i;
+}
+
+unsigned int ParticleIslands::find(unsigned int a)
+{
+    //Path halving: every visited particle now points to its grand parent
+    while(m_parents[a] != a)
+    {
+        m_parents[a] = m_parents[m_parents[a]];
+        a = m_parents[a];
+    }
+    return a;
+}
+
+void ParticleIslands::merge(unsigned int a, unsigned int b)
+{
+    a = find(a);
+    b = find(b);
+    if(a == b) return;
+    if(a > b) std::swap(a, b);
+    m_parents[b] = a;
+}
+
+void ParticleIslands::build(const std::vector<unsigned char>& excluded)
+{
+    const size_t n = m_parents.size();
+
+    //Number the islands in the order of their representative particle
+    const unsigned int none = ~0u;
+    m_islands.assign(n, none);
+    m_islandStart.clear();
+    m_islandStart.push_back(0);
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(excluded[i]) continue;
+        const unsigned int root = find(i);
+        if(m_islands[root] == none)
+        {
+            m_islands[root] = m_islandStart.size() - 1;
+            m_islandStart.push_back(0);
+        }
+        ++m_islandStart[m_islands[root] + 1];
+    }
+
+    //Counting sort of the particles by island
+    const size_t islandNumber = m_islandStart.size() - 1;
+    for(size_t k = 0; k < islandNumber; ++k)
+        m_islandStart[k+1] += m_islandStart[k];
+    m_islandParticles.resize(m_islandStart.back());
+    std::vector<unsigned int> next(m_islandStart.begin(), m_islandStart.end() - 1);
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(excluded[i]) continue;
+        m_islandParticles[next[m_islands[find(i)]]++] = i;
+    }
+}
+
+size_t ParticleIslands::getIslandNumber() const
+{
+    return m_islandStart.empty() ? 0 : m_islandStart.size() - 1;
+}
+
+const std::vector<unsigned int>& ParticleIslands::getIslandParticles() const
+{
+    return m_islandParticles;
+}
+
+const std::vector<unsigned int>& ParticleIslands::getIslandStart() const
+{
+    return m_islandStart;
+}
+
+void ParticleIslands::getBufferSizes(std::vector<size_t>& sizes) const
+{
+    sizes.push_back(m_parents.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_islands.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_islandStart.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_islandParticles.capacity()*sizeof(unsigned int));
+}
@@ -67,12 +67,21 @@ void ParticleListRenderable::do_draw()
     }
 
     const size_t nparticles = m_particles.size();
+    const ParticleSnapshot* snapshot = m_thread ? &m_thread->getSnapshot()
+        : m_player ? &m_player->getSnapshot() : nullptr;
     glm::mat4 model = getModelMatrix();
     glm::mat4 transformation(1.0);
     for( size_t i = 0; i < nparticles; ++ i )
     {
-        glm::vec3 position = m_particles[i]->getPosition();
-        float scale = m_particles[i]->getRadius();
+        //Free slots, e.g. dead particles of an emitter, are not drawn
+        const size_t index = m_particles[i]->getIndex();
+        if( snapshot && index >= snapshot->positions.size() )
+            continue;
+        if( snapshot ? !snapshot->active[index] : !m_particles[i]->isActive() )
+            continue;
+        glm::vec3 position = snapshot ? snapshot->positions[index] : m_particles[i]->getPosition();
+        //Recordings do not hold the radii
+        float scale = snapshot && !snapshot->radii.empty() ? snapshot->radii[index] : m_particles[i]->getRadius();
         transformation[0][0] = scale;
         transformation[1][1] = scale;
         transformation[2][2] = scale;
@@ -89,6 +98,16 @@ void ParticleListRenderable::do_draw()
 void ParticleListRenderable::do_animate( float time )
 {}
 
+void ParticleListRenderable::setSimulationThread(SimulationThreadPtr thread)
+{
+    m_thread = thread;
+}
+
+void ParticleListRenderable::setTrajectoryPlayer(TrajectoryPlayerPtr player)
+{
+    m_player = player;
+}
+
 ParticleListRenderable::~ParticleListRenderable()
 {
     glcheck(glDeleteBuffers(1, &m_positionBuffer));
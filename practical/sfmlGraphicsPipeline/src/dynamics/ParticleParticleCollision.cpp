@@ -66,8 +66,13 @@ bool testParticleParticle(const ParticlePtr &p1, const ParticlePtr &p2)
 
     //Vector between sphere centers
     if(p1==p2) return false;
+    return testParticleParticle(p1->getPosition(), p1->getRadius(), p2->getPosition(), p2->getRadius());
+}
+
+bool testParticleParticle(const glm::vec3& x1, float r1, const glm::vec3& x2, float r2)
+{
     //Sum of sphere radii
-    float r = p1->getRadius() + p2->getRadius();
-    float c = glm::distance2(p1->getPosition(),p2->getPosition()) - r*r;
+    float r = r1 + r2;
+    float c = glm::distance2(x1,x2) - r*r;
     return (c<0.0f) ? true : false;
 }
@@ -65,6 +65,10 @@ bool testParticlePlane(const ParticlePtr &particle, const PlanePtr &plane)
     //Particle::getRadius(), Particle::getPosition()
 
     //return false;
-    return std::abs( dot( particle->getPosition(), plane->normal() ) - plane->distanceToOrigin() )
-            <= particle->getRadius();
+    return testParticlePlane(particle->getPosition(), particle->getRadius(), *plane);
+}
+
+bool testParticlePlane(const glm::vec3& position, float radius, const Plane& plane)
+{
+    return std::abs( dot( position, plane.normal() ) - plane.distanceToOrigin() ) <= radius;
 }
@@ -81,8 +81,9 @@ ParticleRenderable::ParticleRenderable(ShaderProgramPtr shaderProgram, ParticleP
 void ParticleRenderable::do_draw()
 {
     //Update the parent and local transform matrix to position the geometric data according to the particle's data.
-    const float& pRadius = m_particle->getRadius();
-    const glm::vec3& pPosition = m_particle->getPosition();
+    const size_t index = m_particle->getIndex();
+    const float pRadius = m_thread ? m_thread->getSnapshot().radii[index] : m_particle->getRadius();
+    const glm::vec3 pPosition = m_thread ? m_thread->getSnapshot().positions[index] : m_particle->getPosition();
     glm::mat4 scale = glm::scale(glm::mat4(1.0), glm::vec3(pRadius));
     glm::mat4 translate = glm::translate(glm::mat4(1.0), glm::vec3(pPosition));
     setLocalTransform(translate*scale);
@@ -138,6 +139,11 @@ void ParticleRenderable::do_draw()
 
 void ParticleRenderable::do_animate(float time) {}
 
+void ParticleRenderable::setSimulationThread(SimulationThreadPtr thread)
+{
+    m_thread = thread;
+}
+
 ParticleRenderable::~ParticleRenderable()
 {
     glcheck(glDeleteBuffers(1, &m_pBuffer));
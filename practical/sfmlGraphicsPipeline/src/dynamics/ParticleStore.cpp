@@ -0,0 +1,233 @@
+#include "./../../include/dynamics/ParticleStore.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+static unsigned long nextRevision()
+{
+    static std::atomic<unsigned long> counter(0);
+    return ++counter;
+}
+
+ParticleStore::ParticleStore() :
+    m_revision(nextRevision())
+{}
+
+ParticleStore::~ParticleStore()
+{}
+
+size_t ParticleStore::addParticle(const glm::vec3& position, const glm::vec3& velocity,
+                                  float mass, float radius)
+{
+    m_positions.push_back(position);
+    m_velocities.push_back(velocity);
+    m_forces.push_back(glm::vec3(0.0, 0.0, 0.0));
+    m_inverseMasses.push_back(1.0f/mass);
+    m_radii.push_back(radius);
+    m_fixed.push_back(0);
+    m_sleeping.push_back(0);
+    m_active.push_back(1);
+    m_initialPositions.push_back(position);
+    m_initialVelocities.push_back(velocity);
+    touch();
+    return m_positions.size()-1;
+}
+
+size_t ParticleStore::copyParticle(const ParticleStore& source, size_t index)
+{
+    m_positions.push_back(source.m_positions[index]);
+    m_velocities.push_back(source.m_velocities[index]);
+    m_forces.push_back(source.m_forces[index]);
+    m_inverseMasses.push_back(source.m_inverseMasses[index]);
+    m_radii.push_back(source.m_radii[index]);
+    m_fixed.push_back(source.m_fixed[index]);
+    m_sleeping.push_back(0);
+    m_active.push_back(source.m_active[index]);
+    m_initialPositions.push_back(source.m_initialPositions[index]);
+    m_initialVelocities.push_back(source.m_initialVelocities[index]);
+    touch();
+    return m_positions.size()-1;
+}
+
+size_t ParticleStore::size() const
+{
+    return m_positions.size();
+}
+
+void ParticleStore::clear()
+{
+    m_positions.clear();
+    m_velocities.clear();
+    m_forces.clear();
+    m_inverseMasses.clear();
+    m_radii.clear();
+    m_fixed.clear();
+    m_sleeping.clear();
+    m_active.clear();
+    m_initialPositions.clear();
+    m_initialVelocities.clear();
+    touch();
+}
+
+void ParticleStore::clearForces()
+{
+    std::fill(m_forces.begin(), m_forces.end(), glm::vec3(0.0, 0.0, 0.0));
+}
+
+void ParticleStore::restart(size_t index)
+{
+    m_positions[index] = m_initialPositions[index];
+    m_velocities[index] = m_initialVelocities[index];
+    m_sleeping[index] = 0;
+}
+
+template<typename T>
+static void permuteArray(std::vector<T>& array, const std::vector<unsigned int>& order, std::vector<T>& buffer)
+{
+    buffer.resize(array.size());
+    for(size_t k = 0; k < order.size(); ++k)
+        buffer[k] = array[order[k]];
+    array.swap(buffer);
+}
+
+void ParticleStore::permute(const std::vector<unsigned int>& order)
+{
+    std::vector<glm::vec3> vectors;
+    permuteArray(m_positions, order, vectors);
+    permuteArray(m_velocities, order, vectors);
+    permuteArray(m_forces, order, vectors);
+    permuteArray(m_initialPositions, order, vectors);
+    permuteArray(m_initialVelocities, order, vectors);
+    std::vector<float> scalars;
+    permuteArray(m_inverseMasses, order, scalars);
+    permuteArray(m_radii, order, scalars);
+    std::vector<unsigned char> flags;
+    permuteArray(m_fixed, order, flags);
+    permuteArray(m_sleeping, order, flags);
+    permuteArray(m_active, order, flags);
+    touch();
+}
+
+unsigned long ParticleStore::getRevision() const
+{
+    return m_revision;
+}
+
+void ParticleStore::touch()
+{
+    m_revision = nextRevision();
+}
+
+std::vector<glm::vec3>& ParticleStore::getPositions()
+{
+    return m_positions;
+}
+
+const std::vector<glm::vec3>& ParticleStore::getPositions() const
+{
+    return m_positions;
+}
+
+std::vector<glm::vec3>& ParticleStore::getVelocities()
+{
+    return m_velocities;
+}
+
+const std::vector<glm::vec3>& ParticleStore::getVelocities() const
+{
+    return m_velocities;
+}
+
+std::vector<glm::vec3>& ParticleStore::getForces()
+{
+    return m_forces;
+}
+
+const std::vector<glm::vec3>& ParticleStore::getForces() const
+{
+    return m_forces;
+}
+
+std::vector<float>& ParticleStore::getInverseMasses()
+{
+    return m_inverseMasses;
+}
+
+const std::vector<float>& ParticleStore::getInverseMasses() const
+{
+    return m_inverseMasses;
+}
+
+std::vector<float>& ParticleStore::getRadii()
+{
+    return m_radii;
+}
+
+const std::vector<float>& ParticleStore::getRadii() const
+{
+    return m_radii;
+}
+
+std::vector<unsigned char>& ParticleStore::getFixed()
+{
+    return m_fixed;
+}
+
+const std::vector<unsigned char>& ParticleStore::getFixed() const
+{
+    return m_fixed;
+}
+
+std::vector<unsigned char>& ParticleStore::getSleeping()
+{
+    return m_sleeping;
+}
+
+const std::vector<unsigned char>& ParticleStore::getSleeping() const
+{
+    return m_sleeping;
+}
+
+std::vector<unsigned char>& ParticleStore::getActive()
+{
+    return m_active;
+}
+
+const std::vector<unsigned char>& ParticleStore::getActive() const
+{
+    return m_active;
+}
+
+std::vector<glm::vec3>& ParticleStore::getInitialPositions()
+{
+    return m_initialPositions;
+}
+
+const std::vector<glm::vec3>& ParticleStore::getInitialPositions() const
+{
+    return m_initialPositions;
+}
+
+std::vector<glm::vec3>& ParticleStore::getInitialVelocities()
+{
+    return m_initialVelocities;
+}
+
+const std::vector<glm::vec3>& ParticleStore::getInitialVelocities() const
+{
+    return m_initialVelocities;
+}
+
+void ParticleStore::getBufferSizes(std::vector<size_t>& sizes) const
+{
+    sizes.push_back(m_positions.capacity()*sizeof(glm::vec3));
+    sizes.push_back(m_velocities.capacity()*sizeof(glm::vec3));
+    sizes.push_back(m_forces.capacity()*sizeof(glm::vec3));
+    sizes.push_back(m_inverseMasses.capacity()*sizeof(float));
+    sizes.push_back(m_radii.capacity()*sizeof(float));
+    sizes.push_back(m_fixed.capacity());
+    sizes.push_back(m_sleeping.capacity());
+    sizes.push_back(m_active.capacity());
+    sizes.push_back(m_initialPositions.capacity()*sizeof(glm::vec3));
+    sizes.push_back(m_initialVelocities.capacity()*sizeof(glm::vec3));
+}
@@ -0,0 +1,265 @@
+#include "./../../include/dynamics/SPHForceField.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/gtx/norm.hpp>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+SPHForceField::SPHForceField(const std::vector<ParticlePtr>& particles, float smoothingLength,
+                             float restDensity, float stiffness, float viscosity, float surfaceTension) :
+    m_particles(particles),
+    m_smoothingLength(smoothingLength),
+    m_restDensity(restDensity),
+    m_stiffness(stiffness),
+    m_viscosity(viscosity),
+    m_surfaceTension(surfaceTension)
+{
+}
+
+void SPHForceField::do_addForce()
+{
+    //The neighbor search runs over the arrays of a store: the particles of
+    //a dynamic system always share one.
+    ParticleStore* store = m_indices.update(m_particles);
+    if(store)
+        do_addForce(*store, store->getForces());
+}
+
+void SPHForceField::findNeighbors(const ParticleStore& store)
+{
+    const std::vector<glm::vec3>& positions = store.getPositions();
+    const std::vector<unsigned char>& active = store.getActive();
+    const std::vector<size_t>& indices = m_indices.getIndices();
+    const long count = indices.size();
+    const float h = m_smoothingLength;
+    const float h2 = h*h;
+
+    //Only the particles of the fluid are sorted into the grid
+    m_included.assign(store.size(), 0);
+    for(size_t i : indices)
+        m_included[i] = active[i];
+    m_grid.build(positions, h, m_included);
+
+    //Each thread lists the neighbors of a contiguous range of particles in
+    //its own array, then the arrays are concatenated in the order of the ranges
+    m_neighborStart.resize(count+1);
+    m_neighborStart[0] = 0;
+    #pragma omp parallel if(count > 4096)
+    {
+#ifdef _OPENMP
+        const int thread = omp_get_thread_num();
+        #pragma omp single
+        {
+            m_threadNeighbors.resize(omp_get_num_threads());
+            m_threadFirst.resize(omp_get_num_threads());
+        }
+#else
+        const int thread = 0;
+        m_threadNeighbors.resize(1);
+        m_threadFirst.resize(1);
+#endif
+        std::vector<unsigned int>& neighbors = m_threadNeighbors[thread];
+        neighbors.clear();
+        m_threadFirst[thread] = count;
+
+        #pragma omp for schedule(static)
+        for(long k = 0; k < count; ++k)
+        {
+            const size_t i = indices[k];
+            const size_t first = neighbors.size();
+            m_threadFirst[thread] = std::min(m_threadFirst[thread], k);
+            if(m_included[i])
+            {
+                const glm::vec3& x = positions[i];
+                m_grid.forEachNeighbor(x, h, [&](size_t j)
+                {
+                    if(j != i && glm::distance2(positions[j], x) < h2)
+                        neighbors.push_back(j);
+                });
+            }
+            m_neighborStart[k+1] = neighbors.size() - first;
+        }
+
+        #pragma omp single
+        {
+            for(long k = 0; k < count; ++k)
+                m_neighborStart[k+1] += m_neighborStart[k];
+            m_neighbors.resize(m_neighborStart[count]);
+        }
+
+        if(!neighbors.empty())
+            std::copy(neighbors.begin(), neighbors.end(), m_neighbors.begin() + m_neighborStart[m_threadFirst[thread]]);
+    }
+}
+
+bool SPHForceField::do_addForce(const ParticleStore& store, std::vector<glm::vec3>& forces)
+{
+    if(m_indices.update(m_particles) != &store)
+        return false;
+
+    findNeighbors(store);
+
+    const std::vector<glm::vec3>& positions = store.getPositions();
+    const std::vector<glm::vec3>& velocities = store.getVelocities();
+    const std::vector<float>& inverseMasses = store.getInverseMasses();
+    const std::vector<unsigned char>& sleeping = store.getSleeping();
+    const std::vector<size_t>& indices = m_indices.getIndices();
+    const long count = indices.size();
+
+    const float h = m_smoothingLength;
+    const float h2 = h*h;
+    const float pi = 3.14159265358979f;
+    const float poly6 = 315.0f/(64.0f*pi*std::pow(h, 9.0f));
+    const float spikyGradient = 45.0f/(pi*std::pow(h, 6.0f));
+    const float viscosityLaplacian = 45.0f/(pi*std::pow(h, 6.0f));
+
+    m_densities.resize(store.size());
+    m_pressures.resize(store.size());
+
+    //Density and pressure of each particle, including its own mass
+    #pragma omp parallel for schedule(static) if(count > 4096)
+    for(long k = 0; k < count; ++k)
+    {
+        const size_t i = indices[k];
+        if(!m_included[i]) continue;
+        const float mi = inverseMasses[i] > 0 ? 1.0f/inverseMasses[i] : 0.0f;
+        float density = mi*poly6*h2*h2*h2;
+        for(unsigned int e = m_neighborStart[k]; e < m_neighborStart[k+1]; ++e)
+        {
+            const unsigned int j = m_neighbors[e];
+            if(inverseMasses[j] <= 0) continue;
+            const float q = h2 - glm::distance2(positions[i], positions[j]);
+            density += poly6*q*q*q/inverseMasses[j];
+        }
+        if(density <= 0)
+            density = m_restDensity;
+        m_densities[i] = density;
+        m_pressures[i] = std::max(0.0f, m_stiffness*(density - m_restDensity));
+    }
+
+    //Pressure, viscosity and cohesion forces. The pressure uses the symmetric
+    //form, so that two neighbors push each other with opposite forces.
+    #pragma omp parallel for schedule(static) if(count > 4096)
+    for(long k = 0; k < count; ++k)
+    {
+        const size_t i = indices[k];
+        if(!m_included[i] || sleeping[i] || inverseMasses[i] <= 0) continue;
+        const glm::vec3& xi = positions[i];
+        const glm::vec3& vi = velocities[i];
+        const float rhoi = m_densities[i];
+        const float pressureTerm = m_pressures[i]/(rhoi*rhoi);
+        glm::vec3 pressureAcceleration(0.0, 0.0, 0.0);
+        glm::vec3 viscosityAcceleration(0.0, 0.0, 0.0);
+        glm::vec3 cohesionForce(0.0, 0.0, 0.0);
+        for(unsigned int e = m_neighborStart[k]; e < m_neighborStart[k+1]; ++e)
+        {
+            const unsigned int j = m_neighbors[e];
+            if(inverseMasses[j] <= 0) continue;
+            const float mj = 1.0f/inverseMasses[j];
+            const float rhoj = m_densities[j];
+            const glm::vec3 d = xi - positions[j];
+            const float r2 = glm::length2(d);
+            const float r = std::sqrt(r2);
+            const float q = h - r;
+            if(r > std::numeric_limits<float>::epsilon())
+                pressureAcceleration += (mj*(pressureTerm + m_pressures[j]/(rhoj*rhoj))*spikyGradient*q*q/r)*d;
+            viscosityAcceleration += (mj*viscosityLaplacian*q/rhoj)*(velocities[j] - vi);
+            const float w = h2 - r2;
+            cohesionForce -= (mj*poly6*w*w*w)*d;
+        }
+        const float mi = 1.0f/inverseMasses[i];
+        forces[i] += mi*(pressureAcceleration + (m_viscosity/rhoi)*viscosityAcceleration)
+                     + m_surfaceTension*cohesionForce;
+    }
+    return true;
+}
+
+void SPHForceField::do_getParameters(std::vector<float>& parameters) const
+{
+    parameters.push_back(m_smoothingLength);
+    parameters.push_back(m_restDensity);
+    parameters.push_back(m_stiffness);
+    parameters.push_back(m_viscosity);
+    parameters.push_back(m_surfaceTension);
+}
+
+bool SPHForceField::do_setParameters(const float* parameters, size_t count)
+{
+    if(count != 5)
+        return false;
+    m_smoothingLength = parameters[0];
+    m_restDensity = parameters[1];
+    m_stiffness = parameters[2];
+    m_viscosity = parameters[3];
+    m_surfaceTension = parameters[4];
+    return true;
+}
+
+const std::vector<ParticlePtr>& SPHForceField::getParticles() const
+{
+    return m_particles;
+}
+
+void SPHForceField::setParticles(const std::vector<ParticlePtr>& particles)
+{
+    m_particles = particles;
+    m_indices.invalidate();
+}
+
+float SPHForceField::getSmoothingLength() const
+{
+    return m_smoothingLength;
+}
+
+void SPHForceField::setSmoothingLength(float smoothingLength)
+{
+    m_smoothingLength = smoothingLength;
+}
+
+float SPHForceField::getRestDensity() const
+{
+    return m_restDensity;
+}
+
+void SPHForceField::setRestDensity(float restDensity)
+{
+    m_restDensity = restDensity;
+}
+
+float SPHForceField::getStiffness() const
+{
+    return m_stiffness;
+}
+
+void SPHForceField::setStiffness(float stiffness)
+{
+    m_stiffness = stiffness;
+}
+
+float SPHForceField::getViscosity() const
+{
+    return m_viscosity;
+}
+
+void SPHForceField::setViscosity(float viscosity)
+{
+    m_viscosity = viscosity;
+}
+
+float SPHForceField::getSurfaceTension() const
+{
+    return m_surfaceTension;
+}
+
+void SPHForceField::setSurfaceTension(float surfaceTension)
+{
+    m_surfaceTension = surfaceTension;
+}
+
+const std::vector<float>& SPHForceField::getDensities() const
+{
+    return m_densities;
+}
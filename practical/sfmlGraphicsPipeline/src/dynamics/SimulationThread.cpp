@@ -0,0 +1,184 @@
+#include "./../../include/dynamics/SimulationThread.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    //m_latest holds a snapshot index and a flag telling if it is new
+    const unsigned int INDEX = 3;
+    const unsigned int FRESH = 4;
+}
+
+SimulationThread::SimulationThread(DynamicSystemPtr system) :
+    m_system(system),
+    m_running(false),
+    m_budget(0),
+    m_maximumSubsteps(5),
+    m_reorderInterval(0),
+    m_latest(2),
+    m_back(0),
+    m_front(1),
+    m_step(0)
+{}
+
+SimulationThread::~SimulationThread()
+{
+    stop();
+}
+
+const DynamicSystemPtr& SimulationThread::getDynamicSystem() const
+{
+    return m_system;
+}
+
+void SimulationThread::start()
+{
+    if(isRunning())
+        return;
+
+    //The worker is not running: all the snapshots can be written
+    for(unsigned int i = 0; i < 3; ++i)
+        copyState(m_snapshots[i], m_step);
+    m_back = 0;
+    m_front = 1;
+    m_latest.store(2);
+
+    //The render thread reads the particle indices to draw the snapshots:
+    //they must not change while the worker runs
+    m_reorderInterval = m_system->getReorderInterval();
+    m_system->setReorderInterval(0);
+
+    m_budget = 0;
+    m_running = true;
+    m_thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_running)
+            return;
+        m_running = false;
+    }
+    m_condition.notify_one();
+    m_thread.join();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    applyCommands();
+    m_budget = 0;
+    m_system->setReorderInterval(m_reorderInterval);
+}
+
+bool SimulationThread::isRunning() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running;
+}
+
+void SimulationThread::post(const std::function<void()>& command)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_running)
+        {
+            command();
+            return;
+        }
+        m_commands.push_back(command);
+    }
+    m_condition.notify_one();
+}
+
+std::unique_lock<std::mutex> SimulationThread::lockParameters() const
+{
+    return std::unique_lock<std::mutex>(m_mutex);
+}
+
+void SimulationThread::advance(float time)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_budget += std::max(time, 0.0f);
+    }
+    m_condition.notify_one();
+}
+
+unsigned int SimulationThread::getMaximumSubsteps() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_maximumSubsteps;
+}
+
+void SimulationThread::setMaximumSubsteps(unsigned int substeps)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maximumSubsteps = substeps;
+}
+
+bool SimulationThread::acquireSnapshot()
+{
+    if(!(m_latest.load(std::memory_order_relaxed) & FRESH))
+        return false;
+    m_front = m_latest.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+    return true;
+}
+
+const ParticleSnapshot& SimulationThread::getSnapshot() const
+{
+    return m_snapshots[m_front];
+}
+
+void SimulationThread::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(m_running)
+    {
+        applyCommands();
+
+        //The time step can change at each step with an adaptive solver
+        const float dt = m_system->getDt();
+        if(m_budget < dt)
+        {
+            m_condition.wait(lock);
+            continue;
+        }
+        if(m_budget >= (m_maximumSubsteps + 1) * dt)
+        {
+            //Cannot keep up: drop the time we are late
+            m_budget = std::fmod(m_budget, dt) + m_maximumSubsteps * dt;
+        }
+        m_budget -= dt;
+
+        //The render thread only reads the published snapshots
+        lock.unlock();
+        m_system->computeSimulationStep();
+        publish(++m_step);
+        lock.lock();
+    }
+}
+
+void SimulationThread::applyCommands()
+{
+    //Called with m_mutex locked
+    for(const std::function<void()>& command : m_commands)
+        command();
+    m_commands.clear();
+}
+
+void SimulationThread::copyState(ParticleSnapshot& snapshot, unsigned long step) const
+{
+    //Copies reuse the memory of the snapshot, there is no allocation as long
+    //as the number of particles does not grow
+    const ParticleStore& store = *m_system->getParticleStore();
+    snapshot.positions = store.getPositions();
+    snapshot.radii = store.getRadii();
+    snapshot.active = store.getActive();
+    snapshot.step = step;
+}
+
+void SimulationThread::publish(unsigned long step)
+{
+    copyState(m_snapshots[m_back], step);
+    m_back = m_latest.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+}
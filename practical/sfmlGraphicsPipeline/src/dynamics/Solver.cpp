@@ -1,6 +1,40 @@
 # include "../../include/dynamics/Solver.hpp"
 
-void Solver::solve( const float& dt, std::vector<ParticlePtr>& particles )
+void Solver::solve( const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields )
 {
-  do_solve( dt, particles );
+  do_solve( dt, particles, forceFields );
+}
+
+bool Solver::handlesCollisions() const
+{
+  return do_handlesCollisions();
+}
+
+void Solver::solveWithCollisions( const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields,
+                                  const std::vector<PlanePtr>& planeObstacles,
+                                  const std::vector<MeshObstaclePtr>& meshObstacles )
+{
+  do_solveWithCollisions( dt, particles, forceFields, planeObstacles, meshObstacles );
+}
+
+float Solver::getSuggestedDt() const
+{
+  return do_getSuggestedDt();
+}
+
+bool Solver::do_handlesCollisions() const
+{
+  return false;
+}
+
+void Solver::do_solveWithCollisions( const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields,
+                                     const std::vector<PlanePtr>& planeObstacles,
+                                     const std::vector<MeshObstaclePtr>& meshObstacles )
+{
+  do_solve( dt, particles, forceFields );
+}
+
+float Solver::do_getSuggestedDt() const
+{
+  return 0;
 }
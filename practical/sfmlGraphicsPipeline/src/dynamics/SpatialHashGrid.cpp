@@ -0,0 +1,99 @@
+#include "./../../include/dynamics/SpatialHashGrid.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <glm/gtx/component_wise.hpp>
+#include <glm/gtx/norm.hpp>
+
+SpatialHashGrid::SpatialHashGrid() :
+    m_cellSize(1.0f),
+    m_invCellSize(1.0f),
+    m_bucketMask(0)
+{}
+
+SpatialHashGrid::~SpatialHashGrid()
+{}
+
+void SpatialHashGrid::build(const std::vector<glm::vec3>& positions, float cellSize)
+{
+    build(positions, cellSize, std::vector<unsigned char>());
+}
+
+void SpatialHashGrid::build(const std::vector<glm::vec3>& positions, float cellSize,
+                            const std::vector<unsigned char>& included)
+{
+    //The cells must not be too small compared to the coordinates, e.g. when
+    //all the radii are zero: about a million cells along each axis at most
+    const size_t n = positions.size();
+    float extent = 0.0f;
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(included.empty() || included[i])
+            extent = std::max(extent, glm::compMax(glm::abs(positions[i])));
+    }
+    m_cellSize = std::max(std::max(cellSize, extent/1048576.0f), std::numeric_limits<float>::min());
+    m_invCellSize = 1.0f/m_cellSize;
+
+    //Use a power of two number of buckets, about twice the number of points
+    size_t bucketNumber = 1;
+    while(bucketNumber < 2*n) bucketNumber <<= 1;
+    m_bucketMask = bucketNumber-1;
+
+    //Counting sort of the points by bucket. Left out points are counted in
+    //an extra bucket, past the last one, which is never visited.
+    m_bucketStart.assign(bucketNumber+2, 0);
+    m_pointBuckets.resize(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(included.empty() || included[i])
+            m_pointBuckets[i] = cellBucket(cellCoordinates(positions[i]));
+        else
+            m_pointBuckets[i] = bucketNumber;
+        ++m_bucketStart[m_pointBuckets[i]+1];
+    }
+    for(size_t b = 0; b < bucketNumber+1; ++b)
+    {
+        m_bucketStart[b+1] += m_bucketStart[b];
+    }
+
+    m_sortedIndices.resize(n);
+    m_sortedCells.resize(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        //m_bucketStart[b] is used as an insertion cursor, and ends up
+        //being the start of bucket b+1
+        unsigned int k = m_bucketStart[m_pointBuckets[i]]++;
+        m_sortedIndices[k] = i;
+        m_sortedCells[k] = cellCoordinates(positions[i]);
+    }
+    for(size_t b = bucketNumber+1; b > 0; --b)
+    {
+        m_bucketStart[b] = m_bucketStart[b-1];
+    }
+    m_bucketStart[0] = 0;
+}
+
+float SpatialHashGrid::getCellSize() const
+{
+    return m_cellSize;
+}
+
+void SpatialHashGrid::findNeighbors(const std::vector<glm::vec3>& positions, const glm::vec3& x,
+                                    float radius, std::vector<size_t>& neighbors) const
+{
+    neighbors.clear();
+    const float radius2 = radius*radius;
+    forEachNeighbor(x, radius, [&](size_t j)
+    {
+        if(glm::distance2(positions[j], x) <= radius2)
+            neighbors.push_back(j);
+    });
+}
+
+void SpatialHashGrid::getBufferSizes(std::vector<size_t>& sizes) const
+{
+    sizes.push_back(m_bucketStart.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_sortedIndices.capacity()*sizeof(unsigned int));
+    sizes.push_back(m_sortedCells.capacity()*sizeof(glm::ivec3));
+    sizes.push_back(m_pointBuckets.capacity()*sizeof(unsigned int));
+}
@@ -1,5 +1,8 @@
 #include "./../../include/dynamics/SpringForceField.hpp"
 
+#include <algorithm>
+#include <limits>
+
 SpringForceField::SpringForceField(const ParticlePtr p1, const ParticlePtr p2, float stiffness, float equilibriumLength, float damping) :
     m_p1(p1),
     m_p2(p2),
@@ -9,6 +12,33 @@ SpringForceField::SpringForceField(const ParticlePtr p1, const ParticlePtr p2, f
 {}
 
 void SpringForceField::do_addForce()
+{
+    glm::vec3 force = computeForce(m_p1->getPosition(), m_p2->getPosition(),
+                                   m_p1->getVelocity(), m_p2->getVelocity());
+    m_p1->incrForce(force);
+    m_p2->incrForce(-force);
+}
+
+bool SpringForceField::do_addForce(const ParticleStore& store, std::vector<glm::vec3>& forces)
+{
+    if(m_p1->getStore().get() != &store || m_p2->getStore().get() != &store)
+        return false;
+
+    const size_t i1 = m_p1->getIndex();
+    const size_t i2 = m_p2->getIndex();
+    const std::vector<unsigned char>& sleeping = store.getSleeping();
+    if(sleeping[i1] && sleeping[i2])
+        return true;
+    const std::vector<glm::vec3>& positions = store.getPositions();
+    const std::vector<glm::vec3>& velocities = store.getVelocities();
+    glm::vec3 force = computeForce(positions[i1], positions[i2], velocities[i1], velocities[i2]);
+    forces[i1] += force;
+    forces[i2] -= force;
+    return true;
+}
+
+glm::vec3 SpringForceField::computeForce(const glm::vec3& x1, const glm::vec3& x2,
+                                         const glm::vec3& v1, const glm::vec3& v2) const
 {
     //TODO: Implement a damped spring
     //Functions to use:
@@ -19,23 +49,117 @@ void SpringForceField::do_addForce()
     //      Otherwise the computation is useless
 
     //Compute displacement vector
-    glm::vec3 u = m_p1->getPosition() - m_p2->getPosition();
+    glm::vec3 u = x1 - x2;
 
     //Compute displacement length
     float uNorm = glm::length(u);
-    u = glm::normalize(u);
 
     //Compute spring force corresponding to the displacement 
     //If the displacement is measurable by the computer (otherwise no force)
     if (uNorm > std::numeric_limits<float>::epsilon())
     {
+        u /= uNorm;
         //Compute the stiffness term of the spring force
         glm::vec3 sF = -m_stiffness * (uNorm - m_equilibriumLength) * u;
         //Compute the damping term of the spring force
-        glm::vec3 dF = -m_damping * glm::dot(m_p1->getVelocity() - m_p2->getVelocity(), u) * u;
-        m_p1->setForce(m_p1->getForce() + (sF + dF));
-        m_p2->setForce(m_p2->getForce() - (sF + dF));
+        glm::vec3 dF = -m_damping * glm::dot(v1 - v2, u) * u;
+        return sF + dF;
     }
+    return glm::vec3(0.0, 0.0, 0.0);
+}
+
+bool SpringForceField::do_addJacobianProduct(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                             const std::vector<glm::vec3>& y, std::vector<glm::vec3>& out)
+{
+    if(m_p1->getStore().get() != &store || m_p2->getStore().get() != &store)
+        return false;
+
+    const size_t i1 = m_p1->getIndex();
+    const size_t i2 = m_p2->getIndex();
+    const std::vector<glm::vec3>& positions = store.getPositions();
+    glm::vec3 u = positions[i1] - positions[i2];
+    const float uNorm = glm::length(u);
+    if(uNorm <= std::numeric_limits<float>::epsilon())
+        return true;
+    u /= uNorm;
+
+    //dF1/dx1 = -k * ((1 - l0/l) * (I - u u^T) + u u^T) and dF1/dv1 = -c * u u^T.
+    //The transverse term is clamped to keep the matrix negative semi-definite
+    //when the spring is compressed.
+    const float transverse = std::max(0.0f, 1.0f - m_equilibriumLength/uNorm);
+    const glm::vec3 d = y[i1] - y[i2];
+    const float ud = glm::dot(u, d);
+    const glm::vec3 product = -stiffnessFactor*m_stiffness*(transverse*(d - ud*u) + ud*u)
+                              - dampingFactor*m_damping*ud*u;
+    out[i1] += product;
+    out[i2] -= product;
+    return true;
+}
+
+bool SpringForceField::do_addJacobianDiagonal(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                              std::vector<glm::vec3>& diagonal)
+{
+    if(m_p1->getStore().get() != &store || m_p2->getStore().get() != &store)
+        return false;
+
+    const size_t i1 = m_p1->getIndex();
+    const size_t i2 = m_p2->getIndex();
+    const std::vector<glm::vec3>& positions = store.getPositions();
+    glm::vec3 u = positions[i1] - positions[i2];
+    const float uNorm = glm::length(u);
+    if(uNorm <= std::numeric_limits<float>::epsilon())
+        return true;
+    u /= uNorm;
+
+    const float transverse = std::max(0.0f, 1.0f - m_equilibriumLength/uNorm);
+    const glm::vec3 uu = u*u;
+    const glm::vec3 block = -stiffnessFactor*m_stiffness*(transverse*(glm::vec3(1.0) - uu) + uu)
+                            - dampingFactor*m_damping*uu;
+    diagonal[i1] += block;
+    diagonal[i2] += block;
+    return true;
+}
+
+void SpringForceField::do_getConnections(const ParticleStore& store,
+                                         std::vector<std::pair<unsigned int, unsigned int> >& connections)
+{
+    if(m_p1->getStore().get() == &store && m_p2->getStore().get() == &store)
+        connections.push_back(std::make_pair(m_p1->getIndex(), m_p2->getIndex()));
+}
+
+bool SpringForceField::do_getDistanceConstraints(const ParticleStore& store, std::vector<DistanceConstraint>& constraints)
+{
+    if(m_p1->getStore().get() != &store || m_p2->getStore().get() != &store)
+        return false;
+    //A spring without stiffness only damps: it is not a constraint
+    if(m_stiffness <= 0.0f)
+        return false;
+
+    DistanceConstraint c;
+    c.particle1 = m_p1->getIndex();
+    c.particle2 = m_p2->getIndex();
+    c.restLength = m_equilibriumLength;
+    c.compliance = 1.0f/m_stiffness;
+    c.damping = m_damping;
+    constraints.push_back(c);
+    return true;
+}
+
+void SpringForceField::do_getParameters(std::vector<float>& parameters) const
+{
+    parameters.push_back(m_stiffness);
+    parameters.push_back(m_equilibriumLength);
+    parameters.push_back(m_damping);
+}
+
+bool SpringForceField::do_setParameters(const float* parameters, size_t count)
+{
+    if(count != 3)
+        return false;
+    m_stiffness = parameters[0];
+    m_equilibriumLength = parameters[1];
+    m_damping = parameters[2];
+    return true;
 }
 
 ParticlePtr SpringForceField::getParticle1() const
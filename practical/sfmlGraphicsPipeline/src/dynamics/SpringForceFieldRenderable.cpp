@@ -37,8 +37,8 @@ SpringForceFieldRenderable::SpringForceFieldRenderable(ShaderProgramPtr shaderPr
 void SpringForceFieldRenderable::do_draw()
 {
     //Update vertices positions from particle's positions
-    m_positions[0] = m_springForceField->getParticle1()->getPosition();
-    m_positions[1] = m_springForceField->getParticle2()->getPosition();
+    m_positions[0] = getPosition(m_springForceField->getParticle1());
+    m_positions[1] = getPosition(m_springForceField->getParticle2());
 
     //Update data on the GPU
     glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_pBuffer));
@@ -98,6 +98,18 @@ void SpringForceFieldRenderable::do_draw()
 
 void SpringForceFieldRenderable::do_animate(float time) {}
 
+void SpringForceFieldRenderable::setSimulationThread(SimulationThreadPtr thread)
+{
+    m_thread = thread;
+}
+
+glm::vec3 SpringForceFieldRenderable::getPosition(const ParticlePtr& particle) const
+{
+    if(m_thread)
+        return m_thread->getSnapshot().positions[particle->getIndex()];
+    return particle->getPosition();
+}
+
 SpringForceFieldRenderable::~SpringForceFieldRenderable()
 {
     glcheck(glDeleteBuffers(1, &m_pBuffer));
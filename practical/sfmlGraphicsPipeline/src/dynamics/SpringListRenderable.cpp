@@ -10,19 +10,23 @@ SpringListRenderable::SpringListRenderable(ShaderProgramPtr shaderProgram, std::
     m_springForceFields(springForceFields),
     m_pBuffer(0),
     m_cBuffer(0)
+{
+    initialize();
+}
+
+SpringListRenderable::SpringListRenderable(ShaderProgramPtr shaderProgram, SpringNetworkForceFieldPtr springNetwork) :
+    HierarchicalRenderable(shaderProgram),
+    m_springNetwork(springNetwork),
+    m_pBuffer(0),
+    m_cBuffer(0)
+{
+    initialize();
+}
+
+void SpringListRenderable::initialize()
 {
     //Create geometric data
-    size_t springNumber =  m_springForceFields.size();
-    m_positions.resize(2*springNumber);
-    m_colors.resize(2*springNumber, glm::vec4(0.0,0.0,1.0,1.0));
-    m_normals.resize(2*springNumber, glm::vec3(1.0,1.0,1.0));
-    int counter=0;
-    for(SpringForceFieldPtr s : m_springForceFields)
-    {
-        m_positions[2*counter+0] = s->getParticle1()->getPosition();
-        m_positions[2*counter+1] = s->getParticle2()->getPosition();
-        counter++;
-    }
+    updatePositions();
 
     //Create buffers
     glGenBuffers(1, &m_pBuffer); //vertices
@@ -41,17 +45,7 @@ SpringListRenderable::SpringListRenderable(ShaderProgramPtr shaderProgram, std::
 void SpringListRenderable::do_draw()
 {
     //Update vertices positions from particle's positions
-    size_t springNumber =  m_springForceFields.size();
-    m_positions.resize(2*springNumber);
-    m_colors.resize(2*springNumber, glm::vec4(0.0,0.0,1.0,1.0));
-    m_normals.resize(2*springNumber, glm::vec3(1.0,1.0,1.0));
-    int counter=0;
-    for(SpringForceFieldPtr s : m_springForceFields)
-    {
-        m_positions[2*counter+0] = s->getParticle1()->getPosition();
-        m_positions[2*counter+1] = s->getParticle2()->getPosition();
-        counter++;
-    }
+    updatePositions();
 
     //Update data on the GPU
     glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_pBuffer));
@@ -111,6 +105,52 @@ void SpringListRenderable::do_draw()
 
 void SpringListRenderable::do_animate(float time) {}
 
+void SpringListRenderable::setSimulationThread(SimulationThreadPtr thread)
+{
+    m_thread = thread;
+}
+
+void SpringListRenderable::setTrajectoryPlayer(TrajectoryPlayerPtr player)
+{
+    m_player = player;
+}
+
+glm::vec3 SpringListRenderable::getPosition(const ParticlePtr& particle) const
+{
+    if(m_thread)
+        return m_thread->getSnapshot().positions[particle->getIndex()];
+    if(m_player && particle->getIndex() < m_player->getParticleNumber())
+        return m_player->getSnapshot().positions[particle->getIndex()];
+    return particle->getPosition();
+}
+
+void SpringListRenderable::updatePositions()
+{
+    size_t springNumber = m_springForceFields.size();
+    if(m_springNetwork)
+        springNumber += m_springNetwork->getSpringNumber();
+    m_positions.resize(2*springNumber);
+    m_colors.resize(2*springNumber, glm::vec4(0.0,0.0,1.0,1.0));
+    m_normals.resize(2*springNumber, glm::vec3(1.0,1.0,1.0));
+    int counter=0;
+    for(SpringForceFieldPtr s : m_springForceFields)
+    {
+        m_positions[2*counter+0] = getPosition(s->getParticle1());
+        m_positions[2*counter+1] = getPosition(s->getParticle2());
+        counter++;
+    }
+    if(m_springNetwork)
+    {
+        const std::vector<ParticlePtr>& particles = m_springNetwork->getParticles();
+        for(size_t s = 0; s < m_springNetwork->getSpringNumber(); ++s)
+        {
+            m_positions[2*counter+0] = getPosition(particles[m_springNetwork->getParticle1(s)]);
+            m_positions[2*counter+1] = getPosition(particles[m_springNetwork->getParticle2(s)]);
+            counter++;
+        }
+    }
+}
+
 SpringListRenderable::~SpringListRenderable()
 {
     glcheck(glDeleteBuffers(1, &m_pBuffer));
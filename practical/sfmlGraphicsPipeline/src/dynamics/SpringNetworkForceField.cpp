@@ -0,0 +1,296 @@
+#include "./../../include/dynamics/SpringNetworkForceField.hpp"
+#include "./../../include/log.hpp"
+
+#include <algorithm>
+#include <limits>
+
+SpringNetworkForceField::SpringNetworkForceField(const std::vector<ParticlePtr>& particles) :
+    m_particles(particles),
+    m_rowsValid(false)
+{}
+
+size_t SpringNetworkForceField::addSpring(unsigned int p1, unsigned int p2,
+        float stiffness, float equilibriumLength, float damping)
+{
+    if(p1 >= m_particles.size() || p2 >= m_particles.size() || p1 == p2)
+    {
+        LOG(error, "cannot add a spring between particles " << p1 << " and " << p2
+            << " of a network of " << m_particles.size() << " particles");
+        return INVALID_SPRING;
+    }
+    m_particles1.push_back(p1);
+    m_particles2.push_back(p2);
+    m_stiffnesses.push_back(stiffness);
+    m_equilibriumLengths.push_back(equilibriumLength);
+    m_dampings.push_back(damping);
+    m_rowsValid = false;
+    return m_particles1.size() - 1;
+}
+
+void SpringNetworkForceField::do_addForce()
+{
+    ParticleStore* store = m_indices.update(m_particles);
+    if(store)
+    {
+        do_addForce(*store, store->getForces());
+        return;
+    }
+
+    //Particles spread over several stores: gather them in local arrays
+    const size_t n = m_particles.size();
+    std::vector<glm::vec3> positions(n), velocities(n);
+    std::vector<size_t> indices(n);
+    for(size_t k = 0; k < n; ++k)
+    {
+        positions[k] = m_particles[k]->getPosition();
+        velocities[k] = m_particles[k]->getVelocity();
+        indices[k] = k;
+    }
+    computeSpringForces(positions, velocities, indices);
+    for(size_t s = 0; s < m_springForces.size(); ++s)
+    {
+        m_particles[m_particles1[s]]->incrForce(m_springForces[s]);
+        m_particles[m_particles2[s]]->incrForce(-m_springForces[s]);
+    }
+}
+
+bool SpringNetworkForceField::do_addForce(const ParticleStore& store, std::vector<glm::vec3>& forces)
+{
+    if(m_indices.update(m_particles) != &store)
+        return false;
+    if(!m_rowsValid)
+        buildRows();
+
+    const std::vector<size_t>& indices = m_indices.getIndices();
+    computeSpringForces(store.getPositions(), store.getVelocities(), indices);
+    gatherSpringForces(indices, forces);
+    return true;
+}
+
+bool SpringNetworkForceField::do_addJacobianProduct(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                                    const std::vector<glm::vec3>& y, std::vector<glm::vec3>& out)
+{
+    if(m_indices.update(m_particles) != &store)
+        return false;
+    if(!m_rowsValid)
+        buildRows();
+
+    const std::vector<size_t>& indices = m_indices.getIndices();
+    const std::vector<glm::vec3>& positions = store.getPositions();
+    const long springNumber = m_particles1.size();
+    m_springForces.resize(springNumber);
+
+    //Same derivatives as SpringForceField, the product of each spring
+    //being gathered as its force.
+    #pragma omp parallel for schedule(static) if(springNumber > 4096)
+    for(long s = 0; s < springNumber; ++s)
+    {
+        const size_t i1 = indices[m_particles1[s]];
+        const size_t i2 = indices[m_particles2[s]];
+        glm::vec3 u = positions[i1] - positions[i2];
+        const float uNorm = glm::length(u);
+        const float invNorm = uNorm > std::numeric_limits<float>::epsilon() ? 1.0f/uNorm : 0.0f;
+        u *= invNorm;
+        const float transverse = std::max(0.0f, 1.0f - m_equilibriumLengths[s]*invNorm);
+        const glm::vec3 d = y[i1] - y[i2];
+        const float ud = glm::dot(u, d);
+        m_springForces[s] = -stiffnessFactor*m_stiffnesses[s]*(transverse*(d - ud*u) + ud*u)
+                            - dampingFactor*m_dampings[s]*ud*u;
+    }
+    gatherSpringForces(indices, out);
+    return true;
+}
+
+bool SpringNetworkForceField::do_addJacobianDiagonal(const ParticleStore& store, float stiffnessFactor, float dampingFactor,
+                                                     std::vector<glm::vec3>& diagonal)
+{
+    if(m_indices.update(m_particles) != &store)
+        return false;
+
+    const std::vector<size_t>& indices = m_indices.getIndices();
+    const std::vector<glm::vec3>& positions = store.getPositions();
+    for(size_t s = 0; s < m_particles1.size(); ++s)
+    {
+        const size_t i1 = indices[m_particles1[s]];
+        const size_t i2 = indices[m_particles2[s]];
+        glm::vec3 u = positions[i1] - positions[i2];
+        const float uNorm = glm::length(u);
+        if(uNorm <= std::numeric_limits<float>::epsilon())
+            continue;
+        u /= uNorm;
+        const float transverse = std::max(0.0f, 1.0f - m_equilibriumLengths[s]/uNorm);
+        const glm::vec3 uu = u*u;
+        const glm::vec3 block = -stiffnessFactor*m_stiffnesses[s]*(transverse*(glm::vec3(1.0) - uu) + uu)
+                                - dampingFactor*m_dampings[s]*uu;
+        diagonal[i1] += block;
+        diagonal[i2] += block;
+    }
+    return true;
+}
+
+void SpringNetworkForceField::gatherSpringForces(const std::vector<size_t>& indices, std::vector<glm::vec3>& forces) const
+{
+    //Sum the forces of the springs of each particle
+    const long n = m_particles.size();
+    #pragma omp parallel for schedule(static) if(n > 4096)
+    for(long k = 0; k < n; ++k)
+    {
+        glm::vec3 force(0.0, 0.0, 0.0);
+        for(unsigned int r = m_rowStart[k]; r < m_rowStart[k+1]; ++r)
+        {
+            const unsigned int entry = m_rowSprings[r];
+            if(entry & 1)
+                force -= m_springForces[entry >> 1];
+            else
+                force += m_springForces[entry >> 1];
+        }
+        forces[indices[k]] += force;
+    }
+}
+
+void SpringNetworkForceField::computeSpringForces(const std::vector<glm::vec3>& positions,
+                                                  const std::vector<glm::vec3>& velocities,
+                                                  const std::vector<size_t>& indices)
+{
+    const long springNumber = m_particles1.size();
+    m_springForces.resize(springNumber);
+
+    #pragma omp parallel for schedule(static) if(springNumber > 4096)
+    for(long s = 0; s < springNumber; ++s)
+    {
+        const size_t i1 = indices[m_particles1[s]];
+        const size_t i2 = indices[m_particles2[s]];
+        glm::vec3 u = positions[i1] - positions[i2];
+        const float uNorm = glm::length(u);
+
+        //No force if the displacement is not measurable
+        const float invNorm = uNorm > std::numeric_limits<float>::epsilon() ? 1.0f/uNorm : 0.0f;
+        u *= invNorm;
+        const float stiffnessTerm = -m_stiffnesses[s] * (uNorm - m_equilibriumLengths[s]);
+        const float dampingTerm = -m_dampings[s] * glm::dot(velocities[i1] - velocities[i2], u);
+        m_springForces[s] = (stiffnessTerm + dampingTerm) * u;
+    }
+}
+
+void SpringNetworkForceField::buildRows()
+{
+    //Counting sort of the spring ends by particle
+    const size_t n = m_particles.size();
+    const size_t springNumber = m_particles1.size();
+    m_rowStart.assign(n + 1, 0);
+    for(size_t s = 0; s < springNumber; ++s)
+    {
+        ++m_rowStart[m_particles1[s] + 1];
+        ++m_rowStart[m_particles2[s] + 1];
+    }
+    for(size_t k = 0; k < n; ++k)
+        m_rowStart[k+1] += m_rowStart[k];
+
+    m_rowSprings.resize(2*springNumber);
+    std::vector<unsigned int> next(m_rowStart.begin(), m_rowStart.end() - 1);
+    for(size_t s = 0; s < springNumber; ++s)
+    {
+        m_rowSprings[next[m_particles1[s]]++] = 2*s;
+        m_rowSprings[next[m_particles2[s]]++] = 2*s + 1;
+    }
+    m_rowsValid = true;
+}
+
+void SpringNetworkForceField::do_getConnections(const ParticleStore& store,
+                                                std::vector<std::pair<unsigned int, unsigned int> >& connections)
+{
+    if(m_indices.update(m_particles) != &store)
+        return;
+    const std::vector<size_t>& indices = m_indices.getIndices();
+    for(size_t s = 0; s < m_particles1.size(); ++s)
+        connections.push_back(std::make_pair(indices[m_particles1[s]], indices[m_particles2[s]]));
+}
+
+bool SpringNetworkForceField::do_getDistanceConstraints(const ParticleStore& store, std::vector<DistanceConstraint>& constraints)
+{
+    if(m_indices.update(m_particles) != &store)
+        return false;
+    //Springs without stiffness only damp: they are not constraints
+    for(float stiffness : m_stiffnesses)
+    {
+        if(stiffness <= 0.0f)
+            return false;
+    }
+
+    const std::vector<size_t>& indices = m_indices.getIndices();
+    for(size_t s = 0; s < m_particles1.size(); ++s)
+    {
+        DistanceConstraint c;
+        c.particle1 = indices[m_particles1[s]];
+        c.particle2 = indices[m_particles2[s]];
+        c.restLength = m_equilibriumLengths[s];
+        c.compliance = 1.0f/m_stiffnesses[s];
+        c.damping = m_dampings[s];
+        constraints.push_back(c);
+    }
+    return true;
+}
+
+void SpringNetworkForceField::do_getParameters(std::vector<float>& parameters) const
+{
+    parameters.insert(parameters.end(), m_stiffnesses.begin(), m_stiffnesses.end());
+    parameters.insert(parameters.end(), m_equilibriumLengths.begin(), m_equilibriumLengths.end());
+    parameters.insert(parameters.end(), m_dampings.begin(), m_dampings.end());
+}
+
+bool SpringNetworkForceField::do_setParameters(const float* parameters, size_t count)
+{
+    const size_t springNumber = m_particles1.size();
+    if(count != 3*springNumber)
+        return false;
+    m_stiffnesses.assign(parameters, parameters + springNumber);
+    m_equilibriumLengths.assign(parameters + springNumber, parameters + 2*springNumber);
+    m_dampings.assign(parameters + 2*springNumber, parameters + 3*springNumber);
+    return true;
+}
+
+const std::vector<ParticlePtr>& SpringNetworkForceField::getParticles() const
+{
+    return m_particles;
+}
+
+size_t SpringNetworkForceField::getSpringNumber() const
+{
+    return m_particles1.size();
+}
+
+unsigned int SpringNetworkForceField::getParticle1(size_t spring) const
+{
+    return m_particles1[spring];
+}
+
+unsigned int SpringNetworkForceField::getParticle2(size_t spring) const
+{
+    return m_particles2[spring];
+}
+
+const std::vector<float>& SpringNetworkForceField::getStiffnesses() const
+{
+    return m_stiffnesses;
+}
+
+const std::vector<float>& SpringNetworkForceField::getEquilibriumLengths() const
+{
+    return m_equilibriumLengths;
+}
+
+const std::vector<float>& SpringNetworkForceField::getDampings() const
+{
+    return m_dampings;
+}
+
+void SpringNetworkForceField::clear()
+{
+    m_particles1.clear();
+    m_particles2.clear();
+    m_stiffnesses.clear();
+    m_equilibriumLengths.clear();
+    m_dampings.clear();
+    m_springForces.clear();
+    m_rowsValid = false;
+}
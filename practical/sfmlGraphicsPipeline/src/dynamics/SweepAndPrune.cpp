@@ -0,0 +1,252 @@
+#include "./../../include/dynamics/SweepAndPrune.hpp"
+
+#include <algorithm>
+#include <limits>
+
+SweepAndPrune::SweepAndPrune() :
+    m_revision(0)
+{}
+
+SweepAndPrune::~SweepAndPrune()
+{}
+
+void SweepAndPrune::update(const ParticleStore& particles)
+{
+    if(particles.getRevision() != m_revision || particles.size() != m_min.size())
+    {
+        rebuild(particles);
+        return;
+    }
+
+    m_addedPairs.clear();
+    m_removedPairs.clear();
+
+    //Update the bounding boxes
+    const std::vector<glm::vec3>& positions = particles.getPositions();
+    const std::vector<float>& radii = particles.getRadii();
+    const std::vector<unsigned char>& activeFlags = particles.getActive();
+    for(size_t i = 0; i < m_min.size(); ++i)
+        computeBox(i, positions[i], radii[i], activeFlags[i]);
+
+    //Update the bounds and restore the order along each axis
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        for(Endpoint& e : m_endpoints[axis])
+        {
+            const unsigned int p = e.data >> 1;
+            e.value = (e.data & 1) ? m_max[p][axis] : m_min[p][axis];
+        }
+        sortAxis(axis);
+    }
+
+    //A pair can be added then removed by two swaps of the same update:
+    //only report the net changes.
+    m_addedPairs.erase(std::remove_if(m_addedPairs.begin(), m_addedPairs.end(),
+        [this](const Pair& p) { return m_pairIndices.count(pairKey(p.first, p.second)) == 0; }),
+        m_addedPairs.end());
+    m_removedPairs.erase(std::remove_if(m_removedPairs.begin(), m_removedPairs.end(),
+        [this](const Pair& p) { return m_pairIndices.count(pairKey(p.first, p.second)) != 0; }),
+        m_removedPairs.end());
+    std::sort(m_addedPairs.begin(), m_addedPairs.end());
+    m_addedPairs.erase(std::unique(m_addedPairs.begin(), m_addedPairs.end()), m_addedPairs.end());
+    std::sort(m_removedPairs.begin(), m_removedPairs.end());
+    m_removedPairs.erase(std::unique(m_removedPairs.begin(), m_removedPairs.end()), m_removedPairs.end());
+}
+
+void SweepAndPrune::clear()
+{
+    m_revision = 0;
+    m_min.clear();
+    m_max.clear();
+    for(int axis = 0; axis < 3; ++axis)
+        m_endpoints[axis].clear();
+    m_pairs.clear();
+    m_pairIndices.clear();
+    m_addedPairs.clear();
+    m_removedPairs.clear();
+}
+
+const std::vector<SweepAndPrune::Pair>& SweepAndPrune::getPairs() const
+{
+    return m_pairs;
+}
+
+const std::vector<SweepAndPrune::Pair>& SweepAndPrune::getAddedPairs() const
+{
+    return m_addedPairs;
+}
+
+const std::vector<SweepAndPrune::Pair>& SweepAndPrune::getRemovedPairs() const
+{
+    return m_removedPairs;
+}
+
+void SweepAndPrune::rebuild(const ParticleStore& particles)
+{
+    const size_t n = particles.size();
+    const std::vector<glm::vec3>& positions = particles.getPositions();
+    const std::vector<float>& radii = particles.getRadii();
+    const std::vector<unsigned char>& activeFlags = particles.getActive();
+
+    //Indices of the previous revision are meaningless: all pairs are new
+    m_revision = particles.getRevision();
+    m_pairs.clear();
+    m_pairIndices.clear();
+    m_addedPairs.clear();
+    m_removedPairs.clear();
+
+    m_min.resize(n);
+    m_max.resize(n);
+    for(size_t i = 0; i < n; ++i)
+        computeBox(i, positions[i], radii[i], activeFlags[i]);
+
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        std::vector<Endpoint>& endpoints = m_endpoints[axis];
+        endpoints.resize(2*n);
+        for(size_t i = 0; i < n; ++i)
+        {
+            endpoints[2*i].value = m_min[i][axis];
+            endpoints[2*i].data = 2*i;
+            endpoints[2*i+1].value = m_max[i][axis];
+            endpoints[2*i+1].data = 2*i+1;
+        }
+        std::sort(endpoints.begin(), endpoints.end(), precedes);
+    }
+
+    //Sweep along the first axis to find the initial overlapping pairs
+    std::vector<unsigned int> active;
+    for(const Endpoint& e : m_endpoints[0])
+    {
+        const unsigned int p = e.data >> 1;
+        if(e.data & 1)
+        {
+            std::vector<unsigned int>::iterator it = std::find(active.begin(), active.end(), p);
+            if(it != active.end())
+            {
+                *it = active.back();
+                active.pop_back();
+            }
+        }
+        else
+        {
+            for(unsigned int q : active)
+            {
+                if(overlap(p, q)) addPair(p, q);
+            }
+            //The upper bound of an empty interval comes before its lower bound
+            if(m_min[p].x <= m_max[p].x)
+                active.push_back(p);
+        }
+    }
+}
+
+void SweepAndPrune::sortAxis(int axis)
+{
+    std::vector<Endpoint>& endpoints = m_endpoints[axis];
+    for(size_t i = 1; i < endpoints.size(); ++i)
+    {
+        const Endpoint e = endpoints[i];
+        size_t j = i;
+        while(j > 0 && precedes(e, endpoints[j-1]))
+        {
+            //e moves before another bound: if a lower bound passes an upper bound,
+            //the boxes may start to overlap; if an upper bound passes a lower bound,
+            //they stop to overlap.
+            const Endpoint& other = endpoints[j-1];
+            const bool eIsMax = e.data & 1;
+            const bool otherIsMax = other.data & 1;
+            if(!eIsMax && otherIsMax)
+            {
+                if(overlap(e.data >> 1, other.data >> 1))
+                    addPair(e.data >> 1, other.data >> 1);
+            }
+            else if(eIsMax && !otherIsMax)
+            {
+                removePair(e.data >> 1, other.data >> 1);
+            }
+            endpoints[j] = endpoints[j-1];
+            --j;
+        }
+        endpoints[j] = e;
+    }
+}
+
+void SweepAndPrune::computeBox(size_t i, const glm::vec3& position, float radius, bool active)
+{
+    if(active)
+    {
+        m_min[i] = position - glm::vec3(radius);
+        m_max[i] = position + glm::vec3(radius);
+    }
+    else
+    {
+        //Inactive particles get an empty box, at the ends of the axes, which
+        //overlaps nothing
+        m_min[i] = glm::vec3(std::numeric_limits<float>::max());
+        m_max[i] = glm::vec3(-std::numeric_limits<float>::max());
+    }
+}
+
+bool SweepAndPrune::precedes(const Endpoint& a, const Endpoint& b)
+{
+    //At equal values, lower bounds come first: touching boxes overlap, as in
+    //SweepAndPrune::overlap(), since resting particles are often exactly in contact
+    if(a.value != b.value) return a.value < b.value;
+    return !(a.data & 1) && (b.data & 1);
+}
+
+bool SweepAndPrune::overlap(unsigned int a, unsigned int b) const
+{
+    return m_min[a].x <= m_max[b].x && m_min[b].x <= m_max[a].x
+        && m_min[a].y <= m_max[b].y && m_min[b].y <= m_max[a].y
+        && m_min[a].z <= m_max[b].z && m_min[b].z <= m_max[a].z;
+}
+
+void SweepAndPrune::addPair(unsigned int a, unsigned int b)
+{
+    if(a == b) return;
+    if(a > b) std::swap(a, b);
+    if(m_pairIndices.insert(std::make_pair(pairKey(a, b), m_pairs.size())).second)
+    {
+        m_pairs.push_back(Pair(a, b));
+        m_addedPairs.push_back(Pair(a, b));
+    }
+}
+
+void SweepAndPrune::removePair(unsigned int a, unsigned int b)
+{
+    if(a > b) std::swap(a, b);
+    std::unordered_map<unsigned long long, size_t>::iterator it = m_pairIndices.find(pairKey(a, b));
+    if(it == m_pairIndices.end()) return;
+
+    //Replace the removed pair by the last one to keep the pairs contiguous
+    const size_t index = it->second;
+    m_pairIndices.erase(it);
+    const Pair last = m_pairs.back();
+    m_pairs.pop_back();
+    if(index < m_pairs.size())
+    {
+        m_pairs[index] = last;
+        m_pairIndices[pairKey(last.first, last.second)] = index;
+    }
+    m_removedPairs.push_back(Pair(a, b));
+}
+
+void SweepAndPrune::getBufferSizes(std::vector<size_t>& sizes) const
+{
+    sizes.push_back(m_min.capacity()*sizeof(glm::vec3));
+    sizes.push_back(m_max.capacity()*sizeof(glm::vec3));
+    for(int axis = 0; axis < 3; ++axis)
+        sizes.push_back(m_endpoints[axis].capacity()*sizeof(Endpoint));
+    sizes.push_back(m_pairs.capacity()*sizeof(Pair));
+    //The nodes of the pair map are allocated one by one, see getAddedPairs()
+    sizes.push_back(m_pairIndices.bucket_count()*sizeof(void*));
+    sizes.push_back(m_addedPairs.capacity()*sizeof(Pair));
+    sizes.push_back(m_removedPairs.capacity()*sizeof(Pair));
+}
+
+unsigned long long SweepAndPrune::pairKey(unsigned int a, unsigned int b)
+{
+    return (static_cast<unsigned long long>(a) << 32) | b;
+}
@@ -0,0 +1,510 @@
+#include "./../../include/dynamics/Trajectory.hpp"
+#include "./../../include/log.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//Trajectory file layout: a header, the frames, then the index of the frames,
+//i.e. the offset of each frame followed by the time of each frame.
+static const char TRAJECTORY_MAGIC[8] = {'D', 'Y', 'N', 'S', 'Y', 'S', 'T', 'R'};
+static const uint32_t TRAJECTORY_VERSION = 1;
+
+struct TrajectoryHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t keyframeInterval;
+    uint64_t particleNumber;
+    float precision;
+    uint32_t padding;
+    /**@brief Number of frames of the index, 0 if the recording was not closed. */
+    uint64_t frameNumber;
+    uint64_t indexOffset;
+};
+
+//Each frame starts with this header, followed by the active flags, one bit
+//per particle, if FRAME_ACTIVE is set, then by the encoded positions
+struct FrameHeader
+{
+    /**@brief Size of the frame, header included. */
+    uint32_t size;
+    uint32_t flags;
+    float time;
+};
+
+static const uint32_t FRAME_KEY = 1;
+static const uint32_t FRAME_ACTIVE = 2;
+
+static int32_t quantize(float value, float precision)
+{
+    const float q = std::floor(value/precision + 0.5f);
+    if(q != q)
+        return 0;
+    return static_cast<int32_t>(std::min(std::max(q, -2147483520.0f), 2147483520.0f));
+}
+
+static void writeVarint(std::vector<unsigned char>& buffer, int64_t value)
+{
+    //Zigzag encoding, so that small negative values are small too
+    uint64_t v = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    while(v >= 0x80)
+    {
+        buffer.push_back(static_cast<unsigned char>(v | 0x80));
+        v >>= 7;
+    }
+    buffer.push_back(static_cast<unsigned char>(v));
+}
+
+static bool readVarint(const unsigned char*& data, const unsigned char* end, int64_t& value)
+{
+    uint64_t v = 0;
+    for(int shift = 0; shift < 64; shift += 7)
+    {
+        if(data == end)
+            return false;
+        const unsigned char byte = *data++;
+        v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if(!(byte & 0x80))
+        {
+            value = static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+TrajectoryRecorder::TrajectoryRecorder() :
+    m_particleNumber(0),
+    m_precision(1e-4f),
+    m_keyframeInterval(64),
+    m_size(0)
+{}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+    close();
+}
+
+bool TrajectoryRecorder::open(const std::string& filename, size_t particleNumber, float precision,
+                              unsigned int keyframeInterval)
+{
+    close();
+    if(precision <= 0.0f)
+    {
+        LOG(error, "invalid trajectory precision " << precision);
+        return false;
+    }
+    m_file.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+    if(!m_file)
+    {
+        LOG(error, "cannot open trajectory file " << filename << " for writing");
+        return false;
+    }
+    m_filename = filename;
+    m_particleNumber = particleNumber;
+    m_precision = precision;
+    m_keyframeInterval = std::max(keyframeInterval, 1u);
+    m_frameOffsets.clear();
+    m_frameTimes.clear();
+    m_quantized.assign(3*particleNumber, 0);
+    m_active.clear();
+
+    TrajectoryHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+    header.version = TRAJECTORY_VERSION;
+    header.keyframeInterval = m_keyframeInterval;
+    header.particleNumber = m_particleNumber;
+    header.precision = m_precision;
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_size = sizeof(header);
+    return true;
+}
+
+bool TrajectoryRecorder::close()
+{
+    if(!m_file.is_open())
+        return true;
+
+    //Append the index, then complete the header
+    const uint64_t indexOffset = m_size;
+    m_file.write(reinterpret_cast<const char*>(m_frameOffsets.data()), m_frameOffsets.size()*sizeof(uint64_t));
+    m_file.write(reinterpret_cast<const char*>(m_frameTimes.data()), m_frameTimes.size()*sizeof(float));
+    m_size += m_frameOffsets.size()*(sizeof(uint64_t) + sizeof(float));
+    const uint64_t frameNumber = m_frameOffsets.size();
+    m_file.seekp(offsetof(TrajectoryHeader, frameNumber));
+    m_file.write(reinterpret_cast<const char*>(&frameNumber), sizeof(frameNumber));
+    m_file.write(reinterpret_cast<const char*>(&indexOffset), sizeof(indexOffset));
+    const bool written = static_cast<bool>(m_file);
+    m_file.close();
+    if(!written)
+        LOG(error, "cannot write trajectory file " << m_filename);
+    return written;
+}
+
+bool TrajectoryRecorder::isOpen() const
+{
+    return m_file.is_open();
+}
+
+bool TrajectoryRecorder::record(const ParticleStore& store, float time, const std::vector<unsigned int>& slots)
+{
+    if(!m_file.is_open())
+        return false;
+    if(store.size() != m_particleNumber || (!slots.empty() && slots.size() != m_particleNumber))
+    {
+        LOG(error, "the particles changed during the recording of " << m_filename);
+        close();
+        return false;
+    }
+
+    const std::vector<glm::vec3>& positions = store.getPositions();
+    const std::vector<unsigned char>& storeActive = store.getActive();
+    const bool reordered = !slots.empty();
+    if(reordered)
+    {
+        m_gatheredActive.resize(m_particleNumber);
+        for(size_t i = 0; i < m_particleNumber; ++i)
+            m_gatheredActive[i] = storeActive[slots[i]];
+    }
+    const std::vector<unsigned char>& active = reordered ? m_gatheredActive : storeActive;
+    const bool key = m_frameOffsets.size() % m_keyframeInterval == 0;
+    const bool activeChanged = key || active != m_active;
+
+    FrameHeader frame;
+    frame.size = 0;
+    frame.flags = (key ? FRAME_KEY : 0) | (activeChanged ? FRAME_ACTIVE : 0);
+    frame.time = time;
+    m_buffer.resize(sizeof(frame));
+    if(activeChanged)
+    {
+        m_active = active;
+        m_buffer.resize(sizeof(frame) + (m_particleNumber + 7)/8, 0);
+        unsigned char* bits = m_buffer.data() + sizeof(frame);
+        for(size_t i = 0; i < m_particleNumber; ++i)
+        {
+            if(active[i])
+                bits[i/8] |= 1 << (i%8);
+        }
+    }
+
+    //Key frames store the quantized positions, other frames their change
+    for(size_t i = 0; i < m_particleNumber; ++i)
+    {
+        for(int k = 0; k < 3; ++k)
+        {
+            const int32_t q = quantize(positions[reordered ? slots[i] : i][k], m_precision);
+            int32_t& previous = m_quantized[3*i+k];
+            writeVarint(m_buffer, key ? q : static_cast<int64_t>(q) - previous);
+            previous = q;
+        }
+    }
+    frame.size = m_buffer.size();
+    std::memcpy(m_buffer.data(), &frame, sizeof(frame));
+
+    m_frameOffsets.push_back(m_size);
+    m_frameTimes.push_back(time);
+    m_file.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size());
+    m_size += m_buffer.size();
+    if(!m_file)
+    {
+        LOG(error, "cannot write trajectory file " << m_filename);
+        m_frameOffsets.pop_back();
+        m_frameTimes.pop_back();
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+size_t TrajectoryRecorder::getFrameNumber() const
+{
+    return m_frameOffsets.size();
+}
+
+uint64_t TrajectoryRecorder::getSize() const
+{
+    return m_size;
+}
+
+TrajectoryPlayer::TrajectoryPlayer() :
+    m_data(nullptr),
+    m_size(0),
+    m_particleNumber(0),
+    m_precision(0),
+    m_keyframeInterval(1),
+    m_frame(0)
+{
+    m_snapshot.step = 0;
+}
+
+TrajectoryPlayer::~TrajectoryPlayer()
+{
+    close();
+}
+
+bool TrajectoryPlayer::open(const std::string& filename)
+{
+    close();
+#ifdef __unix__
+    int descriptor = ::open(filename.c_str(), O_RDONLY);
+    if(descriptor < 0)
+    {
+        LOG(error, "cannot open trajectory file " << filename);
+        return false;
+    }
+    struct stat status;
+    if(fstat(descriptor, &status) != 0 || status.st_size == 0)
+    {
+        ::close(descriptor);
+        LOG(error, "cannot read trajectory file " << filename);
+        return false;
+    }
+    void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+    if(mapping == MAP_FAILED)
+    {
+        LOG(error, "cannot map trajectory file " << filename);
+        return false;
+    }
+    m_data = static_cast<const unsigned char*>(mapping);
+    m_size = status.st_size;
+#else
+    std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+    if(!file)
+    {
+        LOG(error, "cannot open trajectory file " << filename);
+        return false;
+    }
+    m_fileData.resize(file.tellg());
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(m_fileData.data()), m_fileData.size());
+    if(!file)
+    {
+        LOG(error, "cannot read trajectory file " << filename);
+        m_fileData.clear();
+        return false;
+    }
+    m_data = m_fileData.data();
+    m_size = m_fileData.size();
+#endif
+
+    TrajectoryHeader header;
+    bool valid = m_size >= sizeof(header);
+    if(valid)
+    {
+        std::memcpy(&header, m_data, sizeof(header));
+        valid = std::memcmp(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic)) == 0
+            && header.version == TRAJECTORY_VERSION
+            && header.keyframeInterval > 0
+            && header.precision > 0.0f;
+    }
+    if(valid && header.frameNumber > 0)
+    {
+        //Closed recording: read the index
+        const uint64_t indexSize = header.frameNumber*(sizeof(uint64_t) + sizeof(float));
+        valid = header.indexOffset <= m_size && indexSize <= m_size - header.indexOffset;
+        if(valid)
+        {
+            m_frameOffsets.resize(header.frameNumber);
+            m_frameTimes.resize(header.frameNumber);
+            std::memcpy(m_frameOffsets.data(), m_data + header.indexOffset, header.frameNumber*sizeof(uint64_t));
+            std::memcpy(m_frameTimes.data(), m_data + header.indexOffset + header.frameNumber*sizeof(uint64_t),
+                        header.frameNumber*sizeof(float));
+        }
+    }
+    else if(valid)
+    {
+        //Recording not closed: walk the frames, up to the last complete one
+        uint64_t offset = sizeof(header);
+        FrameHeader frame;
+        while(offset + sizeof(frame) <= m_size)
+        {
+            std::memcpy(&frame, m_data + offset, sizeof(frame));
+            if(frame.size < sizeof(frame) || frame.size > m_size - offset)
+                break;
+            m_frameOffsets.push_back(offset);
+            m_frameTimes.push_back(frame.time);
+            offset += frame.size;
+        }
+    }
+    if(!valid || m_frameOffsets.empty())
+    {
+        LOG(error, "trajectory file " << filename << " is not valid or empty");
+        close();
+        return false;
+    }
+
+    m_particleNumber = header.particleNumber;
+    m_precision = header.precision;
+    m_keyframeInterval = header.keyframeInterval;
+    m_quantized.assign(3*m_particleNumber, 0);
+    m_snapshot.positions.assign(m_particleNumber, glm::vec3(0.0, 0.0, 0.0));
+    m_snapshot.active.assign(m_particleNumber, 1);
+    m_snapshot.step = 0;
+    if(!decode(0))
+    {
+        LOG(error, "trajectory file " << filename << " is corrupted");
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TrajectoryPlayer::close()
+{
+#ifdef __unix__
+    if(m_data)
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+#else
+    m_fileData.clear();
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_particleNumber = 0;
+    m_frameOffsets.clear();
+    m_frameTimes.clear();
+    m_quantized.clear();
+    m_slots.clear();
+    m_frame = 0;
+    m_snapshot.positions.clear();
+    m_snapshot.active.clear();
+    m_snapshot.step = 0;
+}
+
+bool TrajectoryPlayer::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+size_t TrajectoryPlayer::getParticleNumber() const
+{
+    return m_particleNumber;
+}
+
+size_t TrajectoryPlayer::getFrameNumber() const
+{
+    return m_frameOffsets.size();
+}
+
+float TrajectoryPlayer::getFrameTime(size_t frame) const
+{
+    return m_frameTimes[frame];
+}
+
+size_t TrajectoryPlayer::findFrame(float time) const
+{
+    std::vector<float>::const_iterator it = std::upper_bound(m_frameTimes.begin(), m_frameTimes.end(), time);
+    return it == m_frameTimes.begin() ? 0 : it - m_frameTimes.begin() - 1;
+}
+
+bool TrajectoryPlayer::seek(size_t frame)
+{
+    if(frame >= m_frameOffsets.size())
+        return false;
+    if(frame == m_frame)
+        return true;
+
+    //Decode from the previous key frame, unless the current frame is closer
+    size_t first = frame / m_keyframeInterval * m_keyframeInterval;
+    if(m_frame < frame && m_frame >= first)
+        first = m_frame + 1;
+    for(size_t f = first; f <= frame; ++f)
+    {
+        if(!decode(f))
+        {
+            LOG(error, "corrupted trajectory frame " << f);
+            //Key frames hold the whole state: decode the current frame again
+            const size_t current = m_frame;
+            for(size_t g = current / m_keyframeInterval * m_keyframeInterval; g <= current; ++g)
+                decode(g);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TrajectoryPlayer::setSlots(const std::vector<unsigned int>& slots)
+{
+    if(!isOpen())
+        return false;
+    if(!slots.empty())
+    {
+        std::vector<unsigned char> used(m_particleNumber, 0);
+        bool valid = slots.size() == m_particleNumber;
+        for(size_t i = 0; valid && i < slots.size(); ++i)
+        {
+            valid = slots[i] < m_particleNumber && !used[slots[i]];
+            if(valid) used[slots[i]] = 1;
+        }
+        if(!valid)
+        {
+            LOG(error, "the store indices do not match the " << m_particleNumber << " recorded particles");
+            return false;
+        }
+    }
+    m_slots = slots;
+
+    //The active flags are only written by some frames: decode from the key frame
+    const size_t current = m_frame;
+    for(size_t f = current / m_keyframeInterval * m_keyframeInterval; f <= current; ++f)
+        decode(f);
+    return true;
+}
+
+size_t TrajectoryPlayer::getFrame() const
+{
+    return m_frame;
+}
+
+const ParticleSnapshot& TrajectoryPlayer::getSnapshot() const
+{
+    return m_snapshot;
+}
+
+bool TrajectoryPlayer::decode(size_t frame)
+{
+    const unsigned char* data = m_data + m_frameOffsets[frame];
+    FrameHeader header;
+    if(m_frameOffsets[frame] + sizeof(header) > m_size)
+        return false;
+    std::memcpy(&header, data, sizeof(header));
+    if(header.size < sizeof(header) || header.size > m_size - m_frameOffsets[frame])
+        return false;
+    const unsigned char* end = data + header.size;
+    data += sizeof(header);
+
+    if(header.flags & FRAME_ACTIVE)
+    {
+        const size_t bytes = (m_particleNumber + 7)/8;
+        if(static_cast<size_t>(end - data) < bytes)
+            return false;
+        for(size_t i = 0; i < m_particleNumber; ++i)
+            m_snapshot.active[m_slots.empty() ? i : m_slots[i]] = (data[i/8] >> (i%8)) & 1;
+        data += bytes;
+    }
+
+    const bool key = header.flags & FRAME_KEY;
+    for(size_t i = 0; i < 3*m_particleNumber; ++i)
+    {
+        int64_t value;
+        if(!readVarint(data, end, value))
+            return false;
+        m_quantized[i] = static_cast<int32_t>(key ? value : m_quantized[i] + value);
+    }
+    for(size_t i = 0; i < m_particleNumber; ++i)
+    {
+        m_snapshot.positions[m_slots.empty() ? i : m_slots[i]] = m_precision*glm::vec3(m_quantized[3*i], m_quantized[3*i+1], m_quantized[3*i+2]);
+    }
+    m_frame = frame;
+    m_snapshot.step = frame;
+    return true;
+}
@@ -0,0 +1,278 @@
+#include "./../../include/dynamics/XPBDSolver.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <glm/gtx/norm.hpp>
+
+XPBDSolver::XPBDSolver() :
+    m_substeps(4),
+    m_iterations(2),
+    m_collisions(true)
+{
+
+}
+
+XPBDSolver::~XPBDSolver()
+{
+
+}
+
+unsigned int XPBDSolver::getSubsteps() const
+{
+    return m_substeps;
+}
+
+void XPBDSolver::setSubsteps(unsigned int substeps)
+{
+    m_substeps = std::max(1u, substeps);
+}
+
+unsigned int XPBDSolver::getIterations() const
+{
+    return m_iterations;
+}
+
+void XPBDSolver::setIterations(unsigned int iterations)
+{
+    m_iterations = iterations;
+}
+
+bool XPBDSolver::getCollisions() const
+{
+    return m_collisions;
+}
+
+void XPBDSolver::setCollisions(bool onOff)
+{
+    m_collisions = onOff;
+}
+
+bool XPBDSolver::do_handlesCollisions() const
+{
+    return m_collisions;
+}
+
+void XPBDSolver::do_solve(const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields)
+{
+    gatherConstraints(particles, forceFields);
+    m_planeContacts.clear();
+    m_meshContacts.clear();
+    m_particleContacts.clear();
+    step(dt, particles, std::vector<PlanePtr>(), std::vector<MeshObstaclePtr>());
+}
+
+void XPBDSolver::do_solveWithCollisions(const float& dt, ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields,
+                                        const std::vector<PlanePtr>& planeObstacles,
+                                        const std::vector<MeshObstaclePtr>& meshObstacles)
+{
+    gatherConstraints(particles, forceFields);
+    detectContacts(dt, particles, planeObstacles, meshObstacles);
+    step(dt, particles, planeObstacles, meshObstacles);
+}
+
+void XPBDSolver::gatherConstraints(ParticleStore& particles, const std::vector<ForceFieldPtr>& forceFields)
+{
+    const size_t n = particles.size();
+    const std::vector<float>& invMasses = particles.getInverseMasses();
+    const std::vector<unsigned char>& fixed = particles.getFixed();
+    const std::vector<unsigned char>& sleeping = particles.getSleeping();
+
+    //Fixed and sleeping particles are not moved by the constraints
+    m_inverseMasses.resize(n);
+    for(size_t i = 0; i < n; ++i)
+        m_inverseMasses[i] = (fixed[i] || sleeping[i]) ? 0.0f : invMasses[i];
+
+    m_constraints.clear();
+    m_constrainedFields.resize(forceFields.size());
+    for(size_t f = 0; f < forceFields.size(); ++f)
+        m_constrainedFields[f] = forceFields[f]->getDistanceConstraints(particles, m_constraints);
+
+    //The particle forces, added before the solver is called, include the
+    //forces of the constraints: evaluate the constraints apart and remove
+    //them, so that the other force fields, e.g. a fluid, are not evaluated
+    //twice. If a constraint cannot be evaluated apart, evaluate the other
+    //force fields apart instead.
+    m_externalForces = particles.getForces();
+    m_constraintForces.assign(n, glm::vec3(0.0, 0.0, 0.0));
+    bool separated = true;
+    for(size_t f = 0; f < forceFields.size() && separated; ++f)
+    {
+        if(m_constrainedFields[f])
+            separated = forceFields[f]->addForce(particles, m_constraintForces);
+    }
+    if(separated)
+    {
+        for(size_t i = 0; i < n; ++i)
+            m_externalForces[i] -= m_constraintForces[i];
+    }
+    else
+    {
+        m_externalForces.assign(n, glm::vec3(0.0, 0.0, 0.0));
+        for(size_t f = 0; f < forceFields.size(); ++f)
+        {
+            if(!m_constrainedFields[f])
+                forceFields[f]->addForce(particles, m_externalForces);
+        }
+    }
+}
+
+void XPBDSolver::detectContacts(float dt, const ParticleStore& particles, const std::vector<PlanePtr>& planeObstacles,
+                                const std::vector<MeshObstaclePtr>& meshObstacles)
+{
+    const std::vector<glm::vec3>& positions = particles.getPositions();
+    const std::vector<glm::vec3>& velocities = particles.getVelocities();
+    const std::vector<float>& radii = particles.getRadii();
+    const std::vector<unsigned char>& active = particles.getActive();
+    const size_t n = particles.size();
+
+    //Contacts are searched once per time step, with a margin covering the
+    //largest displacement of a particle during the step.
+    float maxRadius = 0.0f;
+    float maxDisplacement = 0.0f;
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(!active[i]) continue;
+        maxRadius = std::max(maxRadius, radii[i]);
+        if(m_inverseMasses[i] > 0.0f)
+        {
+            const glm::vec3 v = velocities[i] + dt*m_inverseMasses[i]*m_externalForces[i];
+            maxDisplacement = std::max(maxDisplacement, dt*glm::length(v));
+        }
+    }
+
+    m_planeContacts.clear();
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(m_inverseMasses[i] == 0.0f || !active[i]) continue;
+        for(size_t o = 0; o < planeObstacles.size(); ++o)
+        {
+            const Plane& plane = *planeObstacles[o];
+            const float distance = glm::dot(positions[i], plane.normal()) - plane.distanceToOrigin();
+            if(distance < radii[i] + maxDisplacement)
+                m_planeContacts.push_back(std::make_pair(i, o));
+        }
+    }
+
+    m_meshContacts.clear();
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(m_inverseMasses[i] == 0.0f || !active[i]) continue;
+        for(size_t o = 0; o < meshObstacles.size(); ++o)
+        {
+            glm::vec3 normal;
+            float distance;
+            if(meshObstacles[o]->findContact(positions[i], radii[i] + maxDisplacement, normal, distance))
+                m_meshContacts.push_back(std::make_pair(i, o));
+        }
+    }
+
+    m_particleContacts.clear();
+    const float reach = 2.0f*(maxRadius + maxDisplacement);
+    m_grid.build(positions, reach, active);
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(!active[i]) continue;
+        m_grid.forEachNeighbor(positions[i], reach, [&](size_t j)
+        {
+            if(j <= i || (m_inverseMasses[i] == 0.0f && m_inverseMasses[j] == 0.0f)) return;
+            const float distance = radii[i] + radii[j] + 2.0f*maxDisplacement;
+            if(glm::distance2(positions[i], positions[j]) < distance*distance)
+                m_particleContacts.push_back(std::make_pair(i, j));
+        });
+    }
+}
+
+void XPBDSolver::step(float dt, ParticleStore& particles, const std::vector<PlanePtr>& planeObstacles,
+                      const std::vector<MeshObstaclePtr>& meshObstacles)
+{
+    std::vector<glm::vec3>& positions = particles.getPositions();
+    std::vector<glm::vec3>& velocities = particles.getVelocities();
+    const std::vector<float>& radii = particles.getRadii();
+    const size_t n = particles.size();
+    const float h = dt/m_substeps;
+
+    m_previousPositions.resize(n);
+    for(unsigned int substep = 0; substep < m_substeps; ++substep)
+    {
+        //Predict the positions with the external forces
+        for(size_t i = 0; i < n; ++i)
+        {
+            m_previousPositions[i] = positions[i];
+            if(m_inverseMasses[i] > 0.0f)
+            {
+                velocities[i] += h*m_inverseMasses[i]*m_externalForces[i];
+                positions[i] += h*velocities[i];
+            }
+        }
+
+        m_lambdas.assign(m_constraints.size(), 0.0f);
+        for(unsigned int iteration = 0; iteration < m_iterations; ++iteration)
+        {
+            //Compliant distance constraints, with damping along the constraint
+            for(size_t c = 0; c < m_constraints.size(); ++c)
+            {
+                const DistanceConstraint& constraint = m_constraints[c];
+                const unsigned int i = constraint.particle1;
+                const unsigned int j = constraint.particle2;
+                const float w = m_inverseMasses[i] + m_inverseMasses[j];
+                if(w == 0.0f) continue;
+                glm::vec3 u = positions[i] - positions[j];
+                const float length = glm::length(u);
+                if(length <= std::numeric_limits<float>::epsilon()) continue;
+                u /= length;
+
+                const float alpha = constraint.compliance/(h*h);
+                const float gamma = constraint.compliance*constraint.damping/h;
+                const float C = length - constraint.restLength;
+                const float dC = glm::dot(u, (positions[i] - m_previousPositions[i])
+                                           - (positions[j] - m_previousPositions[j]));
+                const float dLambda = (-C - alpha*m_lambdas[c] - gamma*dC) / ((1.0f + gamma)*w + alpha);
+                m_lambdas[c] += dLambda;
+                positions[i] += m_inverseMasses[i]*dLambda*u;
+                positions[j] -= m_inverseMasses[j]*dLambda*u;
+            }
+
+            //Contacts only push the particles apart
+            for(const std::pair<unsigned int, unsigned int>& contact : m_planeContacts)
+            {
+                const unsigned int i = contact.first;
+                const Plane& plane = *planeObstacles[contact.second];
+                const float C = glm::dot(positions[i], plane.normal()) - plane.distanceToOrigin() - radii[i];
+                if(C < 0.0f)
+                    positions[i] -= C*plane.normal();
+            }
+            //The closest point of a mesh changes as the particle moves: it is
+            //searched again at each iteration
+            for(const std::pair<unsigned int, unsigned int>& contact : m_meshContacts)
+            {
+                const unsigned int i = contact.first;
+                glm::vec3 normal;
+                float distance;
+                if(!meshObstacles[contact.second]->findContact(positions[i], radii[i], normal, distance)) continue;
+                const float C = distance - radii[i];
+                if(C < 0.0f)
+                    positions[i] -= C*normal;
+            }
+            for(const std::pair<unsigned int, unsigned int>& contact : m_particleContacts)
+            {
+                const unsigned int i = contact.first;
+                const unsigned int j = contact.second;
+                glm::vec3 u = positions[i] - positions[j];
+                const float length = glm::length(u);
+                const float C = length - radii[i] - radii[j];
+                if(C >= 0.0f || length <= std::numeric_limits<float>::epsilon()) continue;
+                u /= length;
+                const float dLambda = -C/(m_inverseMasses[i] + m_inverseMasses[j]);
+                positions[i] += m_inverseMasses[i]*dLambda*u;
+                positions[j] -= m_inverseMasses[j]*dLambda*u;
+            }
+        }
+
+        //Deduce the velocities from the displacements
+        for(size_t i = 0; i < n; ++i)
+        {
+            if(m_inverseMasses[i] > 0.0f)
+                velocities[i] = (positions[i] - m_previousPositions[i])/h;
+        }
+    }
+}